@@ -0,0 +1,60 @@
+/**
+ * @file
+ * @brief Allocation hooks - Accounting of the image and signal allocations
+ * The host and device allocators of the images and signals report every
+ * allocation and every free to the hook, when one is installed (the profiler
+ * installs one to count the allocations of each run).
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef ALLOCATION_HOOKS_H
+#define ALLOCATION_HOOKS_H
+
+#include <cstddef>
+
+namespace npp
+{
+
+    // Memory an allocation comes from
+    enum AllocationPool
+    {
+        ALLOCATION_HOST,
+        ALLOCATION_DEVICE
+    };
+
+    // Called by the image and signal allocators on every allocation (nBytes > 0)
+    // and every free (nBytes == 0), when installed
+    typedef void (*AllocationHook)(AllocationPool ePool, const void *pData, size_t nBytes);
+
+    inline
+    AllocationHook &
+    allocationHook()
+    {
+        static AllocationHook hook = 0;
+        return hook;
+    }
+
+    inline
+    void
+    allocated(AllocationPool ePool, const void *pData, size_t nBytes)
+    {
+        if (allocationHook() != 0 && pData != 0)
+        {
+            allocationHook()(ePool, pData, nBytes);
+        }
+    }
+
+    inline
+    void
+    freed(AllocationPool ePool, const void *pData)
+    {
+        if (allocationHook() != 0 && pData != 0)
+        {
+            allocationHook()(ePool, pData, 0);
+        }
+    }
+
+} // npp namespace
+
+#endif // ALLOCATION_HOOKS_H
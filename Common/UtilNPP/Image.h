@@ -137,13 +137,13 @@ namespace npp
             Size oSize_;
     };
 
-    bool
+    inline bool
     operator== (const Image::Size &rFirst, const Image::Size &rSecond)
     {
         return rFirst.nWidth == rSecond.nWidth && rFirst.nHeight == rSecond.nHeight;
     }
 
-    bool
+    inline bool
     operator!= (const Image::Size &rFirst, const Image::Size &rSecond)
     {
         return rFirst.nWidth != rSecond.nWidth || rFirst.nHeight != rSecond.nHeight;
@@ -28,6 +28,7 @@
 #ifndef NV_UTIL_NPP_IMAGE_ALLOCATORS_CPU_H
 #define NV_UTIL_NPP_IMAGE_ALLOCATORS_CPU_H
 
+#include "AllocationHooks.h"
 #include "Exceptions.h"
 
 namespace npp
@@ -45,6 +46,7 @@ namespace npp
 
                 D *pResult = new D[nWidth * N * nHeight];
                 *pPitch = nWidth * sizeof(D) * N;
+                allocated(ALLOCATION_HOST, pResult, static_cast<size_t>(*pPitch) * nHeight);
 
                 return pResult;
             };
@@ -53,6 +55,7 @@ namespace npp
             void
             Free2D(D *pPixels)
             {
+                freed(ALLOCATION_HOST, pPixels);
                 delete[] pPixels;
             };
 
@@ -28,6 +28,7 @@
 #ifndef NV_UTIL_NPP_IMAGE_ALLOCATORS_NPP_H
 #define NV_UTIL_NPP_IMAGE_ALLOCATORS_NPP_H
 
+#include "AllocationHooks.h"
 #include "Exceptions.h"
 
 #include <nppi.h>
@@ -35,6 +36,17 @@
 
 namespace npp
 {
+    // Empty images own no device memory: no device call, which would create the CUDA context
+    inline
+    void
+    FreeDevice(void *pPixels)
+    {
+        if (pPixels != 0)
+        {
+            nppiFree(pPixels);
+        }
+    }
+
     template <typename D, size_t N>
     D *
     MallocTightCUDA(unsigned int nWidth, unsigned int nHeight, unsigned int *pPitch)
@@ -75,6 +87,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -82,7 +96,8 @@ namespace npp
             void
             Free2D(Npp8u *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -135,6 +150,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -142,7 +159,8 @@ namespace npp
             void
             Free2D(Npp8u *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -195,6 +213,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -202,7 +222,8 @@ namespace npp
             void
             Free2D(Npp8u *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -255,6 +276,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -262,7 +285,8 @@ namespace npp
             void
             Free2D(Npp8u *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -315,6 +339,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -322,7 +348,8 @@ namespace npp
             void
             Free2D(Npp16u *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -375,6 +402,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -382,7 +411,8 @@ namespace npp
             void
             Free2D(Npp16u *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -436,6 +466,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -443,7 +475,8 @@ namespace npp
             void
             Free2D(Npp16u *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -496,6 +529,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -503,7 +538,8 @@ namespace npp
             void
             Free2D(Npp16u *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -556,6 +592,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -563,7 +601,8 @@ namespace npp
             void
             Free2D(Npp16s *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -616,6 +655,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -623,7 +664,8 @@ namespace npp
             void
             Free2D(Npp16s *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -676,6 +718,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -683,7 +727,8 @@ namespace npp
             void
             Free2D(Npp16s *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -736,6 +781,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -743,7 +790,8 @@ namespace npp
             void
             Free2D(Npp32s *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -796,6 +844,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -803,7 +853,8 @@ namespace npp
             void
             Free2D(Npp32s *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -856,6 +907,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -863,7 +916,8 @@ namespace npp
             void
             Free2D(Npp32s *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -916,6 +970,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -923,7 +979,8 @@ namespace npp
             void
             Free2D(Npp32f *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -976,6 +1033,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -983,7 +1042,8 @@ namespace npp
             void
             Free2D(Npp32f *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -1036,6 +1096,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -1043,7 +1105,8 @@ namespace npp
             void
             Free2D(Npp32f *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -1096,6 +1159,8 @@ namespace npp
                     NPP_ASSERT(pResult != 0);
                 }
 
+                allocated(ALLOCATION_DEVICE, pResult, static_cast<size_t>(*pPitch) * nHeight);
+
                 return pResult;
             };
 
@@ -1103,7 +1168,8 @@ namespace npp
             void
             Free2D(Npp32f *pPixels)
             {
-                nppiFree(pPixels);
+                freed(ALLOCATION_DEVICE, pPixels);
+                FreeDevice(pPixels);
             };
 
             static
@@ -98,6 +98,111 @@ namespace npp
         oImage.swap(rImage);
     }
 
+    // Load an image from disk as gray-scale. 8-bit grey images are copied, color images are converted
+    // by rConverter in the same row copy, so the color pixels are never stored. rConverter.begin(nPixelBytes,
+    // pOffsets) is called once, with the bytes per pixel (3 or 4) and the offsets of red, green and blue, then
+    // rConverter.row(pSrc, nWidth, pGrey, pPlanes) once per row. When pPlanes is not null, its 3 images also
+    // receive the red, green and blue planes.
+    template <class ColorConverter>
+    void
+    loadImage(const std::string &rFileName, ImageCPU_8u_C1 &rImage, ColorConverter &rConverter,
+              ImageCPU_8u_C1 *pPlanes = 0)
+    {
+        // set your own FreeImage error handler
+        FreeImage_SetOutputMessage(FreeImageErrorHandler);
+
+        FREE_IMAGE_FORMAT eFormat = FreeImage_GetFileType(rFileName.c_str());
+
+        // no signature? try to guess the file format from the file extension
+        if (eFormat == FIF_UNKNOWN)
+        {
+            eFormat = FreeImage_GetFIFFromFilename(rFileName.c_str());
+        }
+
+        NPP_ASSERT(eFormat != FIF_UNKNOWN);
+        NPP_ASSERT(FreeImage_FIFSupportsReading(eFormat));
+        FIBITMAP *pBitmap = FreeImage_Load(eFormat, rFileName.c_str());
+        NPP_ASSERT(pBitmap != 0);
+
+        // 8 bit grey, 24 bit RGB and 32 bit RGBA standard bitmaps are converted as they are. Anything else
+        // (palettes, other depths, CMYK, 16 bit or floating point samples) goes to 24 bit RGB first.
+        bool bBitmap = FreeImage_GetImageType(pBitmap) == FIT_BITMAP;
+        FREE_IMAGE_COLOR_TYPE eColorType = FreeImage_GetColorType(pBitmap);
+        unsigned int nBPP = FreeImage_GetBPP(pBitmap);
+        bool bGrey = bBitmap && eColorType == FIC_MINISBLACK && nBPP == 8;
+        bool bRGB = bBitmap && ((nBPP == 24 && eColorType == FIC_RGB) ||
+                                (nBPP == 32 && (eColorType == FIC_RGB || eColorType == FIC_RGBALPHA)));
+        if (!bGrey && !bRGB)
+        {
+            FIBITMAP *pRGBBitmap = FreeImage_ConvertTo24Bits(pBitmap);
+            if (pRGBBitmap == 0 && !bBitmap)
+            {
+                // ConvertTo24Bits only takes some 16 bit types: the others go to 8 bit first
+                FIBITMAP *pStandardBitmap = FreeImage_ConvertToStandardType(pBitmap, TRUE);
+                if (pStandardBitmap != 0)
+                {
+                    pRGBBitmap = FreeImage_ConvertTo24Bits(pStandardBitmap);
+                    FreeImage_Unload(pStandardBitmap);
+                }
+            }
+            if (pRGBBitmap != pBitmap)
+            {
+                FreeImage_Unload(pBitmap);
+            }
+            pBitmap = pRGBBitmap;
+            NPP_ASSERT(pBitmap != 0);
+        }
+        int nPixelBytes = FreeImage_GetBPP(pBitmap) / 8;
+        static const int aOffsets[3] = {FI_RGBA_RED, FI_RGBA_GREEN, FI_RGBA_BLUE};
+        if (!bGrey)
+        {
+            rConverter.begin(nPixelBytes, aOffsets);
+        }
+
+        ImageCPU_8u_C1 oImage(FreeImage_GetWidth(pBitmap), FreeImage_GetHeight(pBitmap));
+        ImageCPU_8u_C1 aPlanes[3];
+        for (int iPlane = 0; pPlanes && iPlane < 3; ++iPlane)
+        {
+            ImageCPU_8u_C1 oPlane(oImage.width(), oImage.height());
+            aPlanes[iPlane].swap(oPlane);
+        }
+
+        // Copy (or convert) the FreeImage data into the new ImageCPU, bottom-up
+        unsigned int nSrcPitch = FreeImage_GetPitch(pBitmap);
+        const Npp8u *pSrcLine = FreeImage_GetBits(pBitmap) + nSrcPitch * (FreeImage_GetHeight(pBitmap) - 1);
+
+        for (size_t iLine = 0; iLine < oImage.height(); ++iLine)
+        {
+            Npp8u *pDstLine = oImage.data(0, (int)iLine);
+            Npp8u *aPlaneLines[3] = {0, 0, 0};
+            for (int iPlane = 0; pPlanes && iPlane < 3; ++iPlane)
+            {
+                aPlaneLines[iPlane] = aPlanes[iPlane].data(0, (int)iLine);
+            }
+
+            if (bGrey)
+            {
+                memcpy(pDstLine, pSrcLine, oImage.width() * sizeof(Npp8u));
+                for (int iPlane = 0; pPlanes && iPlane < 3; ++iPlane)
+                {
+                    memcpy(aPlaneLines[iPlane], pSrcLine, oImage.width() * sizeof(Npp8u));
+                }
+            }
+            else
+            {
+                rConverter.row(pSrcLine, (int)oImage.width(), pDstLine, pPlanes ? aPlaneLines : 0);
+            }
+            pSrcLine -= nSrcPitch;
+        }
+        FreeImage_Unload(pBitmap);
+
+        oImage.swap(rImage);
+        for (int iPlane = 0; pPlanes && iPlane < 3; ++iPlane)
+        {
+            aPlanes[iPlane].swap(pPlanes[iPlane]);
+        }
+    }
+
     // Save an gray-scale image to disk.
     void
     saveImage(const std::string &rFileName, const ImageCPU_8u_C1 &rImage)
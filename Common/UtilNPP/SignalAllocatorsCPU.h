@@ -29,6 +29,7 @@
 #ifndef NV_UTIL_NPP_SIGNAL_ALLOCATORS_CPU_H
 #define NV_UTIL_NPP_SIGNAL_ALLOCATORS_CPU_H
 
+#include "AllocationHooks.h"
 #include "Exceptions.h"
 
 namespace npp
@@ -42,13 +43,17 @@ namespace npp
             D *
             Malloc1D(unsigned int nSize)
             {
-                return new D[nSize];;
+                D *pResult = new D[nSize];
+                allocated(ALLOCATION_HOST, pResult, nSize * sizeof(D));
+
+                return pResult;
             };
 
             static
             void
             Free1D(D *pPixels)
             {
+                freed(ALLOCATION_HOST, pPixels);
                 delete[] pPixels;
             };
 
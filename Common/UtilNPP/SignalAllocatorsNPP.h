@@ -30,6 +30,7 @@
 #define NV_UTIL_NPP_SIGNAL_ALLOCATORS_NPP_H
 
 
+#include "AllocationHooks.h"
 #include "Exceptions.h"
 
 #include <npps.h>
@@ -54,6 +55,8 @@ namespace npp
                 Npp8u *pResult = nppsMalloc_8u(static_cast<int>(nSize));
                 NPP_ASSERT(pResult != 0);
 
+                allocated(ALLOCATION_DEVICE, pResult, nSize * sizeof(*pResult));
+
                 return pResult;
             };
 
@@ -61,6 +64,7 @@ namespace npp
             void
             Free1D(Npp8u *pValues)
             {
+                freed(ALLOCATION_DEVICE, pValues);
                 nppsFree(pValues);
             };
 
@@ -103,6 +107,8 @@ namespace npp
                 Npp16s *pResult = nppsMalloc_16s(static_cast<int>(nSize));
                 NPP_ASSERT(pResult != 0);
 
+                allocated(ALLOCATION_DEVICE, pResult, nSize * sizeof(*pResult));
+
                 return pResult;
             };
 
@@ -110,6 +116,7 @@ namespace npp
             void
             Free1D(Npp16s *pValues)
             {
+                freed(ALLOCATION_DEVICE, pValues);
                 nppsFree(pValues);
             };
 
@@ -152,6 +159,8 @@ namespace npp
                 Npp16u *pResult = nppsMalloc_16u(static_cast<int>(nSize));
                 NPP_ASSERT(pResult != 0);
 
+                allocated(ALLOCATION_DEVICE, pResult, nSize * sizeof(*pResult));
+
                 return pResult;
             };
 
@@ -159,6 +168,7 @@ namespace npp
             void
             Free1D(Npp16u *pValues)
             {
+                freed(ALLOCATION_DEVICE, pValues);
                 nppsFree(pValues);
             };
 
@@ -201,6 +211,8 @@ namespace npp
                 Npp16sc *pResult = nppsMalloc_16sc(static_cast<int>(nSize));
                 NPP_ASSERT(pResult != 0);
 
+                allocated(ALLOCATION_DEVICE, pResult, nSize * sizeof(*pResult));
+
                 return pResult;
             };
 
@@ -208,6 +220,7 @@ namespace npp
             void
             Free1D(Npp16sc *pValues)
             {
+                freed(ALLOCATION_DEVICE, pValues);
                 nppsFree(pValues);
             };
 
@@ -250,6 +263,8 @@ namespace npp
                 Npp32u *pResult = nppsMalloc_32u(static_cast<int>(nSize));
                 NPP_ASSERT(pResult != 0);
 
+                allocated(ALLOCATION_DEVICE, pResult, nSize * sizeof(*pResult));
+
                 return pResult;
             };
 
@@ -257,6 +272,7 @@ namespace npp
             void
             Free1D(Npp32u *pValues)
             {
+                freed(ALLOCATION_DEVICE, pValues);
                 nppsFree(pValues);
             };
 
@@ -299,6 +315,8 @@ namespace npp
                 Npp32s *pResult = nppsMalloc_32s(static_cast<int>(nSize));
                 NPP_ASSERT(pResult != 0);
 
+                allocated(ALLOCATION_DEVICE, pResult, nSize * sizeof(*pResult));
+
                 return pResult;
             };
 
@@ -306,6 +324,7 @@ namespace npp
             void
             Free1D(Npp32s *pValues)
             {
+                freed(ALLOCATION_DEVICE, pValues);
                 nppsFree(pValues);
             };
 
@@ -348,6 +367,8 @@ namespace npp
                 Npp32sc *pResult = nppsMalloc_32sc(static_cast<int>(nSize));
                 NPP_ASSERT(pResult != 0);
 
+                allocated(ALLOCATION_DEVICE, pResult, nSize * sizeof(*pResult));
+
                 return pResult;
             };
 
@@ -355,6 +376,7 @@ namespace npp
             void
             Free1D(Npp32sc *pValues)
             {
+                freed(ALLOCATION_DEVICE, pValues);
                 nppsFree(pValues);
             };
 
@@ -397,6 +419,8 @@ namespace npp
                 Npp32f *pResult = nppsMalloc_32f(static_cast<int>(nSize));
                 NPP_ASSERT(pResult != 0);
 
+                allocated(ALLOCATION_DEVICE, pResult, nSize * sizeof(*pResult));
+
                 return pResult;
             };
 
@@ -404,6 +428,7 @@ namespace npp
             void
             Free1D(Npp32f *pValues)
             {
+                freed(ALLOCATION_DEVICE, pValues);
                 nppsFree(pValues);
             };
 
@@ -446,6 +471,8 @@ namespace npp
                 Npp32fc *pResult = nppsMalloc_32fc(static_cast<int>(nSize));
                 NPP_ASSERT(pResult != 0);
 
+                allocated(ALLOCATION_DEVICE, pResult, nSize * sizeof(*pResult));
+
                 return pResult;
             };
 
@@ -453,6 +480,7 @@ namespace npp
             void
             Free1D(Npp32fc *pValues)
             {
+                freed(ALLOCATION_DEVICE, pValues);
                 nppsFree(pValues);
             };
 
@@ -495,6 +523,8 @@ namespace npp
                 Npp64s *pResult = nppsMalloc_64s(static_cast<int>(nSize));
                 NPP_ASSERT(pResult != 0);
 
+                allocated(ALLOCATION_DEVICE, pResult, nSize * sizeof(*pResult));
+
                 return pResult;
             };
 
@@ -502,6 +532,7 @@ namespace npp
             void
             Free1D(Npp64s *pValues)
             {
+                freed(ALLOCATION_DEVICE, pValues);
                 nppsFree(pValues);
             };
 
@@ -544,6 +575,8 @@ namespace npp
                 Npp64sc *pResult = nppsMalloc_64sc(static_cast<int>(nSize));
                 NPP_ASSERT(pResult != 0);
 
+                allocated(ALLOCATION_DEVICE, pResult, nSize * sizeof(*pResult));
+
                 return pResult;
             };
 
@@ -551,6 +584,7 @@ namespace npp
             void
             Free1D(Npp64sc *pValues)
             {
+                freed(ALLOCATION_DEVICE, pValues);
                 nppsFree(pValues);
             };
 
@@ -593,6 +627,8 @@ namespace npp
                 Npp64f *pResult = nppsMalloc_64f(static_cast<int>(nSize));
                 NPP_ASSERT(pResult != 0);
 
+                allocated(ALLOCATION_DEVICE, pResult, nSize * sizeof(*pResult));
+
                 return pResult;
             };
 
@@ -600,6 +636,7 @@ namespace npp
             void
             Free1D(Npp64f *pValues)
             {
+                freed(ALLOCATION_DEVICE, pValues);
                 nppsFree(pValues);
             };
 
@@ -642,6 +679,8 @@ namespace npp
                 Npp64fc *pResult = nppsMalloc_64fc(static_cast<int>(nSize));
                 NPP_ASSERT(pResult != 0);
 
+                allocated(ALLOCATION_DEVICE, pResult, nSize * sizeof(*pResult));
+
                 return pResult;
             };
 
@@ -649,6 +688,7 @@ namespace npp
             void
             Free1D(Npp64fc *pValues)
             {
+                freed(ALLOCATION_DEVICE, pValues);
                 nppsFree(pValues);
             };
 
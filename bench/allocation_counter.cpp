@@ -0,0 +1,75 @@
+/**
+ * @file
+ * @brief Allocation counter - Heap and image allocations of a section of the benchmark
+ * See allocation_counter.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <AllocationHooks.h>
+
+#include "allocation_counter.h"
+
+using namespace std;
+
+/** Allocations are counted while set */
+static atomic<bool> counting(false);
+static atomic<long long> heapAllocations(0);
+static atomic<long long> imageAllocations(0);
+/** Hook installed before startAllocationCount() */
+static npp::AllocationHook previousHook = nullptr;
+
+void *operator new(size_t size)
+{
+    if (counting.load(memory_order_relaxed))
+    {
+        heapAllocations.fetch_add(1, memory_order_relaxed);
+    }
+    void *p = malloc(size ? size : 1);
+    if (!p)
+    {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+/**
+ * @brief Allocation hook of the images and signals, counts the allocations (not the frees)
+ */
+static void countImageAllocation(npp::AllocationPool pool, const void *data, size_t bytes)
+{
+    if (bytes > 0 && counting.load(memory_order_relaxed))
+    {
+        imageAllocations.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+void startAllocationCount()
+{
+    previousHook = npp::allocationHook();
+    npp::allocationHook() = countImageAllocation;
+    heapAllocations = 0;
+    imageAllocations = 0;
+    counting = true;
+}
+
+AllocationCount stopAllocationCount()
+{
+    counting = false;
+    npp::allocationHook() = previousHook;
+    return {heapAllocations.load(), imageAllocations.load()};
+}
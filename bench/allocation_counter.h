@@ -0,0 +1,37 @@
+/**
+ * @file
+ * @brief Allocation counter - Heap and image allocations of a section of the benchmark
+ * Replaces the global operator new of the benchmark, so that it counts every
+ * heap allocation (std::vector, std::function, std::string, ...) while
+ * counting, and installs the allocation hook of the images and signals.
+ * Kept in its own translation unit: the replaced operators are not inlined
+ * into the code they count.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+/**
+ * @brief Allocations counted between startAllocationCount() and stopAllocationCount(), on every thread
+ */
+typedef struct {
+    /** Calls of operator new */
+    long long heap;
+    /** Image and signal allocations */
+    long long images;
+} AllocationCount;
+
+/**
+ * @brief Starts counting, from zero
+ */
+void startAllocationCount();
+
+/**
+ * @brief Stops counting
+ * @return Allocations since startAllocationCount()
+ */
+AllocationCount stopAllocationCount();
+
+#endif
@@ -0,0 +1,1321 @@
+/**
+ * @file
+ * @brief ASCII Art benchmark - Times every stage on the bundled test images
+ * Measures decode, the planar split of color pixels, upload, each of the ten
+ * filters, resize at several ratios, download, quantize and write on the .pgm
+ * images of data/ and the .raw
+ * images of Common/data/, and reports the median time, ns/pixel and GB/s of
+ * each one next to the memory bandwidth measured on the same machine (copy
+ * baseline).
+ * --save-baseline=dir stores the times (median and MAD of every stage) and the
+ * reference outputs (filtered images and ASCII art). --compare=dir runs again,
+ * fails on stages slower than the noise of both runs allows and on outputs
+ * that changed by a single byte.
+ * Every run also checks that a second library render of the same image
+ * allocates nothing (operator new and image allocations).
+ * --scaling times the same stages on synthetic images of growing sizes, and
+ * the threaded host stages with growing thread counts, to show where caches
+ * and memory bandwidth saturate. --generate writes synthetic images to files.
+ * --save-reference=dir stores the NPP outputs of every filter and of the cubic
+ * resize (needs a GPU), --equivalence=dir compares the host fixed point filter
+ * and resize with them (host only), and reports the pixels that differ and the
+ * largest difference, accepted up to --max-difference=n grey levels (default 0).
+ * Usage: bench [--repeat=n] [--save-baseline=dir | --compare=dir [--tolerance=pct]] [image ...]
+ *        bench [--repeat=n] --scaling[=mpixels,...] [--threads=n,...]
+ *        bench --generate=WIDTHxHEIGHT[:SEED] file.pgm|file.raw ...
+ *        bench --save-reference=dir | --equivalence=dir [--max-difference=n] [image ...]
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem> // Requires c++ 17
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ImagesCPU.h>
+#include <ImagesNPP.h>
+#include <cuda_runtime.h>
+#include <helper_image.h>
+#include <helper_timer.h>
+#include <npp.h>
+
+#include "allocation_counter.h"
+#include "ascii_art.h"
+#include "color_image.h"
+#include "host_npp.h"
+#include "integral_image.h"
+#include "parallel.h"
+#include "pyramid.h"
+#include "render_context.h"
+#include "render_plan.h"
+#include "synthetic.h"
+#include "trace.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+/**
+ * @brief Bytes copied by the bandwidth baseline
+ */
+#define BENCH_BASELINE_BYTES (64 << 20)
+
+/**
+ * @brief Memory bandwidth baseline, GB/s (read + write)
+ */
+typedef struct {
+    /** Host memcpy */
+    double host;
+    /** Device to device copy */
+    double device;
+    /** Host to device copy */
+    double upload;
+    /** Device to host copy */
+    double download;
+} Bandwidth;
+
+/**
+ * @brief Baseline file, inside the baseline directory
+ */
+#define BENCH_BASELINE_FILE "baseline.txt"
+
+/**
+ * @brief A stage regresses when it is slower than the baseline median plus
+ * BENCH_NOISE_MADS scaled MADs (1.4826 MAD estimates the standard deviation)...
+ */
+#define BENCH_NOISE_MADS 3.0
+
+/**
+ * @brief ... and plus the tolerance (default 5%) and two timer ticks (1 us)
+ */
+#define BENCH_MIN_NOISE_MS 0.002
+
+/**
+ * @brief What to do with the outputs of the benchmark
+ */
+typedef enum {
+    /** Only time the stages */
+    BENCH_TIME,
+    /** Save the times and the outputs as the baseline */
+    BENCH_SAVE,
+    /** Compare the times and the outputs with the baseline */
+    BENCH_COMPARE,
+    /** Time the stages on synthetic images of several sizes and thread counts */
+    BENCH_SCALING,
+    /** Write synthetic images */
+    BENCH_GENERATE,
+    /** Save the NPP outputs as reference of the host filter and resize */
+    BENCH_SAVE_REFERENCE,
+    /** Compare the host filter and resize with the NPP reference */
+    BENCH_EQUIVALENCE
+} BenchMode;
+
+/**
+ * @brief Columns of the resized references of the equivalence check
+ */
+static const int equivalenceColumns[] = {80, 160};
+
+/**
+ * @brief Columns of the filter first / resize first comparison
+ */
+static const int orderColumns[] = {40, 80, 160};
+
+/**
+ * @brief Columns of the scaling report
+ */
+#define SCALING_COLUMNS 160
+
+/**
+ * @brief Time of a stage over several runs
+ */
+typedef struct {
+    /** Median, milliseconds */
+    double median;
+    /** Median absolute deviation, milliseconds */
+    double mad;
+} BenchTime;
+
+/**
+ * @brief Time of one stage on one image
+ */
+typedef struct {
+    /** Image name */
+    string image;
+    /** Stage name */
+    string stage;
+    /** Time */
+    BenchTime time;
+} BenchResult;
+
+/**
+ * @brief Median of a list of values
+ */
+static double median(vector<double> values)
+{
+    sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+/**
+ * @brief Median and MAD of the time of a function
+ * @param repeat Number of timed runs, after one untimed warmup run
+ * @param body Function to time. Device work must be synchronized by the caller.
+ * @return Median and MAD in milliseconds
+ */
+static BenchTime measure(int repeat, const function<void()> &body)
+{
+    StopWatchInterface *timer = nullptr;
+    sdkCreateTimer(&timer);
+
+    body();
+
+    vector<double> times;
+    for (int i = 0; i < repeat; i++)
+    {
+        sdkResetTimer(&timer);
+        sdkStartTimer(&timer);
+        body();
+        sdkStopTimer(&timer);
+        times.push_back(sdkGetTimerValue(&timer));
+    }
+    sdkDeleteTimer(&timer);
+
+    BenchTime time;
+    time.median = median(times);
+    for (double &t : times)
+    {
+        t = fabs(t - time.median);
+    }
+    time.mad = median(times);
+    return time;
+}
+
+/**
+ * @brief Measures the memory bandwidth with plain copies
+ * @param repeat Number of timed runs
+ * @return Bandwidth baseline
+ */
+static Bandwidth measureBandwidth(int repeat)
+{
+    size_t bytes = BENCH_BASELINE_BYTES;
+    vector<char> hostSrc(bytes, 1);
+    vector<char> hostDst(bytes, 0);
+    void *deviceSrc = nullptr;
+    void *deviceDst = nullptr;
+    cudaMalloc(&deviceSrc, bytes);
+    cudaMalloc(&deviceDst, bytes);
+    cudaMemset(deviceSrc, 1, bytes);
+
+    Bandwidth bw;
+    double ms = measure(repeat, [&]() { memcpy(hostDst.data(), hostSrc.data(), bytes); }).median;
+    bw.host = 2.0 * bytes / (ms * 1e6);
+    ms = measure(repeat, [&]() { cudaMemcpy(deviceDst, deviceSrc, bytes, cudaMemcpyDeviceToDevice); cudaDeviceSynchronize(); }).median;
+    bw.device = 2.0 * bytes / (ms * 1e6);
+    ms = measure(repeat, [&]() { cudaMemcpy(deviceDst, hostSrc.data(), bytes, cudaMemcpyHostToDevice); }).median;
+    bw.upload = (double)bytes / (ms * 1e6);
+    ms = measure(repeat, [&]() { cudaMemcpy(hostDst.data(), deviceSrc, bytes, cudaMemcpyDeviceToHost); }).median;
+    bw.download = (double)bytes / (ms * 1e6);
+
+    cudaFree(deviceSrc);
+    cudaFree(deviceDst);
+    return bw;
+}
+
+/**
+ * @brief Loads a raw image. The size comes from the file name (name_WIDTHxHEIGHT_8u*.raw),
+ * the number of channels from the file size. Color images are converted to gray.
+ * @param imagePath Path to the raw file
+ * @param hostImage Destination image
+ * @return true if successful, false otherwise
+ */
+static bool loadRawImage(const string &imagePath, npp::ImageCPU_8u_C1 &hostImage)
+{
+    smatch match;
+    string name = fs::path(imagePath).filename().string();
+    if (!regex_search(name, match, regex("_([0-9]+)x([0-9]+)_")))
+    {
+        cerr << "No size on the name of " << imagePath << endl;
+        return false;
+    }
+    int width = stoi(match[1]);
+    int height = stoi(match[2]);
+
+    ifstream ifs(imagePath, ios::binary);
+    vector<unsigned char> raw((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+    size_t channels = raw.size() / ((size_t)width * height);
+    if (channels < 1 || raw.size() != channels * width * height)
+    {
+        cerr << "Unexpected size of " << imagePath << endl;
+        return false;
+    }
+
+    npp::ImageCPU_8u_C1 oHost(width, height);
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char *s = &raw[(size_t)y * width * channels];
+        Npp8u *d = oHost.data(0, y);
+        for (int x = 0; x < width; x++, s += channels)
+        {
+            // BT.601 luma for color images
+            d[x] = channels >= 3 ? (Npp8u)((77 * s[0] + 150 * s[1] + 29 * s[2] + 128) >> 8) : s[0];
+        }
+    }
+    oHost.swap(hostImage);
+    return true;
+}
+
+/**
+ * @brief Loads a benchmark image, PGM (or any FreeImage format) or raw
+ */
+static bool loadBenchImage(const string &imagePath, npp::ImageCPU_8u_C1 &hostImage)
+{
+    if (fs::path(imagePath).extension() == ".raw")
+    {
+        return loadRawImage(imagePath, hostImage);
+    }
+    return loadHostImage(imagePath, hostImage);
+}
+
+/**
+ * @brief Prints one result row and keeps it
+ * @param results Results of the run
+ * @param image Image name
+ * @param stage Stage name
+ * @param time Time of the stage
+ * @param pixels Pixels processed
+ * @param bytes Bytes read and written
+ * @param baseline Bandwidth baseline of the memory the stage works on, GB/s
+ */
+static void report(vector<BenchResult> &results, const string &image, const string &stage, BenchTime time, double pixels, double bytes, double baseline)
+{
+    double ms = time.median;
+    double gbps = ms > 0 ? bytes / (ms * 1e6) : 0.0;
+    cout << left << setw(32) << image << setw(26) << stage << right << fixed
+         << setprecision(3) << setw(10) << ms << setw(10) << time.mad
+         << setprecision(2) << setw(10) << pixels / 1e6
+         << setprecision(3) << setw(12) << (pixels > 0 ? ms * 1e6 / pixels : 0.0)
+         << setprecision(2) << setw(10) << gbps
+         << setprecision(1) << setw(9) << (baseline > 0 ? 100.0 * gbps / baseline : 0.0) << "%" << endl
+         << defaultfloat;
+    results.push_back({image, stage, time});
+}
+
+/**
+ * @brief Saves an ASCII art as reference, or compares it byte for byte with the reference
+ * @param art ASCII art
+ * @param referencePath Reference file
+ * @param mode BENCH_SAVE or BENCH_COMPARE
+ * @return false if the ASCII art does not match the reference, or there is no reference
+ */
+static bool checkText(const string &art, const string &referencePath, BenchMode mode)
+{
+    if (mode == BENCH_SAVE)
+    {
+        ofstream ofs(referencePath, ios::binary);
+        ofs << art;
+        return (bool)ofs;
+    }
+
+    ifstream ifs(referencePath, ios::binary);
+    if (!ifs)
+    {
+        // Only --save-baseline creates references, a missing one fails the comparison
+        cerr << "No reference " << referencePath << ", run --save-baseline first" << endl;
+        return false;
+    }
+    string reference((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+
+    if (reference.length() != art.length() ||
+        !compareData((const unsigned char *)reference.data(), (const unsigned char *)art.data(), (unsigned int)art.length(), 0.0f, 0.0f))
+    {
+        cerr << "Output mismatch: " << referencePath << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Saves a filtered image as reference, or compares it pixel for pixel with the reference
+ * @param img Filtered image
+ * @param referencePath Reference PGM file
+ * @param mode BENCH_SAVE or BENCH_COMPARE
+ * @return false if the image does not match the reference, or there is no reference
+ */
+static bool checkImage(npp::ImageCPU_8u_C1 &img, const string &referencePath, BenchMode mode)
+{
+    if (mode == BENCH_SAVE)
+    {
+        return sdkSavePGM(referencePath.c_str(), img.data(), img.width(), img.height());
+    }
+
+    NppiSize referenceSize;
+    if (!fs::exists(referencePath) || !getImageSize(referencePath, referenceSize))
+    {
+        // Only --save-baseline creates references, a missing one fails the comparison
+        cerr << "No reference " << referencePath << ", run --save-baseline first" << endl;
+        return false;
+    }
+
+    // sdkComparePGM compares files, and does not stop on a size mismatch
+    string outputPath = (fs::temp_directory_path() / "ascii_art_bench.pgm").string();
+    bool result = referenceSize.width == (int)img.width() && referenceSize.height == (int)img.height() &&
+                  sdkSavePGM(outputPath.c_str(), img.data(), img.width(), img.height()) &&
+                  sdkComparePGM(outputPath.c_str(), referencePath.c_str(), 0.0f, 0.0f, false);
+    fs::remove(outputPath);
+
+    if (!result)
+    {
+        cerr << "Output mismatch: " << referencePath << endl;
+    }
+    return result;
+}
+
+/**
+ * @brief Checks that a render of the same image size and settings as the previous one allocates nothing
+ * @param context Render context, already used on the image
+ * @param view Image
+ * @param settings Render settings
+ * @param buffer Output buffer
+ * @param image Image name
+ * @param stage Stage name
+ * @return false if the render allocated heap memory or images
+ */
+static bool checkRenderAllocations(RenderContext &context, const ImageView &view, const RenderSettings &settings,
+                                   vector<char> &buffer, const string &image, const string &stage)
+{
+    // One render to size the buffers, then the counted one
+    context.render(view, settings, buffer.data(), buffer.size());
+
+    startAllocationCount();
+    size_t bytes = context.render(view, settings, buffer.data(), buffer.size());
+    AllocationCount count = stopAllocationCount();
+
+    bool result = bytes > 0 && count.heap == 0 && count.images == 0;
+    cout << left << setw(32) << image << setw(30) << stage << right << setw(6) << count.heap << " heap, "
+         << count.images << " image allocations  " << (result ? "ok" : "FAIL") << endl;
+    return result;
+}
+
+/**
+ * @brief Benchmarks every stage on one image
+ * @param imagePath Image path
+ * @param bw Bandwidth baseline
+ * @param repeat Number of timed runs of each stage
+ * @param mode Keep, save or compare the outputs
+ * @param baselineDir Baseline directory
+ * @param results Results of the run
+ * @param nppStreamCtx Stream context
+ * @return false on errors and output mismatches
+ */
+static bool benchImage(const string &imagePath, const Bandwidth &bw, int repeat, BenchMode mode, const string &baselineDir,
+                       vector<BenchResult> &results, const NppStreamContext &nppStreamCtx)
+{
+    string name = fs::path(imagePath).filename().string();
+    string referencePrefix = (fs::path(baselineDir) / name).string();
+    bool result = true;
+
+    npp::ImageCPU_8u_C1 oHostSrc;
+    if (!loadBenchImage(imagePath, oHostSrc))
+    {
+        return false;
+    }
+    double fileBytes = (double)fs::file_size(imagePath);
+    double srcPixels = (double)oHostSrc.width() * oHostSrc.height();
+    NppiSize oSrcSize = {(int)oHostSrc.width(), (int)oHostSrc.height()};
+
+    BenchTime time = measure(repeat, [&]() {
+        npp::ImageCPU_8u_C1 oHost;
+        loadBenchImage(imagePath, oHost);
+    });
+    report(results, name, "decode", time, srcPixels, fileBytes + srcPixels, bw.host);
+
+    // Planes of a color image made of the grey levels, checked against the channels it was made of
+    {
+        npp::ImageCPU_8u_C3 oHostColor(oHostSrc.width(), oHostSrc.height());
+        for (unsigned int y = 0; y < oHostSrc.height(); y++)
+        {
+            const Npp8u *grey = oHostSrc.data(0, y);
+            Npp8u *color = oHostColor.data(0, y);
+            for (unsigned int x = 0; x < oHostSrc.width(); x++)
+            {
+                color[3 * x] = grey[x];
+                color[3 * x + 1] = (Npp8u)(255 - grey[x]);
+                color[3 * x + 2] = (Npp8u)(grey[x] ^ 0x55);
+            }
+        }
+        npp::ImageCPU_8u_C1 oHostPlanes[3];
+        time = measure(repeat, [&]() { planarImage(oHostColor, oHostPlanes); });
+        report(results, name, "planar", time, srcPixels, 6 * srcPixels, bw.host);
+
+        for (unsigned int y = 0; y < oHostSrc.height(); y++)
+        {
+            const Npp8u *grey = oHostSrc.data(0, y);
+            for (unsigned int x = 0; x < oHostSrc.width(); x++)
+            {
+                if (oHostPlanes[0].data(0, y)[x] != grey[x] || oHostPlanes[1].data(0, y)[x] != 255 - grey[x] ||
+                    oHostPlanes[2].data(0, y)[x] != (grey[x] ^ 0x55))
+                {
+                    cerr << name << ": planar pixel " << x << "," << y << " differs from the color image" << endl;
+                    return false;
+                }
+            }
+        }
+    }
+
+    npp::ImageNPP_8u_C1 oDeviceSrc(oHostSrc);
+    time = measure(repeat, [&]() { oDeviceSrc.copyFrom(oHostSrc.data(), oHostSrc.pitch()); });
+    report(results, name, "upload", time, srcPixels, srcPixels, bw.upload);
+
+    // Every filter, (width - 2) x (height - 2) output
+    NppiSize oFilteredSize = {oSrcSize.width - 2, oSrcSize.height - 2};
+    double filteredPixels = (double)oFilteredSize.width * oFilteredSize.height;
+    for (int f = 0; f < FILTER_COUNT; f++)
+    {
+        npp::ImageNPP_8u_C1 oDeviceDst;
+        time = measure(repeat, [&]() {
+            applyConvolutionFilter(f, oDeviceSrc, oDeviceDst, nppStreamCtx);
+            cudaDeviceSynchronize();
+        });
+        report(results, name, string("filter ") + filterName(f), time, filteredPixels, srcPixels + filteredPixels, bw.device);
+
+        // Reference: 80 columns ASCII art of every filter
+        if (mode != BENCH_TIME)
+        {
+            NppiSize oArtSize = asciiArtSize(oSrcSize, oFilteredSize, 80);
+            npp::ImageNPP_8u_C1 oDeviceArt;
+            npp::ImageCPU_8u_C1 oHostArt(oArtSize.width, oArtSize.height);
+            resizeDeviceImage(oDeviceDst, oArtSize, oDeviceArt, nppStreamCtx);
+            oDeviceArt.copyTo(oHostArt.data(), oHostArt.pitch());
+
+            ostringstream oss;
+            outAsciiArt(oss, oHostArt);
+            result = checkText(oss.str(), referencePrefix + "." + filterName(f) + ".80.txt", mode) && result;
+        }
+    }
+
+    // Host fixed point filter, modeled on the NPP one
+    npp::ImageCPU_8u_C1 oHostFilteredFixed;
+    time = measure(repeat, [&]() { applyConvolutionFilter(-1, oHostSrc, oHostFilteredFixed); });
+    report(results, name, "host filter", time, filteredPixels, srcPixels + filteredPixels, bw.host);
+
+    // Default filter, resized at several ratios
+    npp::ImageNPP_8u_C1 oDeviceFiltered;
+    if (applyConvolutionFilter(-1, oDeviceSrc, oDeviceFiltered, nppStreamCtx) != NPP_NO_ERROR)
+    {
+        cerr << "Error applying filter" << endl;
+        return false;
+    }
+    for (int ratio : {2, 4, 8, 16})
+    {
+        NppiSize oDstSize = {max(1, oFilteredSize.width / ratio), max(1, oFilteredSize.height / ratio)};
+        double dstPixels = (double)oDstSize.width * oDstSize.height;
+        npp::ImageNPP_8u_C1 oDeviceDst;
+        time = measure(repeat, [&]() {
+            resizeDeviceImage(oDeviceFiltered, oDstSize, oDeviceDst, nppStreamCtx);
+            cudaDeviceSynchronize();
+        });
+        // Cubic: 4x4 source pixels for each output pixel, at most the whole source
+        report(results, name, "resize 1/" + to_string(ratio), time, dstPixels, min(filteredPixels, 16 * dstPixels) + dstPixels, bw.device);
+
+        npp::ImageCPU_8u_C1 oHostDst(oDstSize.width, oDstSize.height);
+        time = measure(repeat, [&]() { resizeHostImage(oHostFilteredFixed, oDstSize, oHostDst); });
+        report(results, name, "host resize 1/" + to_string(ratio), time, dstPixels, min(filteredPixels, 16 * dstPixels) + dstPixels, bw.host);
+    }
+
+    // Both orders end to end (filter and resize, plus the reduction of resize first), default filter
+    for (int columns : orderColumns)
+    {
+        NppiSize oArtSize = asciiArtSize(oSrcSize, oFilteredSize, columns);
+        double artPixels = (double)oArtSize.width * oArtSize.height;
+        string suffix = " " + to_string(columns);
+
+        npp::ImageNPP_8u_C1 oDeviceOrderFiltered;
+        npp::ImageNPP_8u_C1 oDeviceArt;
+        time = measure(repeat, [&]() {
+            applyConvolutionFilter(-1, oDeviceSrc, oDeviceOrderFiltered, nppStreamCtx);
+            resizeDeviceImage(oDeviceOrderFiltered, oArtSize, oDeviceArt, nppStreamCtx);
+            cudaDeviceSynchronize();
+        });
+        report(results, name, "filter-first" + suffix, time, srcPixels, srcPixels + filteredPixels + artPixels, bw.device);
+
+        npp::ImageCPU_8u_C1 oHostOrderFiltered;
+        npp::ImageCPU_8u_C1 oHostArt(oArtSize.width, oArtSize.height);
+        time = measure(repeat, [&]() {
+            applyConvolutionFilter(-1, oHostSrc, oHostOrderFiltered);
+            resizeHostImage(oHostOrderFiltered, oArtSize, oHostArt);
+        });
+        report(results, name, "host filter-first" + suffix, time, srcPixels, srcPixels + filteredPixels + artPixels, bw.host);
+
+        int reduced = reducedWidth(oSrcSize, columns);
+        if (reduced == 0)
+        {
+            continue;
+        }
+        NppiSize oReducedSize = reducedSize(oSrcSize, reduced);
+        double reducedPixels = (double)oReducedSize.width * oReducedSize.height;
+        npp::ImageCPU_8u_C1 oHostReduced(oReducedSize.width, oReducedSize.height);
+
+        time = measure(repeat, [&]() {
+            ImagePyramid pyramid;
+            pyramid.build(oHostSrc, reduced);
+            pyramid.resize(oReducedSize, oHostReduced);
+            npp::ImageNPP_8u_C1 oDeviceReduced(oHostReduced);
+            applyConvolutionFilter(-1, oDeviceReduced, oDeviceOrderFiltered, nppStreamCtx);
+            resizeDeviceImage(oDeviceOrderFiltered, oArtSize, oDeviceArt, nppStreamCtx);
+            cudaDeviceSynchronize();
+        });
+        report(results, name, "resize-first" + suffix, time, srcPixels, srcPixels + 3 * reducedPixels + artPixels, bw.device);
+
+        time = measure(repeat, [&]() {
+            ImagePyramid pyramid;
+            pyramid.build(oHostSrc, reduced);
+            pyramid.resize(oReducedSize, oHostReduced);
+            applyConvolutionFilter(-1, oHostReduced, oHostOrderFiltered);
+            resizeHostImage(oHostOrderFiltered, oArtSize, oHostArt);
+        });
+        report(results, name, "host resize-first" + suffix, time, srcPixels, srcPixels + 3 * reducedPixels + artPixels, bw.host);
+    }
+
+    // Library render on the host, 80 columns: the stages, chunks and joins it traces, with tracing
+    // built in and on (TRACE=1 builds), off, or not built in
+    {
+        RenderContext context(BACKEND_HOST);
+        RenderSettings settings = {80, -1, nullptr, SAMPLING_AREA, MODE_TEXT, 0};
+        ImageView view = {oHostSrc.data(), (int)oHostSrc.width(), (int)oHostSrc.height(), (int)oHostSrc.pitch()};
+        vector<char> buffer(RenderContext::outputSize(oSrcSize, settings));
+        NppiSize oArtSize = asciiArtSize(oSrcSize, oFilteredSize, 80);
+        double artPixels = (double)oArtSize.width * oArtSize.height;
+
+        time = measure(repeat, [&]() { context.render(view, settings, buffer.data(), buffer.size()); });
+        report(results, name, "host render 80", time, srcPixels, srcPixels + 2 * filteredPixels + artPixels, bw.host);
+#ifdef ASCIIART_TRACE
+        traceEnable();
+        time = measure(repeat, [&]() { context.render(view, settings, buffer.data(), buffer.size()); });
+        report(results, name, "host render 80 traced", time, srcPixels, srcPixels + 2 * filteredPixels + artPixels,
+               bw.host);
+
+        // Cost of one event, ns/pixel = ns/event
+        time = measure(repeat, [&]() {
+            for (int e = 0; e < TRACE_BUFFER_EVENTS; e++)
+            {
+                TRACE_SCOPE("bench", "event");
+            }
+        });
+        traceDisable();
+        report(results, name, "trace event", time, TRACE_BUFFER_EVENTS, TRACE_BUFFER_EVENTS * sizeof(long long) * 4.0,
+               bw.host);
+#endif
+
+        // Once sized, renders of the same size allocate nothing, on both backends and both samplings (the host
+        // backend has area sampling only), with the default pattern, glyphs of different lengths (row offsets)
+        // and Braille
+        RenderContext deviceContext(BACKEND_NPP);
+        const RenderSettings variants[] = {{80, -1, nullptr, SAMPLING_AREA, MODE_TEXT, 0},
+                                           {80, -1, nullptr, SAMPLING_RESIZE, MODE_TEXT, 0},
+                                           {80, -1, " \u2591\u2592\u2593\u2588", SAMPLING_AREA, MODE_TEXT, 0},
+                                           {80, -1, nullptr, SAMPLING_AREA, MODE_BRAILLE, BRAILLE_THRESHOLD}};
+        const char *suffixes[] = {" area 80", " cubic 80", " blocks 80", " braille 80"};
+        for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++)
+        {
+            buffer.resize(RenderContext::outputSize(oSrcSize, variants[v]));
+            string stage = string("render") + suffixes[v];
+            if (variants[v].sampling == SAMPLING_AREA)
+            {
+                result = checkRenderAllocations(context, view, variants[v], buffer, name, "host " + stage) && result;
+            }
+            if (deviceContext.valid())
+            {
+                result = checkRenderAllocations(deviceContext, view, variants[v], buffer, name, stage) && result;
+            }
+        }
+    }
+
+    // Quantize and write the full width ASCII art
+    npp::ImageCPU_8u_C1 oHostFiltered(oFilteredSize.width, oFilteredSize.height);
+    time = measure(repeat, [&]() { oDeviceFiltered.copyTo(oHostFiltered.data(), oHostFiltered.pitch()); });
+    report(results, name, "download", time, filteredPixels, filteredPixels, bw.download);
+
+    string art;
+    time = measure(repeat, [&]() {
+        ostringstream oss;
+        outAsciiArt(oss, oHostFiltered);
+        art = oss.str();
+    });
+    report(results, name, "quantize", time, filteredPixels, filteredPixels + art.length(), bw.host);
+
+    string outputPath = (fs::temp_directory_path() / "ascii_art_bench.txt").string();
+    time = measure(repeat, [&]() {
+        ofstream ofs(outputPath, ios::binary);
+        ofs << art;
+    });
+    report(results, name, "write", time, (double)art.length(), (double)art.length(), bw.host);
+    fs::remove(outputPath);
+
+    // Reference: default filter at full resolution, and its full width ASCII art
+    if (mode != BENCH_TIME)
+    {
+        result = checkImage(oHostFiltered, referencePrefix + ".filtered.pgm", mode) && result;
+        result = checkText(art, referencePrefix + ".full.txt", mode) && result;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Writes the times of a run as a baseline
+ * @param results Results of the run
+ * @param baselineDir Baseline directory
+ * @return true if successful, false otherwise
+ */
+static bool saveBaseline(const vector<BenchResult> &results, const string &baselineDir)
+{
+    ofstream ofs((fs::path(baselineDir) / BENCH_BASELINE_FILE).string());
+    ofs << "# image\tstage\tmedian_ms\tmad_ms" << endl
+        << setprecision(9);
+    for (const BenchResult &r : results)
+    {
+        ofs << r.image << "\t" << r.stage << "\t" << r.time.median << "\t" << r.time.mad << endl;
+    }
+    return (bool)ofs;
+}
+
+/**
+ * @brief Compares the times of a run with the baseline
+ * @param results Results of the run
+ * @param baselineDir Baseline directory
+ * @param tolerance Relative slowdown always accepted, i.e. 0.05
+ * @return Number of regressions, -1 if the baseline can not be read
+ */
+static int compareBaseline(const vector<BenchResult> &results, const string &baselineDir, double tolerance)
+{
+    string baselinePath = (fs::path(baselineDir) / BENCH_BASELINE_FILE).string();
+    ifstream ifs(baselinePath);
+    if (!ifs)
+    {
+        cerr << "Unable to read the baseline " << baselinePath << endl;
+        return -1;
+    }
+
+    vector<BenchResult> baseline;
+    string line;
+    while (getline(ifs, line))
+    {
+        istringstream iss(line);
+        BenchResult r;
+        string median, mad;
+        if (line.empty() || line[0] == '#' ||
+            !getline(iss, r.image, '\t') || !getline(iss, r.stage, '\t') || !getline(iss, median, '\t') || !getline(iss, mad))
+        {
+            continue;
+        }
+        r.time = {stod(median), stod(mad)};
+        baseline.push_back(r);
+    }
+
+    cout << endl
+         << "Comparison with " << baselinePath << ": regression when slower than median + max("
+         << BENCH_NOISE_MADS << " x 1.4826 x MAD, " << tolerance * 100 << "%)" << endl
+         << left << setw(32) << "image" << setw(26) << "stage" << right
+         << setw(12) << "baseline ms" << setw(10) << "ms" << setw(10) << "change" << "  status" << endl;
+
+    int regressions = 0;
+    for (const BenchResult &r : results)
+    {
+        auto b = find_if(baseline.begin(), baseline.end(), [&](const BenchResult &candidate) {
+            return candidate.image == r.image && candidate.stage == r.stage;
+        });
+        if (b == baseline.end())
+        {
+            continue;
+        }
+
+        // Noise of the noisier run, at least the tolerance
+        double noise = max({BENCH_NOISE_MADS * 1.4826 * max(b->time.mad, r.time.mad), tolerance * b->time.median, BENCH_MIN_NOISE_MS});
+        double change = b->time.median > 0 ? (r.time.median / b->time.median - 1.0) * 100.0 : 0.0;
+        const char *status = "ok";
+        if (r.time.median > b->time.median + noise)
+        {
+            status = "REGRESSION";
+            regressions++;
+        }
+        else if (r.time.median < b->time.median - noise)
+        {
+            status = "faster";
+        }
+
+        cout << left << setw(32) << r.image << setw(26) << r.stage << right << fixed
+             << setprecision(3) << setw(12) << b->time.median << setw(10) << r.time.median
+             << setprecision(1) << setw(9) << showpos << change << "%" << noshowpos << "  " << status << endl
+             << defaultfloat;
+    }
+
+    return regressions;
+}
+
+/**
+ * @brief Compares a host output with the NPP reference, pixel for pixel
+ * @param img Host output
+ * @param referencePath Reference PGM file
+ * @param image Image name
+ * @param stage Stage name
+ * @param maxDifference Largest difference accepted, in grey levels
+ * @return false if the reference is missing, the sizes differ or a pixel differs by more than maxDifference
+ */
+static bool compareReference(const npp::ImageCPU_8u_C1 &img, const string &referencePath, const string &image,
+                             const string &stage, int maxDifference)
+{
+    npp::ImageCPU_8u_C1 reference;
+    if (!fs::exists(referencePath) || !loadHostImage(referencePath, reference))
+    {
+        cerr << "No reference " << referencePath << endl;
+        return false;
+    }
+
+    long long mismatches = 0;
+    int largest = 0;
+    bool sameSize = reference.width() == img.width() && reference.height() == img.height();
+    for (unsigned int y = 0; sameSize && y < img.height(); y++)
+    {
+        const Npp8u *a = img.data(0, y);
+        const Npp8u *b = reference.data(0, y);
+        for (unsigned int x = 0; x < img.width(); x++)
+        {
+            int difference = abs((int)a[x] - (int)b[x]);
+            mismatches += difference != 0;
+            largest = max(largest, difference);
+        }
+    }
+
+    bool result = sameSize && largest <= maxDifference;
+    cout << left << setw(32) << image << setw(26) << stage << right
+         << setw(12) << (sameSize ? to_string(mismatches) : string("size")) << setw(10) << largest
+         << "  " << (result ? "ok" : "MISMATCH") << endl;
+    return result;
+}
+
+/**
+ * @brief Saves the NPP outputs of one image, or compares the host outputs with them
+ * @param imagePath Image path
+ * @param mode BENCH_SAVE_REFERENCE or BENCH_EQUIVALENCE
+ * @param referenceDir Reference directory
+ * @param maxDifference Largest difference accepted, in grey levels
+ * @param nppStreamCtx Stream context, only used to save
+ * @return false on errors and mismatches
+ */
+static bool equivalenceImage(const string &imagePath, BenchMode mode, const string &referenceDir, int maxDifference,
+                             const NppStreamContext &nppStreamCtx)
+{
+    string name = fs::path(imagePath).filename().string();
+    string referencePrefix = (fs::path(referenceDir) / name).string();
+    bool result = true;
+
+    npp::ImageCPU_8u_C1 oHostSrc;
+    if (!loadBenchImage(imagePath, oHostSrc))
+    {
+        return false;
+    }
+    NppiSize oSrcSize = {(int)oHostSrc.width(), (int)oHostSrc.height()};
+    NppiSize oFilteredSize = {oSrcSize.width - 2, oSrcSize.height - 2};
+
+    for (int f = 0; f < FILTER_COUNT; f++)
+    {
+        string filteredPath = referencePrefix + "." + filterName(f) + ".pgm";
+
+        if (mode == BENCH_SAVE_REFERENCE)
+        {
+            npp::ImageNPP_8u_C1 oDeviceSrc(oHostSrc);
+            npp::ImageNPP_8u_C1 oDeviceFiltered;
+            if (applyConvolutionFilter(f, oDeviceSrc, oDeviceFiltered, nppStreamCtx) != NPP_NO_ERROR)
+            {
+                cerr << "Error applying filter" << endl;
+                return false;
+            }
+            npp::ImageCPU_8u_C1 oHostFiltered(oFilteredSize.width, oFilteredSize.height);
+            oDeviceFiltered.copyTo(oHostFiltered.data(), oHostFiltered.pitch());
+            result = sdkSavePGM(filteredPath.c_str(), oHostFiltered.data(), oHostFiltered.width(), oHostFiltered.height()) && result;
+
+            for (int columns : equivalenceColumns)
+            {
+                NppiSize oArtSize = asciiArtSize(oSrcSize, oFilteredSize, columns);
+                npp::ImageNPP_8u_C1 oDeviceArt;
+                npp::ImageCPU_8u_C1 oHostArt(oArtSize.width, oArtSize.height);
+                resizeDeviceImage(oDeviceFiltered, oArtSize, oDeviceArt, nppStreamCtx);
+                oDeviceArt.copyTo(oHostArt.data(), oHostArt.pitch());
+                string resizedPath = referencePrefix + "." + filterName(f) + "." + to_string(columns) + ".pgm";
+                result = sdkSavePGM(resizedPath.c_str(), oHostArt.data(), oHostArt.width(), oHostArt.height()) && result;
+            }
+            continue;
+        }
+
+        npp::ImageCPU_8u_C1 oHostFiltered;
+        applyConvolutionFilter(f, oHostSrc, oHostFiltered);
+        result = compareReference(oHostFiltered, filteredPath, name, string("filter ") + filterName(f), maxDifference) && result;
+
+        // Resize the NPP filtered image, so a filter mismatch does not show up again here
+        npp::ImageCPU_8u_C1 oReferenceFiltered;
+        if (!fs::exists(filteredPath) || !loadHostImage(filteredPath, oReferenceFiltered))
+        {
+            continue;
+        }
+        for (int columns : equivalenceColumns)
+        {
+            NppiSize oArtSize = asciiArtSize(oSrcSize, oFilteredSize, columns);
+            npp::ImageCPU_8u_C1 oHostArt(oArtSize.width, oArtSize.height);
+            resizeHostImage(oReferenceFiltered, oArtSize, oHostArt);
+            string resizedPath = referencePrefix + "." + filterName(f) + "." + to_string(columns) + ".pgm";
+            result = compareReference(oHostArt, resizedPath, name, string("resize ") + filterName(f) + " " + to_string(columns),
+                                      maxDifference) && result;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Parses a comma separated list of numbers
+ */
+static vector<double> parseList(const string &list)
+{
+    vector<double> values;
+    stringstream ss(list);
+    string item;
+    while (getline(ss, item, ','))
+    {
+        values.push_back(stod(item));
+    }
+    return values;
+}
+
+/**
+ * @brief Prints one row of the scaling report
+ * @param size Image size
+ * @param stage Stage name
+ * @param threads Host threads, 0 for device stages
+ * @param time Time of the stage
+ * @param pixels Pixels processed
+ * @param bytes Bytes read and written
+ * @param baseline Bandwidth baseline of the memory the stage works on, GB/s
+ * @param single Median time on one thread, 0 if not threaded (no speedup, "-")
+ */
+static void reportScaling(NppiSize size, const string &stage, int threads, BenchTime time, double pixels, double bytes,
+                          double baseline, double single)
+{
+    double ms = time.median;
+    double gbps = ms > 0 ? bytes / (ms * 1e6) : 0.0;
+    cout << left << setw(14) << (to_string(size.width) + "x" + to_string(size.height)) << setw(16) << stage << right
+         << setw(8) << (threads > 0 ? to_string(threads) : string("-")) << fixed
+         << setprecision(3) << setw(11) << ms
+         << setprecision(3) << setw(10) << (pixels > 0 ? ms * 1e6 / pixels : 0.0)
+         << setprecision(2) << setw(9) << gbps
+         << setprecision(1) << setw(9) << (baseline > 0 ? 100.0 * gbps / baseline : 0.0) << "%"
+         << setprecision(2);
+    // No speedup for the stages that are not threaded
+    if (single > 0 && ms > 0)
+    {
+        cout << setw(9) << single / ms << "x";
+    }
+    else
+    {
+        cout << setw(10) << "-";
+    }
+    cout << endl
+         << defaultfloat;
+}
+
+/**
+ * @brief Times the stages on one synthetic image: the threaded host stages once for each
+ * thread count, the others once
+ * @param size Image size
+ * @param threadCounts Thread counts
+ * @param bw Bandwidth baseline
+ * @param repeat Number of timed runs of each stage
+ * @param nppStreamCtx Stream context
+ * @return false on errors
+ */
+static bool benchScaling(NppiSize size, const vector<double> &threadCounts, const Bandwidth &bw, int repeat,
+                         const NppStreamContext &nppStreamCtx)
+{
+    double pixels = (double)size.width * size.height;
+    NppiSize artSize = {SCALING_COLUMNS, max(1, (int)((double)size.height * SCALING_COLUMNS / size.width))};
+    double artPixels = (double)artSize.width * artSize.height;
+
+    npp::ImageCPU_8u_C1 oHostSrc;
+    generateImage(size, 1, oHostSrc);
+
+    // Threaded host stages
+    IntegralImage integral;
+    npp::ImageCPU_8u_C1 oHostArt(artSize.width, artSize.height);
+    npp::ImageCPU_8u_C1 oHostBlurred(size.width, size.height);
+    // Speedups are over one thread: measured first, and not reported if not requested
+    vector<int> counts(1, 1);
+    for (double t : threadCounts)
+    {
+        counts.push_back(max(1, (int)t));
+    }
+    bool singleRequested = find(counts.begin() + 1, counts.end(), 1) != counts.end();
+    double single[4] = {0, 0, 0, 0};
+    for (size_t c = 0; c < counts.size(); c++)
+    {
+        int threads = counts[c];
+        if (c > 0 && threads == 1)
+        {
+            continue;
+        }
+        bool shown = c > 0 || singleRequested;
+        setParallelThreads(threads);
+
+        BenchTime time = measure(repeat, [&]() {
+            npp::ImageCPU_8u_C1 oHost;
+            generateImage(size, 1, oHost);
+        });
+        single[0] = threads == 1 ? time.median : single[0];
+        if (shown)
+        {
+            reportScaling(size, "generate", threads, time, pixels, pixels, bw.host, single[0]);
+        }
+
+        // 32 bit sums: read 1, write 4 bytes per pixel
+        time = measure(repeat, [&]() { integral.build(oHostSrc); });
+        single[1] = threads == 1 ? time.median : single[1];
+        if (shown)
+        {
+            reportScaling(size, "integral", threads, time, pixels, 5 * pixels, bw.host, single[1]);
+        }
+
+        // 4 lookups per character cell
+        time = measure(repeat, [&]() { areaSample(integral, oHostArt); });
+        single[2] = threads == 1 ? time.median : single[2];
+        if (shown)
+        {
+            reportScaling(size, "area sample", threads, time, artPixels, 17 * artPixels, bw.host, single[2]);
+        }
+
+        // 4 lookups per pixel, mostly from the cache
+        time = measure(repeat, [&]() { boxBlur(integral, 2, oHostBlurred); });
+        single[3] = threads == 1 ? time.median : single[3];
+        if (shown)
+        {
+            reportScaling(size, "box blur", threads, time, pixels, 5 * pixels, bw.host, single[3]);
+        }
+    }
+    setParallelThreads(0);
+
+    // Single threaded host stages and device stages
+    BenchTime time = measure(repeat, [&]() {
+        ImagePyramid pyramid;
+        pyramid.build(oHostSrc, SCALING_COLUMNS);
+    });
+    reportScaling(size, "pyramid", 1, time, pixels, pixels + pixels / 4, bw.host, 0);
+
+    npp::ImageNPP_8u_C1 oDeviceSrc(oHostSrc);
+    time = measure(repeat, [&]() { oDeviceSrc.copyFrom(oHostSrc.data(), oHostSrc.pitch()); });
+    reportScaling(size, "upload", 0, time, pixels, pixels, bw.upload, 0);
+
+    npp::ImageNPP_8u_C1 oDeviceFiltered;
+    time = measure(repeat, [&]() {
+        applyConvolutionFilter(-1, oDeviceSrc, oDeviceFiltered, nppStreamCtx);
+        cudaDeviceSynchronize();
+    });
+    reportScaling(size, "filter", 0, time, pixels, 2 * pixels, bw.device, 0);
+    if (oDeviceFiltered.width() == 0)
+    {
+        cerr << "Error applying filter" << endl;
+        return false;
+    }
+
+    npp::ImageNPP_8u_C1 oDeviceArt;
+    time = measure(repeat, [&]() {
+        resizeDeviceImage(oDeviceFiltered, artSize, oDeviceArt, nppStreamCtx);
+        cudaDeviceSynchronize();
+    });
+    reportScaling(size, "resize", 0, time, artPixels, min(pixels, 16 * artPixels) + artPixels, bw.device, 0);
+
+    npp::ImageCPU_8u_C1 oHostFiltered(oDeviceFiltered.width(), oDeviceFiltered.height());
+    time = measure(repeat, [&]() { oDeviceFiltered.copyTo(oHostFiltered.data(), oHostFiltered.pitch()); });
+    reportScaling(size, "download", 0, time, pixels, pixels, bw.download, 0);
+
+    size_t artLength = 0;
+    time = measure(repeat, [&]() {
+        ostringstream oss;
+        outAsciiArt(oss, oHostFiltered);
+        artLength = oss.str().length();
+    });
+    reportScaling(size, "quantize", 1, time, pixels, pixels + artLength, bw.host, 0);
+    return true;
+}
+
+/**
+ * @brief Default image list: .pgm images of data/ and .raw images of Common/data/
+ */
+static vector<string> defaultImages()
+{
+    vector<string> images;
+    for (const char *dir : {"data", "Common/data"})
+    {
+        if (!fs::is_directory(dir))
+        {
+            continue;
+        }
+        for (const fs::directory_entry &entry : fs::directory_iterator(dir))
+        {
+            string extension = entry.path().extension().string();
+            if ((string(dir) == "data" && extension == ".pgm") || extension == ".raw")
+            {
+                images.push_back(entry.path().string());
+            }
+        }
+    }
+    sort(images.begin(), images.end());
+    return images;
+}
+
+int main(int argc, char *argv[])
+{
+    int repeat = 10;
+    vector<string> images;
+    BenchMode mode = BENCH_TIME;
+    string baselineDir;
+    double tolerance = 0.05;
+    int maxDifference = 0;
+    // Scaling: sizes in megapixels and thread counts
+    vector<double> sizes = {1, 4, 16, 64};
+    vector<double> threadCounts;
+    string generateSpec;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg(argv[i]);
+        if (arg.rfind("--repeat=", 0) == 0)
+        {
+            repeat = max(1, stoi(arg.substr(9)));
+        }
+        else if (arg.rfind("--save-baseline=", 0) == 0)
+        {
+            mode = BENCH_SAVE;
+            baselineDir = arg.substr(16);
+        }
+        else if (arg.rfind("--compare=", 0) == 0)
+        {
+            mode = BENCH_COMPARE;
+            baselineDir = arg.substr(10);
+        }
+        else if (arg.rfind("--tolerance=", 0) == 0)
+        {
+            tolerance = max(0.0, stod(arg.substr(12)) / 100.0);
+        }
+        else if (arg == "--scaling" || arg.rfind("--scaling=", 0) == 0)
+        {
+            mode = BENCH_SCALING;
+            if (arg.length() > 10)
+            {
+                sizes = parseList(arg.substr(10));
+            }
+        }
+        else if (arg.rfind("--threads=", 0) == 0)
+        {
+            threadCounts = parseList(arg.substr(10));
+        }
+        else if (arg.rfind("--generate=", 0) == 0)
+        {
+            mode = BENCH_GENERATE;
+            generateSpec = SYNTHETIC_PREFIX + arg.substr(11);
+        }
+        else if (arg.rfind("--save-reference=", 0) == 0)
+        {
+            mode = BENCH_SAVE_REFERENCE;
+            baselineDir = arg.substr(17);
+        }
+        else if (arg.rfind("--equivalence=", 0) == 0)
+        {
+            mode = BENCH_EQUIVALENCE;
+            baselineDir = arg.substr(14);
+        }
+        else if (arg.rfind("--max-difference=", 0) == 0)
+        {
+            maxDifference = max(0, stoi(arg.substr(17)));
+        }
+        else if (arg.rfind("--", 0) == 0)
+        {
+            cerr << "Usage: " << argv[0] << " [--repeat=n] [--save-baseline=dir | --compare=dir [--tolerance=pct]] [image ...]" << endl
+                 << "       " << argv[0] << " [--repeat=n] --scaling[=mpixels,...] [--threads=n,...]" << endl
+                 << "       " << argv[0] << " --generate=WIDTHxHEIGHT[:SEED] file.pgm|file.raw ..." << endl
+                 << "       " << argv[0] << " --save-reference=dir | --equivalence=dir [--max-difference=n] [image ...]" << endl;
+            return EXIT_FAILURE;
+        }
+        else
+        {
+            images.push_back(arg);
+        }
+    }
+
+    if (mode == BENCH_GENERATE)
+    {
+        NppiSize size;
+        unsigned int seed;
+        if (!parseSyntheticImage(generateSpec, size, seed) || images.empty())
+        {
+            cerr << "Expected --generate=WIDTHxHEIGHT[:SEED] and output files" << endl;
+            return EXIT_FAILURE;
+        }
+        npp::ImageCPU_8u_C1 img;
+        generateImage(size, seed, img);
+        for (const string &path : images)
+        {
+            if (!writeImage(img, path))
+            {
+                cerr << "Unable to write " << path << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (images.empty())
+    {
+        images = defaultImages();
+    }
+    if (images.empty())
+    {
+        cerr << "No images found, run from the project directory or pass the images" << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (mode == BENCH_SAVE || mode == BENCH_SAVE_REFERENCE)
+    {
+        fs::create_directories(baselineDir);
+    }
+
+    // The host outputs are compared with the stored NPP outputs, no device needed
+    NppStreamContext nppStreamCtx = {};
+    if (mode != BENCH_EQUIVALENCE && getStreamContext(nppStreamCtx) != NPP_SUCCESS)
+    {
+        cerr << "Unable to get NPP stream context" << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (mode == BENCH_SAVE_REFERENCE || mode == BENCH_EQUIVALENCE)
+    {
+        if (mode == BENCH_EQUIVALENCE)
+        {
+            if (!fs::is_directory(baselineDir))
+            {
+                cerr << "No NPP references in " << baselineDir << ": save them with --save-reference on a machine with a GPU"
+                     << endl;
+                return EXIT_FAILURE;
+            }
+            cout << left << setw(32) << "image" << setw(26) << "stage" << right
+                 << setw(12) << "mismatches" << setw(10) << "max diff" << "  status" << endl;
+        }
+        bool result = true;
+        for (const string &image : images)
+        {
+            try
+            {
+                result = equivalenceImage(image, mode, baselineDir, maxDifference, nppStreamCtx) && result;
+            }
+            catch (npp::Exception &ex)
+            {
+                cerr << image << ": " << ex.message() << endl;
+                result = false;
+            }
+        }
+        if (!result)
+        {
+            cerr << (mode == BENCH_EQUIVALENCE ? "Host and NPP outputs differ" : "Unable to save the reference") << endl;
+        }
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    Bandwidth bw = measureBandwidth(repeat);
+    cout << fixed << setprecision(2)
+         << "Bandwidth baseline (" << (BENCH_BASELINE_BYTES >> 20) << " MB copies, read + write): host " << bw.host
+         << " GB/s, device " << bw.device << " GB/s, upload " << bw.upload
+         << " GB/s, download " << bw.download << " GB/s" << endl
+         << "Median and MAD of " << repeat << " runs. % = GB/s over the baseline of the memory the stage works on." << endl
+         << defaultfloat << endl;
+
+    if (mode == BENCH_SCALING)
+    {
+        // 1, 2, 4 ... threads, and the hardware threads
+        if (threadCounts.empty())
+        {
+            for (int t = 1; t < parallelThreads(); t *= 2)
+            {
+                threadCounts.push_back(t);
+            }
+            threadCounts.push_back(parallelThreads());
+        }
+
+        cout << left << setw(14) << "size" << setw(16) << "stage" << right << setw(8) << "threads"
+             << setw(11) << "ms" << setw(10) << "ns/pixel" << setw(9) << "GB/s" << setw(10) << "baseline"
+             << setw(10) << "speedup" << endl;
+        bool result = true;
+        for (double mpixels : sizes)
+        {
+            // 4:3 images
+            int width = max(4, (int)(sqrt(mpixels * 1e6 * 4 / 3) + 0.5));
+            NppiSize size = {width, max(3, width * 3 / 4)};
+            try
+            {
+                result = benchScaling(size, threadCounts, bw, repeat, nppStreamCtx) && result;
+            }
+            catch (npp::Exception &ex)
+            {
+                cerr << size.width << "x" << size.height << ": " << ex.message() << endl;
+                result = false;
+            }
+        }
+        return result ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    cout << left << setw(32) << "image" << setw(26) << "stage" << right
+         << setw(10) << "ms" << setw(10) << "MAD" << setw(10) << "Mpixels" << setw(12) << "ns/pixel"
+         << setw(10) << "GB/s" << setw(10) << "baseline" << endl;
+
+    bool result = true;
+    vector<BenchResult> results;
+    for (const string &image : images)
+    {
+        try
+        {
+            result = benchImage(image, bw, repeat, mode, baselineDir, results, nppStreamCtx) && result;
+        }
+        catch (npp::Exception &ex)
+        {
+            cerr << image << ": " << ex.message() << endl;
+            result = false;
+        }
+    }
+
+    if (mode == BENCH_SAVE && !saveBaseline(results, baselineDir))
+    {
+        cerr << "Unable to write the baseline to " << baselineDir << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (mode == BENCH_COMPARE)
+    {
+        int regressions = compareBaseline(results, baselineDir, tolerance);
+        if (regressions != 0)
+        {
+            cerr << (regressions < 0 ? string("No baseline") : to_string(regressions) + " regressions") << endl;
+            result = false;
+        }
+        if (!result)
+        {
+            cerr << "Benchmark comparison failed" << endl;
+        }
+    }
+
+    return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
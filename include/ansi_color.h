@@ -0,0 +1,143 @@
+/**
+ * @file
+ * @brief ANSI color - Colors the characters of the ASCII art with ANSI escape sequences
+ * Text mode keeps the glyph of the (filtered) grey level and sets the
+ * foreground to the mean color of the cell, sampled from the unfiltered color
+ * image. Half-block mode draws two pixels per character: the upper half block
+ * (U+2580) with the top pixel as foreground and the bottom one as background.
+ * Colors are either 256-color (xterm palette, through a 32 x 32 x 32 lookup
+ * table) or 24-bit. Color output is many times larger than plain text, so an
+ * escape is written only when the color changes along a row: runs of equal
+ * colors share one escape, blanks keep the current foreground, and half-block
+ * cells pick the glyph (blank, full, upper or lower half) that needs the fewest
+ * changes. Every row ends with a reset, so rows do not depend on each other and
+ * are encoded on separate threads (output_assembler.h).
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef ANSI_COLOR_H
+#define ANSI_COLOR_H
+
+#include <vector>
+
+#include <ImagesCPU.h>
+#include <npp.h>
+
+#include "ascii_art.h"
+#include "integral_image.h"
+#include "output_assembler.h"
+
+using std::vector;
+
+/**
+ * @brief Colors of the characters
+ */
+typedef enum {
+    /** No escapes (original behavior) */
+    COLOR_NONE,
+    /** xterm 256-color palette */
+    COLOR_256,
+    /** 24-bit RGB */
+    COLOR_TRUECOLOR
+} ColorMode;
+
+/**
+ * @brief No color set yet (start of a row)
+ */
+#define ANSI_NO_COLOR 0xFFFFFFFFu
+
+/**
+ * @brief Channels of a color image, one integral image each, area sampled to any size
+ */
+class ColorPlanes {
+public:
+    /**
+     * @brief Builds the integral image of every channel
+     * @param planes Red, green and blue planes (color_image.h)
+     */
+    void build(const npp::ImageCPU_8u_C1 planes[3]);
+
+    /** Width of the image, 0 before build() */
+    int width() const { return integral_[0].width(); }
+
+    /** Height of the image, 0 before build() */
+    int height() const { return integral_[0].height(); }
+
+    /**
+     * @brief Mean color of every cell of an image of the given size
+     * @param size Size, in cells
+     * @param cells Red, green and blue of every cell, resized if needed
+     */
+    void sample(NppiSize size, npp::ImageCPU_8u_C1 cells[3]) const;
+
+private:
+    IntegralImage integral_[3];
+};
+
+/**
+ * @brief Encodes rows of colored characters
+ */
+class AnsiEncoder {
+public:
+    /**
+     * @param color COLOR_256 or COLOR_TRUECOLOR
+     */
+    explicit AnsiEncoder(ColorMode color);
+
+    /**
+     * @brief Encodes a row of glyphs with their foreground colors, a reset and a '\n'
+     * @param grey Grey level of every character
+     * @param rgb Red, green and blue of every character
+     * @param width Characters
+     * @param table Glyph table
+     * @param out Destination, the row is appended
+     */
+    void textRow(const Npp8u *grey, const Npp8u *const rgb[3], int width, const GlyphTable &table,
+                 vector<char> &out) const;
+
+    /**
+     * @brief Encodes a row of half blocks, a reset and a '\n'
+     * @param top Red, green and blue of the upper half of every character
+     * @param bottom Red, green and blue of the lower half of every character
+     * @param width Characters
+     * @param out Destination, the row is appended
+     */
+    void blockRow(const Npp8u *const top[3], const Npp8u *const bottom[3], int width, vector<char> &out) const;
+
+    /** Palette index (256-color) or 0xRRGGBB (24-bit) of a color */
+    Npp32u color(Npp8u r, Npp8u g, Npp8u b) const;
+
+    /** 0xRRGGBB of a value returned by color() */
+    Npp32u rgb(Npp32u c) const;
+
+private:
+
+    /** Appends one escape setting the foreground and/or background, ANSI_NO_COLOR = unchanged */
+    void appendColors(vector<char> &out, Npp32u fg, Npp32u bg) const;
+
+    ColorMode color_;
+    /** Palette index of every color, 5 bits per channel */
+    const Npp8u *palette_;
+};
+
+/**
+ * @brief Colored ASCII art: glyphs of a grey image colored by its cells, rows encoded on host threads
+ * @param grey Grey level of every character
+ * @param colors Colors of every character, same size as grey, see ColorPlanes::sample()
+ * @param asciiPattern ASCII (or UTF-8) pattern, empty = default pattern
+ * @param color COLOR_256 or COLOR_TRUECOLOR
+ * @param assembler Encoded rows, in order
+ */
+void colorAsciiArt(const npp::ImageCPU_8u_C1 &grey, const npp::ImageCPU_8u_C1 colors[3], const string &asciiPattern,
+                   ColorMode color, OutputAssembler &assembler);
+
+/**
+ * @brief Half-block art: two rows of colors per row of characters, rows encoded on host threads
+ * @param colors Colors of every half character, an even number of rows
+ * @param color COLOR_256 or COLOR_TRUECOLOR
+ * @param assembler Encoded rows, in order
+ */
+void halfBlockArt(const npp::ImageCPU_8u_C1 colors[3], ColorMode color, OutputAssembler &assembler);
+
+#endif
@@ -11,6 +11,7 @@
  #include <iostream>
 #include <tuple>
 #include <string>
+#include <vector>
 
 #include <ImagesCPU.h>
 #include <ImagesNPP.h>
@@ -18,6 +19,28 @@
 using std::tuple;
 using std::string;
 using std::ostream;
+using std::vector;
+
+/**
+ * @brief Bytes of a padded glyph: the longest UTF-8 sequence
+ */
+#define GLYPH_BYTES 4
+
+/**
+ * @brief Glyph of every grey level, decoded once from an ASCII (or UTF-8) pattern
+ */
+typedef struct {
+    /** UTF-8 bytes of every glyph, zero padded to GLYPH_BYTES */
+    Npp32u glyphs[256];
+    /** Bytes of every glyph, 1 to GLYPH_BYTES */
+    Npp8u lengths[256];
+    /** First byte of every glyph, the whole glyph when fixedLength is 1 */
+    char ascii[256];
+    /** Bytes of every glyph when all of them have the same length, 0 otherwise */
+    int fixedLength;
+    /** Bytes of the longest glyph */
+    int maxLength;
+} GlyphTable;
 
 
 /**
@@ -39,9 +62,29 @@ NppStatus getStreamContext(NppStreamContext &nppStreamCtx, cudaStream_t stream =
  * @param imagePath Path to the image file
  * @param hostImage Reference to the destination host image
  * @param deviceImage Reference to the destination device image
+ * @param colorPlanes If not null, receives the red, green and blue planes (3 images) on host
  * @return true if the image is found and loaded into host and device, false otherwise
  */
-bool getCPUandDeviceImage(const string &imagePath, npp::ImageCPU_8u_C1 &hostImage, npp::ImageNPP_8u_C1 &deviceImage);
+bool getCPUandDeviceImage(const string &imagePath, npp::ImageCPU_8u_C1 &hostImage, npp::ImageNPP_8u_C1 &deviceImage,
+                          npp::ImageCPU_8u_C1 *colorPlanes = nullptr);
+
+/**
+ * @brief Loads a 8-bit single channel image into host memory. Color images are converted to their luma
+ * while they are decoded (color_image.h).
+ * @param imagePath Path to the image file
+ * @param hostImage Reference to the destination host image
+ * @param colorPlanes If not null, receives the red, green and blue planes (3 images), grey images: R = G = B
+ * @return true if the image is found and decoded, false otherwise
+ */
+bool loadHostImage(const string &imagePath, npp::ImageCPU_8u_C1 &hostImage, npp::ImageCPU_8u_C1 *colorPlanes = nullptr);
+
+/**
+ * @brief Reads the size of an image without decoding its pixels
+ * @param imagePath Path to the image file
+ * @param size Reference to the image size
+ * @return true if the image header could be read, false otherwise
+ */
+bool getImageSize(const string &imagePath, NppiSize &size);
 
 /**
  * @brief Resizes an 8-bit single channel image
@@ -49,8 +92,9 @@ bool getCPUandDeviceImage(const string &imagePath, npp::ImageCPU_8u_C1 &hostImag
  * @param dstSize Destination image size
  * @param dst Destination image reference
  * @param nppStreamCtx Stream context (required on 12.9)
+ * @param eInterpolation NPP interpolation mode. NPPI_INTER_SUPER (area average) only reduces.
  */
-NppStatus resizeDeviceImage(npp::ImageNPP_8u_C1 &src, NppiSize dstSize, npp::ImageNPP_8u_C1 &dst, const NppStreamContext &nppStreamCtx);
+NppStatus resizeDeviceImage(npp::ImageNPP_8u_C1 &src, NppiSize dstSize, npp::ImageNPP_8u_C1 &dst, const NppStreamContext &nppStreamCtx, int eInterpolation = NPPI_INTER_CUBIC);
 
 /**
  * @brief Sends an ASCII representation of the device image to a stream
@@ -74,14 +118,155 @@ ostream &outAsciiArt(ostream &out, npp::ImageNPP_8u_C1 &img, int filter = -1, st
  */
 NppStatus convolutionFilter(npp::ImageNPP_8u_C1 &src,
                             npp::ImageNPP_8u_C1 &dst,
-                            Npp32s *kernel,
+                            const Npp32s *kernel,
                             NppiSize kernelSize,
                             NppiPoint anchor,
                             Npp32s divisor,
                             const NppStreamContext &nppStreamCtx);
 
+/**
+ * @brief Available filters. Feel free to add more!
+ */
+typedef enum {
+    SOBEL_X,
+    SOBEL_Y,
+    SCHARR_X,
+    SCHARR_Y,
+    SCHARR_X_IMPROVED,
+    SCHARR_Y_IMPROVED,
+    KAYALI_X,
+    KAYALI_Y,
+    PREWITT_X,
+    PREWITT_Y,
+    FILTER_COUNT
+}ConvolutionFilter;
+
+/**
+ * @brief 3x3 kernels of the available filters, indexed by ConvolutionFilter.
+ * Stored in NPP order (mirrored), divisor = 1.
+ */
+extern const Npp32s filterKernels[FILTER_COUNT][9];
+
+/**
+ * @brief Maps a filter number to the filter that is actually applied
+ * @param filter Filter number, out of range values select the default filter (Prewitt X)
+ * @return Filter in [0, FILTER_COUNT)
+ */
+int effectiveFilter(int filter);
 
+/**
+ * @brief Short name of a filter, suitable for file names
+ * @param filter Filter number, out of range values select the default filter
+ * @return Filter name, e.g. "kayali_x"
+ */
+const char *filterName(int filter);
+
+/**
+ * @brief Applies the selected convolution filter
+ * @param filter number
+ * @param src Source image on device
+ * @param dst Reference to destination image where result is stored
+ * @param nppStreamCtx Stream context (required on 12.9)
+ * @return NPP_NO_ERROR on success, npp error otherwise.
+ */
+NppStatus applyConvolutionFilter(int filter,
+    npp::ImageNPP_8u_C1 &src,
+    npp::ImageNPP_8u_C1 &dst,
+    const NppStreamContext &nppStreamCtx);
 
+/**
+ * @brief Sends an ASCII representation of a host image to a stream
+ * @param out Output stream to send the ASCII representation
+ * @param img Host image
+ * @param asciiPattern ASCII (or UTF-8) pattern to interpret grey intensity. First glyph is black, last is white.
+ * @return Reference to the updated output stream
+ */
+ostream &outAsciiArt(ostream &out, const npp::ImageCPU_8u_C1 &img, string asciiPattern = "");
+
+/**
+ * @brief Character of every grey level for a single byte pattern, see glyphTable() for UTF-8 patterns
+ * @param asciiPattern ASCII pattern, [0] is black, last is white. nullptr or empty = default pattern.
+ * @param table Destination table, indexed by grey level
+ */
+void asciiPatternTable(const char *asciiPattern, char table[256]);
+
+/**
+ * @brief Glyph of every grey level for a pattern. The pattern is decoded as UTF-8, so
+ * block elements and other multi-byte characters (" ░▒▓█") are one glyph each. Bytes
+ * that are not part of a valid UTF-8 sequence are glyphs of their own.
+ * @param asciiPattern Pattern, first glyph is black, last is white. nullptr or empty = default pattern.
+ * @param table Destination table
+ */
+void glyphTable(const char *asciiPattern, GlyphTable &table);
+
+/**
+ * @brief Encodes a row of pixels as glyphs
+ * @param src Source row
+ * @param width Width
+ * @param table Glyph table
+ * @param dst Destination, at least width * table.maxLength bytes, only the returned bytes are written
+ * @return Bytes written
+ */
+int encodeGlyphRow(const Npp8u *src, int width, const GlyphTable &table, char *dst);
+
+/**
+ * @brief Bytes of the ASCII art of a host image, and the offset of every row when the glyphs
+ * have different lengths: exclusive prefix sum of the row lengths, measured on host threads.
+ * @param pSrc First source row
+ * @param nSrcStep Bytes from one source row to the next
+ * @param size Image size
+ * @param table Glyph table
+ * @param offsets Offset of every row and the total (height + 1), empty when every glyph has the same length
+ * @return Bytes of the ASCII art, a '\n' after each row
+ */
+size_t asciiArtOffsets(const Npp8u *pSrc, int nSrcStep, NppiSize size, const GlyphTable &table,
+                       vector<size_t> &offsets);
+
+/**
+ * @brief Bytes and row offsets of the ASCII art, as above, with the sums of the chunks of rows kept by the caller
+ * @param pSrc First source row
+ * @param nSrcStep Bytes from one source row to the next
+ * @param size Image size
+ * @param table Glyph table
+ * @param offsets Offset of every row and the total (height + 1), empty when every glyph has the same length
+ * @param chunkBytes Bytes of every chunk of rows, kept from one call to the next
+ * @return Bytes of the ASCII art, a '\n' after each row
+ */
+size_t asciiArtOffsets(const Npp8u *pSrc, int nSrcStep, NppiSize size, const GlyphTable &table,
+                       vector<size_t> &offsets, vector<size_t> &chunkBytes);
+
+/**
+ * @brief Quantizes the rows of a host image into a buffer, on host threads. Each row is
+ * written at its final offset: its glyphs and a '\n', row y at offsets[y], or at
+ * y * (width * fixedLength + 1) when every glyph has the same length.
+ * @param pSrc First source row
+ * @param nSrcStep Bytes from one source row to the next
+ * @param size Image size
+ * @param table Glyph table
+ * @param offsets Row offsets given by asciiArtOffsets()
+ * @param out Destination, as many bytes as returned by asciiArtOffsets()
+ */
+void quantizeAsciiArt(const Npp8u *pSrc, int nSrcStep, NppiSize size, const GlyphTable &table,
+                      const vector<size_t> &offsets, char *out);
+
+/**
+ * @brief Calculates the size of the ASCII art (in characters) for a filtered image
+ * @param srcSize Size of the source image
+ * @param filteredSize Size of the filtered image
+ * @param outColumns Requested width. 0 = original width, outColumns < 0: abs(outColumns)
+ * @return Size of the image to quantize. Equal to filteredSize when no resize is needed.
+ */
+NppiSize asciiArtSize(NppiSize srcSize, NppiSize filteredSize, int outColumns);
+
+/**
+ * @brief Image ASCII Art. Transforms an 8-bit gray image to ASCII art
+ * @param imagePath Image path
+ * @param outColumns Width of the ASCII art, defaults to 80. 0 = no resize, outColumns < 0: Resize to abs(outColumns)
+ * @param filter Edge detection filter
+ * @param asciiPattern ASCII pattern to interpret grey intensity. [0] is black, [.length() - 1] is white.
+ * @return true if successful, false otherwise.
+ */
+bool imageASCIIArt(const string &imagePath, int outColumns = 80, int filter = -1, string asciiPattern = "");
 
 #endif
 
@@ -0,0 +1,74 @@
+/**
+ * @file
+ * @brief Braille - 2 x 4 dots per character
+ * Unicode Braille patterns (U+2800 - U+28FF) draw a 2 x 4 dot matrix in one
+ * character: eight times the detail of a grey level per character, for 3
+ * bytes of UTF-8. The image is resized to 2 x 4 pixels per character, every
+ * pixel is thresholded (or dithered) to a dot, and the 8 dots of a cell are
+ * packed into one byte, the offset of its glyph. The cells are an 8 bit image
+ * quantized as any other, with braillePattern(): its 256 glyphs map every
+ * grey level to itself.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef BRAILLE_H
+#define BRAILLE_H
+
+#include <string>
+#include <vector>
+
+#include <ImagesCPU.h>
+#include <npp.h>
+
+using std::string;
+
+/**
+ * @brief Dots of a character, horizontally and vertically
+ */
+#define BRAILLE_CELL_WIDTH 2
+#define BRAILLE_CELL_HEIGHT 4
+
+/**
+ * @brief Default threshold of a dot
+ */
+#define BRAILLE_THRESHOLD 128
+
+/**
+ * @brief Pattern of the 256 Braille glyphs, in the order of their dot bits
+ */
+const string &braillePattern();
+
+/**
+ * @brief Characters of an image of dots
+ * @param dotSize Size of the image, in dots (pixels)
+ * @return Size in characters, a partial cell at the right or bottom is one more character
+ */
+NppiSize brailleCellSize(NppiSize dotSize);
+
+/**
+ * @brief Threshold of every dot of a cell
+ * @param threshold Pixels at or above the threshold are dots, 0 = ordered dithering (4 x 4 Bayer matrix)
+ * @param thresholds Thresholds, [row * 4 + column % 4], row and column of the dot in the image modulo 4
+ */
+void brailleThresholds(int threshold, Npp8u thresholds[16]);
+
+/**
+ * @brief Packs the dots of every cell of an image, on host threads
+ * @param dots Image of dots, 2 x 4 pixels per character
+ * @param thresholds Thresholds given by brailleThresholds()
+ * @param cells Dot bits of every cell, resized to brailleCellSize() if needed
+ */
+void brailleCells(const npp::ImageCPU_8u_C1 &dots, const Npp8u thresholds[16], npp::ImageCPU_8u_C1 &cells);
+
+/**
+ * @brief Packs the dots of every cell, as above, with the blank row kept by the caller
+ * @param dots Image of dots, 2 x 4 pixels per character
+ * @param thresholds Thresholds given by brailleThresholds()
+ * @param cells Dot bits of every cell, resized to brailleCellSize() if needed
+ * @param blank Row of no dots, for the rows past the bottom of the image, kept from one call to the next
+ */
+void brailleCells(const npp::ImageCPU_8u_C1 &dots, const Npp8u thresholds[16], npp::ImageCPU_8u_C1 &cells,
+                  std::vector<Npp8u> &blank);
+
+#endif
@@ -0,0 +1,101 @@
+/**
+ * @file
+ * @brief Color images - Luma and planes of interleaved color pixels
+ * Color images are converted while they are decoded: each decoded row of
+ * interleaved pixels (RGB, BGR, RGBA or BGRA) is turned into its luma by a
+ * SIMD kernel (cpu_dispatch.h) in the same pass that copies it, so the filter
+ * receives a grey image and no 3 byte per pixel image is ever stored. The
+ * channels are split into planes (structure of arrays) in that pass too, only
+ * when the colors are used, so every per channel stage works on contiguous
+ * bytes of one channel, also by a SIMD kernel.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef COLOR_IMAGE_H
+#define COLOR_IMAGE_H
+
+#include <ImagesCPU.h>
+#include <npp.h>
+
+#include "cpu_dispatch.h"
+
+/**
+ * @brief Weights of the luma
+ */
+typedef enum {
+    /** 0.299 R + 0.587 G + 0.114 B (SD video, JPEG) */
+    LUMA_BT601,
+    /** 0.2126 R + 0.7152 G + 0.0722 B (HD video, sRGB) */
+    LUMA_BT709
+} LumaStandard;
+
+/**
+ * @brief Selects the weights of every conversion to luma. Default: LUMA_BT601.
+ */
+void setLumaStandard(LumaStandard standard);
+
+/**
+ * @brief Weights in use
+ */
+LumaStandard lumaStandard();
+
+/**
+ * @brief Fixed point weights of red, green and blue, LUMA_WEIGHT_BITS fractional bits, adding up to 1
+ * @param standard Weights
+ * @param weights Red, green and blue weights
+ */
+void lumaWeights(LumaStandard standard, Npp16u weights[3]);
+
+/**
+ * @brief Converts the rows of an image of interleaved pixels to luma, and optionally planes
+ * The weights and the kernels are set up once per image by begin().
+ */
+class ColorRowConverter {
+public:
+    ColorRowConverter();
+
+    /**
+     * @brief Sets up the conversion of the rows of an image, with the weights in use
+     * @param pixelBytes Bytes per pixel, 3 or 4 (the byte that is not a channel is ignored)
+     * @param offsets Byte of the red, green and blue channels in a pixel
+     */
+    void begin(int pixelBytes, const int offsets[3]);
+
+    /**
+     * @brief Luma of a row, and optionally its planes
+     * @param src Source row
+     * @param width Width in pixels
+     * @param luma Luma row
+     * @param planes Red, green and blue rows, nullptr = luma only
+     */
+    void row(const Npp8u *src, int width, Npp8u *luma, Npp8u *const *planes) const;
+
+private:
+    /** Bytes per pixel */
+    int pixelBytes_;
+    /** Byte of the red, green and blue channels */
+    int offsets_[3];
+    /** Weights in the byte order of the pixels */
+    Npp16u weights_[3];
+    /** Luma kernel */
+    LumaRowKernel lumaRow_;
+    /** Planes kernel */
+    PlanesRowKernel planesRow_;
+};
+
+/**
+ * @brief Planar layout of an interleaved RGB image, on host threads
+ * @param rgb RGB image
+ * @param planes Red, green and blue planes, resized to the size of rgb if needed
+ */
+void planarImage(const npp::ImageCPU_8u_C3 &rgb, npp::ImageCPU_8u_C1 planes[3]);
+
+/**
+ * @brief Planes of a grey image: the same plane three times
+ * @param grey Grey image
+ * @param planes Red, green and blue planes, resized to the size of grey if needed
+ */
+void greyPlanes(const npp::ImageCPU_8u_C1 &grey, npp::ImageCPU_8u_C1 planes[3]);
+
+#endif
@@ -0,0 +1,201 @@
+/**
+ * @file
+ * @brief Runtime CPU dispatch of the host SIMD kernels
+ * The CPU is probed once (cpuid), and each kernel is bound to the best variant
+ * the CPU supports: AVX-512, AVX2, SSE4.2 or the scalar reference. Every
+ * variant gives the same result as the scalar one, byte for byte. The level can
+ * be lowered for testing with the ASCIIART_CPU environment variable or --cpu
+ * (scalar, sse4.2, avx2, avx512). Variants are compiled with function target
+ * attributes (GCC, Clang), other compilers only get the scalar variants.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+#include <iostream>
+#include <string>
+
+#include <npp.h>
+
+using std::ostream;
+using std::string;
+
+/**
+ * @brief Instruction set levels, each one includes the previous ones
+ */
+typedef enum {
+    CPU_SCALAR,
+    CPU_SSE42,
+    CPU_AVX2,
+    /** AVX-512 F and BW */
+    CPU_AVX512,
+    CPU_LEVEL_COUNT
+} CpuLevel;
+
+/**
+ * @brief 3x3 filter of one row, same result as nppiFilter_8u_C1R with anchor {2, 2} and divisor 1
+ * @param row0 First source row, width + 2 pixels
+ * @param row1 Second source row
+ * @param row2 Third source row
+ * @param width Destination width
+ * @param kernel Kernel, NPP order (mirrored)
+ * @param dst Destination row
+ */
+typedef void (*Filter3x3RowKernel)(const Npp8u *row0, const Npp8u *row1, const Npp8u *row2, int width,
+                                   const Npp32s kernel[9], Npp8u *dst);
+
+/**
+ * @brief 2x reduction of one row, rounded mean of each 2x2 block
+ * @param row0 First source row, 2 * width pixels
+ * @param row1 Second source row
+ * @param width Destination width
+ * @param dst Destination row
+ */
+typedef void (*Reduce2xRowKernel)(const Npp8u *row0, const Npp8u *row1, int width, Npp8u *dst);
+
+/**
+ * @brief Cubic resize: fractional bits of the weights, and of the horizontally resized rows.
+ * Rows are stored minus CUBIC_ROW_BIAS, so the overshoot of the kernel (-32 to 287) fits 16 bits.
+ */
+#define CUBIC_WEIGHT_BITS 14
+#define CUBIC_ROW_BITS 7
+#define CUBIC_ROW_BIAS 128
+
+/**
+ * @brief Vertical pass of the cubic resize, one destination row
+ * @param rows Four horizontally resized source rows, CUBIC_ROW_BITS fractional bits, minus CUBIC_ROW_BIAS
+ * @param weights Weights of the four rows, CUBIC_WEIGHT_BITS fractional bits, adding up to 1 << CUBIC_WEIGHT_BITS
+ * @param width Destination width
+ * @param dst Destination row, rounded and saturated
+ */
+typedef void (*CubicColumnRowKernel)(const Npp16s *const rows[4], const Npp16s weights[4], int width, Npp8u *dst);
+
+/**
+ * @brief Pixels to characters through a table
+ * @param src Source row
+ * @param width Width
+ * @param table Character of every grey level
+ * @param dst Destination characters
+ */
+typedef void (*QuantizeRowKernel)(const Npp8u *src, int width, const char table[256], char *dst);
+
+/**
+ * @brief Pixels to UTF-8 glyphs of 1 to 4 bytes through a table, packed one after the other
+ * @param src Source row
+ * @param width Width
+ * @param glyphs Bytes of the glyph of every grey level, zero padded to 4 bytes
+ * @param lengths Bytes of the glyph of every grey level
+ * @param dst Destination, only the returned bytes are written
+ * @return Bytes written
+ */
+typedef int (*GlyphRowKernel)(const Npp8u *src, int width, const Npp32u glyphs[256], const Npp8u lengths[256],
+                              char *dst);
+
+/**
+ * @brief Braille cells of four rows of dots: pixels at or above their threshold are dots,
+ * the 8 dots of each 2 x 4 cell are packed into its byte (bits of U+2800 - U+28FF)
+ * @param rows Four rows of pixels
+ * @param width Width in pixels, a last odd column is the left column of a cell
+ * @param thresholds Threshold of every dot, [row * 4 + x % 4]
+ * @param dst Cells, (width + 1) / 2
+ */
+typedef void (*BrailleRowKernel)(const Npp8u *const rows[4], int width, const Npp8u thresholds[16], Npp8u *dst);
+
+/**
+ * @brief Fractional bits of the luma weights
+ */
+#define LUMA_WEIGHT_BITS 8
+
+/**
+ * @brief Luma of a row of interleaved color pixels, weighted sum of the first three bytes of each pixel, rounded
+ * @param src Source row
+ * @param width Width in pixels
+ * @param pixelBytes Bytes per pixel, 3 (RGB, BGR) or 4 (RGBA, BGRA: the fourth byte is ignored)
+ * @param weights Weights of the first three bytes of a pixel, LUMA_WEIGHT_BITS fractional bits, adding up to 1
+ * @param dst Luma row
+ */
+typedef void (*LumaRowKernel)(const Npp8u *src, int width, int pixelBytes, const Npp16u weights[3], Npp8u *dst);
+
+/**
+ * @brief Planes of a row of interleaved color pixels: each of three bytes of a pixel to its own row
+ * @param src Source row
+ * @param width Width in pixels
+ * @param pixelBytes Bytes per pixel, 3 or 4
+ * @param offsets Byte of a pixel that goes to each plane, below pixelBytes
+ * @param planes Destination rows
+ */
+typedef void (*PlanesRowKernel)(const Npp8u *src, int width, int pixelBytes, const int offsets[3],
+                                Npp8u *const planes[3]);
+
+/**
+ * @brief Kernels bound to the selected variants
+ */
+typedef struct {
+    Filter3x3RowKernel filter3x3Row;
+    Reduce2xRowKernel reduce2xRow;
+    CubicColumnRowKernel cubicColumnRow;
+    QuantizeRowKernel quantizeRow;
+    GlyphRowKernel glyphRow;
+    BrailleRowKernel brailleRow;
+    LumaRowKernel lumaRow;
+    PlanesRowKernel planesRow;
+    /** Level of the variant of each kernel */
+    CpuLevel filter3x3Level;
+    CpuLevel reduce2xLevel;
+    CpuLevel cubicColumnLevel;
+    CpuLevel quantizeLevel;
+    CpuLevel glyphLevel;
+    CpuLevel brailleLevel;
+    CpuLevel lumaLevel;
+    CpuLevel planesLevel;
+} HostKernels;
+
+/**
+ * @brief Kernels of the selected level, probes the CPU and reads ASCIIART_CPU on first use
+ */
+const HostKernels &hostKernels();
+
+/**
+ * @brief Highest level supported by this CPU
+ */
+CpuLevel detectedCpuLevel();
+
+/**
+ * @brief Selects the kernels of a level, at most the detected one
+ * @param level Level
+ * @return Level selected
+ */
+CpuLevel selectCpuLevel(CpuLevel level);
+
+/**
+ * @brief Parses a level name
+ * @return Level, CPU_LEVEL_COUNT if unknown
+ */
+CpuLevel parseCpuLevel(const string &name);
+
+/**
+ * @brief Name of a level: scalar, sse4.2, avx2, avx512
+ */
+const char *cpuLevelName(CpuLevel level);
+
+/**
+ * @brief Writes the detected level and the variant of each kernel, as a JSON object
+ */
+ostream &printDispatch(ostream &out);
+
+/**
+ * @brief Variants of every level, implemented in host_kernels.cpp. nullptr when a
+ * level has no variant of its own (the one below is used) or is not compiled.
+ */
+extern const Filter3x3RowKernel filter3x3RowVariants[CPU_LEVEL_COUNT];
+extern const Reduce2xRowKernel reduce2xRowVariants[CPU_LEVEL_COUNT];
+extern const CubicColumnRowKernel cubicColumnRowVariants[CPU_LEVEL_COUNT];
+extern const QuantizeRowKernel quantizeRowVariants[CPU_LEVEL_COUNT];
+extern const GlyphRowKernel glyphRowVariants[CPU_LEVEL_COUNT];
+extern const BrailleRowKernel brailleRowVariants[CPU_LEVEL_COUNT];
+extern const LumaRowKernel lumaRowVariants[CPU_LEVEL_COUNT];
+extern const PlanesRowKernel planesRowVariants[CPU_LEVEL_COUNT];
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ * @file
+ * @brief Host NPP - Host versions of the NPP filter and resize of the render path
+ * Integer (fixed point) arithmetic only, so every CPU and every SIMD variant
+ * gives the same bytes:
+ * - Filter: same sums, divisor and saturation as nppiFilter_8u_C1R. The sum is
+ *   divided by the divisor truncating towards zero, then saturated to 0 - 255.
+ * - Resize: cubic convolution modeled on nppiResize_8u_C1R with
+ *   NPPI_INTER_CUBIC: pixel centers mapped with (x + 0.5) * scale - 0.5,
+ *   borders replicated, a = -0.5, weights with 14 fractional bits, a
+ *   horizontal pass into 16 bit rows (7 fractional bits) and a vertical pass on
+ *   16 bit lanes, rounded to nearest and saturated. NPP does not document its
+ *   kernel or its rounding: the kernel, the weight bits and the intermediate
+ *   rounding are assumptions, not yet verified against NPP, so the host
+ *   backend does not use the resize (area sampling only) and only the
+ *   benchmark times it.
+ * bench --equivalence measures the differences from NPP outputs stored by
+ * bench --save-reference on a machine with a GPU.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef HOST_NPP_H
+#define HOST_NPP_H
+
+#include <vector>
+
+#include <ImagesCPU.h>
+#include <npp.h>
+
+using std::vector;
+
+/**
+ * @brief Taps and row buffers of a cubic resize, kept between resizes of the same sizes
+ */
+typedef struct {
+    /** Sizes the taps were computed for */
+    NppiSize srcSize;
+    NppiSize dstSize;
+    /** 4 source columns and weights of each destination column */
+    vector<int> columns;
+    vector<Npp16s> columnWeights;
+    /** 4 source rows and weights of each destination row */
+    vector<int> rows;
+    vector<Npp16s> rowWeights;
+    /** 4 horizontally resized rows of each parallel chunk */
+    vector<Npp16s> rowBuffers;
+} CubicResizeTables;
+
+/**
+ * @brief Applies a convolution filter to host memory, as nppiFilter_8u_C1R
+ * @param pSrc Source pixels
+ * @param nSrcStep Source pitch in bytes
+ * @param srcSize Source size
+ * @param pDst Destination pixels, (width - kernel width + 1) x (height - kernel height + 1)
+ * @param nDstStep Destination pitch in bytes
+ * @param kernel Convolution kernel, NPP order (mirrored)
+ * @param kernelSize Convolution kernel size
+ * @param divisor Filter divisor
+ * @return NPP_NO_ERROR on success, npp error otherwise.
+ */
+NppStatus convolutionFilter(const Npp8u *pSrc,
+                            int nSrcStep,
+                            NppiSize srcSize,
+                            Npp8u *pDst,
+                            int nDstStep,
+                            const Npp32s *kernel,
+                            NppiSize kernelSize,
+                            Npp32s divisor);
+
+/**
+ * @brief Applies a convolution filter to a host image, as nppiFilter_8u_C1R
+ * @param src Source image on host
+ * @param dst Destination image, (width - kernel width + 1) x (height - kernel height + 1),
+ * kept if it already has that size. Pixel (x, y) is computed from the source pixels (x, y) to (x + kernel width - 1, y + kernel height - 1),
+ * as the device version anchored at the bottom right corner of the kernel.
+ * @param kernel Convolution kernel, NPP order (mirrored)
+ * @param kernelSize Convolution kernel size
+ * @param divisor Filter divisor
+ * @return NPP_NO_ERROR on success, npp error otherwise.
+ */
+NppStatus convolutionFilter(const npp::ImageCPU_8u_C1 &src,
+                            npp::ImageCPU_8u_C1 &dst,
+                            const Npp32s *kernel,
+                            NppiSize kernelSize,
+                            Npp32s divisor);
+
+/**
+ * @brief Applies the selected convolution filter to a host image
+ * @param filter Filter number, out of range values select the default filter
+ * @param src Source image on host
+ * @param dst Destination image, (width - 2) x (height - 2), kept if it already has that size
+ * @return NPP_NO_ERROR on success, npp error otherwise.
+ */
+NppStatus applyConvolutionFilter(int filter, const npp::ImageCPU_8u_C1 &src, npp::ImageCPU_8u_C1 &dst);
+
+/**
+ * @brief Cubic resize of a host image, as nppiResize_8u_C1R with NPPI_INTER_CUBIC
+ * @param src Source image on host
+ * @param dstSize Destination image size
+ * @param dst Destination image, kept if it already has dstSize
+ * @return NPP_NO_ERROR on success, npp error otherwise.
+ */
+NppStatus resizeHostImage(const npp::ImageCPU_8u_C1 &src, NppiSize dstSize, npp::ImageCPU_8u_C1 &dst);
+
+/**
+ * @brief Cubic resize of host memory, as nppiResize_8u_C1R with NPPI_INTER_CUBIC
+ * @param pSrc Source pixels
+ * @param nSrcStep Source pitch in bytes
+ * @param srcSize Source size
+ * @param pDst Destination pixels
+ * @param nDstStep Destination pitch in bytes
+ * @param dstSize Destination size
+ * @param tables Taps and row buffers, recomputed only when the sizes change
+ * @return NPP_NO_ERROR on success, npp error otherwise.
+ */
+NppStatus resizeHostImage(const Npp8u *pSrc,
+                          int nSrcStep,
+                          NppiSize srcSize,
+                          Npp8u *pDst,
+                          int nDstStep,
+                          NppiSize dstSize,
+                          CubicResizeTables &tables);
+
+#endif
@@ -0,0 +1,183 @@
+/**
+ * @file
+ * @brief HTML output - The ASCII art as an HTML fragment for web pages
+ * The characters are wrapped in a <pre>, with '<', '>' and '&' escaped
+ * through a table built once per pattern. With colors, every distinct color
+ * (a foreground, or a foreground and background pair in half-block mode) gets
+ * a CSS class in a <style> before the <pre>, named by frequency: the most
+ * used colors get the shortest names (a - z, then two characters, ...), in
+ * lower case so that pages in quirks mode, where class selectors ignore the
+ * case, do not mix them up.
+ * The most used color is the one of the <pre> itself and needs no <span>;
+ * consecutive characters of any other color share one <span>, blanks extend
+ * the open span whatever its color, and attribute values are not quoted.
+ * Without colors there are no classes: the <pre> and the escaped rows are
+ * streamed band by band like text (row_stream.h).
+ * With colors the output takes two passes over the colors, both on host
+ * threads: the first counts the classes (the names depend on the counts of
+ * the whole image), the second encodes the rows (output_assembler.h), every
+ * row closing its span before the end of the line. The fragment is built in
+ * memory and written at once, since the <style> needs the classes first.
+ * Naming the classes after the palette index or the RGB value instead would
+ * allow a single streamed pass, with no class left to the <pre> and longer
+ * names: the frequency names save 9 - 12% of colored text and 7 - 21% of half
+ * blocks (sloth photo, 80 and 160 columns).
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef HTML_OUTPUT_H
+#define HTML_OUTPUT_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <ImagesCPU.h>
+#include <npp.h>
+
+#include "ansi_color.h"
+#include "ascii_art.h"
+#include "output_assembler.h"
+
+using std::string;
+using std::vector;
+
+/**
+ * @brief Format of the output
+ */
+typedef enum {
+    /** Plain text, or ANSI escapes with colors (original behavior) */
+    FORMAT_TEXT,
+    /** HTML fragment, a <pre> and the <style> of its colors */
+    FORMAT_HTML
+} OutputFormat;
+
+/**
+ * @brief Bytes of an escaped glyph: every byte of a glyph escaped to "&amp;" at most
+ */
+#define HTML_GLYPH_BYTES (5 * GLYPH_BYTES)
+
+/**
+ * @brief Escaped glyph of every grey level
+ */
+typedef struct {
+    /** Escaped UTF-8 bytes of every glyph */
+    char glyphs[256][HTML_GLYPH_BYTES];
+    /** Bytes of every escaped glyph */
+    Npp8u lengths[256];
+    /** Glyph shows no foreground: space or empty Braille cell */
+    bool blanks[256];
+} HtmlGlyphTable;
+
+/**
+ * @brief Name of an output format, as used in the options and the profile
+ */
+const char *outputFormatName(OutputFormat format);
+
+/**
+ * @brief Escapes the glyphs of a glyph table
+ * @param table Glyph table
+ * @param html Escaped glyphs
+ */
+void htmlGlyphTable(const GlyphTable &table, HtmlGlyphTable &html);
+
+/**
+ * @brief Encodes the rows of an HTML fragment
+ */
+class HtmlEncoder {
+public:
+    /**
+     * @param color COLOR_NONE, COLOR_256 or COLOR_TRUECOLOR
+     */
+    explicit HtmlEncoder(ColorMode color);
+
+    /**
+     * @brief Names the classes of the foregrounds of colored glyphs, most used first
+     * @param grey Grey level of every character
+     * @param colors Colors of every character, same size as grey
+     * @param table Escaped glyphs
+     */
+    void textClasses(const npp::ImageCPU_8u_C1 &grey, const npp::ImageCPU_8u_C1 colors[3],
+                     const HtmlGlyphTable &table);
+
+    /**
+     * @brief Names the classes of the half blocks, most used first
+     * @param colors Colors of every half character, an even number of rows
+     */
+    void blockClasses(const npp::ImageCPU_8u_C1 colors[3]);
+
+    /**
+     * @brief Appends the <style> of the classes, if any, and the opening <pre>
+     * @param halfBlocks Lines of half blocks, no space between them
+     * @param out Destination
+     */
+    void header(bool halfBlocks, string &out) const;
+
+    /**
+     * @brief Appends the closing </pre>
+     */
+    void footer(string &out) const;
+
+    /**
+     * @brief Encodes a row of glyphs, in spans of their colors, and a '\n'
+     * @param grey Grey level of every character
+     * @param rgb Red, green and blue of every character, nullptr = no colors
+     * @param width Characters
+     * @param table Escaped glyphs
+     * @param out Destination, the row is appended
+     */
+    void textRow(const Npp8u *grey, const Npp8u *const *rgb, int width, const HtmlGlyphTable &table,
+                 vector<char> &out) const;
+
+    /**
+     * @brief Encodes a row of half blocks, in spans of their colors, and a '\n'
+     * @param top Red, green and blue of the upper half of every character
+     * @param bottom Red, green and blue of the lower half of every character
+     * @param width Characters
+     * @param out Destination, the row is appended
+     */
+    void blockRow(const Npp8u *const top[3], const Npp8u *const bottom[3], int width, vector<char> &out) const;
+
+private:
+    /** Class of a foreground and background (ANSI_NO_COLOR = none), counted by textClasses() or blockClasses() */
+    int classOf(Npp32u fg, Npp32u bg) const;
+
+    /** Names the colors counted by every chunk of rows, most used first */
+    void nameClasses(vector<std::unordered_map<Npp64u, size_t>> &counts);
+
+    /** Appends the opening tag of a class, closing the open one, class 0 = the <pre>, no tag */
+    void openSpan(int cls, int &open, vector<char> &out) const;
+
+    /** Quantizes the colors, as in the ANSI output */
+    AnsiEncoder ansi_;
+    /** Class of every color, foreground << 32 | background */
+    std::unordered_map<Npp64u, int> classes_;
+    /** Color of every class */
+    vector<Npp64u> keys_;
+    /** Opening tag of every class */
+    vector<string> spans_;
+};
+
+/**
+ * @brief HTML ASCII art: glyphs of a grey image, colored by its cells, rows encoded on host threads
+ * @param grey Grey level of every character
+ * @param colors Colors of every character, same size as grey, nullptr = no colors
+ * @param asciiPattern ASCII (or UTF-8) pattern, empty = default pattern
+ * @param color COLOR_NONE, COLOR_256 or COLOR_TRUECOLOR
+ * @param assembler Encoded rows
+ * @param art HTML fragment
+ */
+void htmlAsciiArt(const npp::ImageCPU_8u_C1 &grey, const npp::ImageCPU_8u_C1 *colors, const string &asciiPattern,
+                  ColorMode color, OutputAssembler &assembler, string &art);
+
+/**
+ * @brief HTML half-block art: two rows of colors per row of characters, rows encoded on host threads
+ * @param colors Colors of every half character, an even number of rows
+ * @param color COLOR_256 or COLOR_TRUECOLOR
+ * @param assembler Encoded rows
+ * @param art HTML fragment
+ */
+void htmlHalfBlockArt(const npp::ImageCPU_8u_C1 colors[3], ColorMode color, OutputAssembler &assembler, string &art);
+
+#endif
@@ -0,0 +1,121 @@
+/**
+ * @file
+ * @brief Integral image (summed-area table) of a host image
+ * Once built, the sum, mean and variance of any rectangle cost 4 lookups,
+ * whatever its size. Used to average each character cell directly
+ * (area sampling) and as a box blur of any radius.
+ * Sums are kept on 32 bits and subtracted modulo 2^32: the table itself
+ * wraps around on large images, but the sum of any rectangle below 2^32
+ * (16843009 pixels) is exact.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef INTEGRAL_IMAGE_H
+#define INTEGRAL_IMAGE_H
+
+#include <vector>
+
+#include <ImagesCPU.h>
+#include <npp.h>
+
+using std::vector;
+
+/**
+ * @brief Summed-area table, (width + 1) x (height + 1), first row and column are zero
+ */
+class IntegralImage {
+public:
+    IntegralImage() : width_(0), height_(0) {}
+
+    /**
+     * @brief Builds the table in parallel: every band of rows is summed on its own
+     * thread reading the source once, then the bands are offset by the bands above.
+     * @param src Source image
+     * @param squares Also build the table of squares, required by variance()
+     */
+    void build(const npp::ImageCPU_8u_C1 &src, bool squares = false);
+
+    /** Width of the source image */
+    int width() const { return width_; }
+
+    /** Height of the source image */
+    int height() const { return height_; }
+
+    /**
+     * @brief Sum of the pixels of [x0, x1) x [y0, y1)
+     */
+    Npp32u sum(int x0, int y0, int x1, int y1) const
+    {
+        const Npp32u *top = &sums_[(size_t)y0 * (width_ + 1)];
+        const Npp32u *bottom = &sums_[(size_t)y1 * (width_ + 1)];
+        return bottom[x1] - bottom[x0] - top[x1] + top[x0];
+    }
+
+    /**
+     * @brief Mean of the pixels of [x0, x1) x [y0, y1), rounded
+     */
+    Npp8u mean(int x0, int y0, int x1, int y1) const
+    {
+        Npp32u area = (Npp32u)((x1 - x0) * (y1 - y0));
+        return (Npp8u)((sum(x0, y0, x1, y1) + area / 2) / area);
+    }
+
+    /**
+     * @brief Variance of the pixels of [x0, x1) x [y0, y1). Requires build(src, true).
+     */
+    float variance(int x0, int y0, int x1, int y1) const;
+
+private:
+    /** Width of the source image */
+    int width_;
+    /** Height of the source image */
+    int height_;
+    /** Sums */
+    vector<Npp32u> sums_;
+    /** Sums of squares, empty if not requested */
+    vector<Npp64u> squares_;
+    /** Carries of the bands of the tables, kept between builds */
+    vector<Npp32u> carry_;
+    vector<Npp64u> squaresCarry_;
+};
+
+/**
+ * @brief Cell boundaries of an area sampling, kept between samplings of the same sizes
+ */
+typedef struct {
+    /** Sizes the boundaries were computed for */
+    NppiSize srcSize;
+    NppiSize dstSize;
+    /** dstSize.width + 1 column boundaries */
+    vector<int> columns;
+    /** dstSize.height + 1 row boundaries */
+    vector<int> rows;
+} AreaSampleTables;
+
+/**
+ * @brief Area sampling: each destination pixel is the mean of the source cell it covers.
+ * Cell boundaries are rounded to whole source pixels, every cell has at least one pixel.
+ * @param integral Integral image of the source
+ * @param dst Destination image, allocated with the destination size
+ */
+void areaSample(const IntegralImage &integral, npp::ImageCPU_8u_C1 &dst);
+
+/**
+ * @brief Area sampling, as above, with the cell boundaries of the previous call if the sizes are the same
+ * @param integral Integral image of the source
+ * @param dst Destination image, allocated with the destination size
+ * @param tables Cell boundaries, recomputed only when the sizes change
+ */
+void areaSample(const IntegralImage &integral, npp::ImageCPU_8u_C1 &dst, AreaSampleTables &tables);
+
+/**
+ * @brief Box blur: each pixel becomes the mean of the (2 radius + 1)^2 box around it,
+ * clipped to the image borders.
+ * @param integral Integral image of the source
+ * @param radius Blur radius
+ * @param dst Destination image, same size as the source
+ */
+void boxBlur(const IntegralImage &integral, int radius, npp::ImageCPU_8u_C1 &dst);
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ * @file
+ * @brief Multi filter - Applies several 3x3 filters reading the source only once
+ * Each 3x3 neighborhood is loaded once into registers and every requested
+ * kernel is evaluated on it, writing one output plane per filter. N memory
+ * bound passes over the source become a single pass.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef MULTI_FILTER_H
+#define MULTI_FILTER_H
+
+#include <vector>
+
+#include <ImagesCPU.h>
+#include <ImagesNPP.h>
+
+#include "ascii_art.h"
+
+using std::vector;
+
+#ifdef __CUDACC__
+#define MULTI_FILTER_HOST_DEVICE __host__ __device__
+#else
+#define MULTI_FILTER_HOST_DEVICE
+#endif
+
+/**
+ * @brief Kernels and destination planes of a multi filter pass.
+ * Passed by value to the device kernel.
+ */
+typedef struct {
+    /** Number of filters */
+    int count;
+    /** Kernels, NPP order (mirrored) */
+    Npp32s kernel[FILTER_COUNT][9];
+    /** Destination planes */
+    Npp8u *data[FILTER_COUNT];
+    /** Destination pitches */
+    int pitch[FILTER_COUNT];
+} MultiFilterPlanes;
+
+/**
+ * @brief Evaluates every kernel on a 3x3 neighborhood and stores the results.
+ * Same result as nppiFilter_8u_C1R with anchor {2, 2} and divisor 1.
+ * @param p Neighborhood, row major
+ * @param planes Kernels and destination planes
+ * @param x Destination column
+ * @param y Destination row
+ */
+MULTI_FILTER_HOST_DEVICE inline void multiFilterPixel(const int p[9], const MultiFilterPlanes &planes, int x, int y)
+{
+    for (int k = 0; k < planes.count; k++)
+    {
+        const Npp32s *kernel = planes.kernel[k];
+        int sum = p[0] * kernel[8] + p[1] * kernel[7] + p[2] * kernel[6] +
+                  p[3] * kernel[5] + p[4] * kernel[4] + p[5] * kernel[3] +
+                  p[6] * kernel[2] + p[7] * kernel[1] + p[8] * kernel[0];
+        planes.data[k][y * planes.pitch[k] + x] = (Npp8u)(sum < 0 ? 0 : (sum > 255 ? 255 : sum));
+    }
+}
+
+/**
+ * @brief Applies several filters to a device image in a single pass
+ * @param src Source image on device
+ * @param filters Filters to apply (at most FILTER_COUNT)
+ * @param dst Array of destination images, one for each filter, (width - 2) x (height - 2)
+ * @param nppStreamCtx Stream context (required on 12.9)
+ * @return NPP_NO_ERROR on success, npp error otherwise.
+ */
+NppStatus multiFilter3x3(npp::ImageNPP_8u_C1 &src,
+                         const vector<int> &filters,
+                         npp::ImageNPP_8u_C1 *dst,
+                         const NppStreamContext &nppStreamCtx);
+
+/**
+ * @brief Applies several filters to a host image in a single pass
+ * @param src Source image on host
+ * @param filters Filters to apply (at most FILTER_COUNT)
+ * @param dst Array of destination images, one for each filter, (width - 2) x (height - 2)
+ * @return NPP_NO_ERROR on success, npp error otherwise.
+ */
+NppStatus multiFilter3x3(const npp::ImageCPU_8u_C1 &src,
+                         const vector<int> &filters,
+                         npp::ImageCPU_8u_C1 *dst);
+
+/**
+ * @brief Fills the kernels of a multi filter pass
+ * @param filters Filters to apply
+ * @param planes Planes to fill. Destination pointers are not modified.
+ * @return false if there are more than FILTER_COUNT filters
+ */
+bool multiFilterKernels(const vector<int> &filters, MultiFilterPlanes &planes);
+
+#endif
@@ -0,0 +1,114 @@
+/**
+ * @file
+ * @brief Output assembler - Rows encoded on host threads, put together in order
+ * Two ways to assemble the rows of an output without a lock:
+ * - OutputAssembler: each chunk of rows is encoded by one thread into its own
+ *   band buffer, the bands are then written (or copied) in order. Rows are
+ *   encoded once, whatever their length.
+ * - rowOffsets() + assembleRows(): the byte count of every row is measured
+ *   first, an exclusive prefix sum gives the final offset of each row, then
+ *   every thread encodes its rows straight at their offsets in the output.
+ *   For variable length encodings (multi-byte glyphs, color escapes) written
+ *   into one buffer, such as an output map.
+ * The output does not depend on the number of threads or chunks. The rows are
+ * passed as FunctionRef (parallel.h), which never allocates.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef OUTPUT_ASSEMBLER_H
+#define OUTPUT_ASSEMBLER_H
+
+#include <iostream>
+#include <vector>
+
+#include "parallel.h"
+
+using std::ostream;
+using std::vector;
+
+/**
+ * @brief Encodes row y at the end of a band buffer
+ */
+typedef FunctionRef<void(int y, vector<char> &band)> RowEncoder;
+
+/**
+ * @brief Bytes of row y, once encoded
+ */
+typedef FunctionRef<size_t(int y)> RowSize;
+
+/**
+ * @brief Encodes row y at out, exactly the bytes given by its RowSize
+ */
+typedef FunctionRef<void(int y, char *out)> RowWriter;
+
+/**
+ * @brief Bands of encoded rows, one per chunk, kept in row order
+ */
+class OutputAssembler {
+public:
+    OutputAssembler() : offsets_(1, 0) {}
+
+    /**
+     * @brief Encodes rows [first, first + count) on host threads, each chunk into its own band.
+     * Band buffers are kept from one call to the next.
+     * @param first First row
+     * @param count Rows
+     * @param encodeRow Row encoder, called once per row
+     * @param chunks Number of chunks, 0 = default of the parallel loops
+     */
+    void encode(int first, int count, RowEncoder encodeRow, int chunks = 0);
+
+    /**
+     * @brief Bytes of the encoded rows
+     */
+    size_t size() const { return offsets_.back(); }
+
+    /**
+     * @brief Writes the bands in order
+     * @param out Destination stream
+     * @return true if the stream is still good, false otherwise
+     */
+    bool write(ostream &out) const;
+
+    /**
+     * @brief Copies the bands in order, every band at its offset on its own thread
+     * @param out Destination, size() bytes
+     */
+    void copyTo(char *out) const;
+
+private:
+    vector<vector<char>> bands_;
+    /** Exclusive prefix sum of the band sizes, one more than the bands in use */
+    vector<size_t> offsets_;
+};
+
+/**
+ * @brief Final offset of every row: exclusive prefix sum of the row sizes, measured on host threads
+ * @param count Rows
+ * @param rowSize Row size
+ * @param offsets Offsets, count + 1: offsets[y] is the first byte of row y, offsets[count] the total
+ * @return Total bytes
+ */
+size_t rowOffsets(int count, RowSize rowSize, vector<size_t> &offsets);
+
+/**
+ * @brief Final offset of every row, as above, with the sums of the chunks kept by the caller
+ * @param count Rows
+ * @param rowSize Row size
+ * @param offsets Offsets, count + 1
+ * @param chunkBytes Bytes of every chunk, kept from one call to the next
+ * @return Total bytes
+ */
+size_t rowOffsets(int count, RowSize rowSize, vector<size_t> &offsets, vector<size_t> &chunkBytes);
+
+/**
+ * @brief Encodes every row at its offset, on host threads
+ * @param count Rows
+ * @param offsets Offsets given by rowOffsets()
+ * @param writeRow Row writer
+ * @param out Destination, offsets[count] bytes
+ */
+void assembleRows(int count, const vector<size_t> &offsets, RowWriter writeRow, char *out);
+
+#endif
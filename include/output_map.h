@@ -0,0 +1,82 @@
+/**
+ * @file
+ * @brief Output map - Memory the ASCII art is quantized into, in place
+ * The size of the output is known before quantizing, (columns + 1) x rows
+ * bytes, so the quantizer threads can write every row at its final offset:
+ * - Files are preallocated (fallocate) and mapped, the page cache is the
+ *   only copy of the text.
+ * - Standard output, when it is a pipe, gets a page aligned buffer whose
+ *   pages are gifted to the pipe with vmsplice instead of copied by write.
+ * Linux only, open() fails elsewhere and the caller falls back to streams.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef OUTPUT_MAP_H
+#define OUTPUT_MAP_H
+
+#include <cstddef>
+#include <string>
+
+using std::string;
+
+/**
+ * @brief Outputs of at least this many bytes are written through an output map
+ */
+#define OUTPUT_MAP_MIN_BYTES (1 << 20)
+
+/**
+ * @brief Destination of one ASCII art, mapped in memory
+ */
+class OutputMap {
+public:
+    OutputMap();
+    ~OutputMap();
+
+    OutputMap(const OutputMap &) = delete;
+    OutputMap &operator=(const OutputMap &) = delete;
+
+    /**
+     * @brief Maps a destination
+     * @param outputPath File path, or "-" for standard output (only when it is a pipe)
+     * @param length Output size in bytes
+     * @return true if mapped, false if the destination can not be mapped (use a stream)
+     */
+    bool open(const string &outputPath, size_t length);
+
+    /**
+     * @brief Mapped memory, length() bytes
+     */
+    char *data() const { return data_; }
+
+    size_t length() const { return length_; }
+
+    /**
+     * @brief Keeps only the first bytes of the output, when less than length() were written
+     * @param length Bytes written
+     */
+    void truncate(size_t length);
+
+    /**
+     * @brief Sends the output: unmaps (and truncates) the file, or splices the buffer into the pipe
+     * @return true if successful, false otherwise (message on cerr)
+     */
+    bool commit();
+
+private:
+    /**
+     * @brief Unmaps and closes without writing
+     */
+    void release();
+
+    char *data_;
+    size_t length_;
+    /** Bytes mapped, the length opened rounded up to whole pages */
+    size_t mapped_;
+    /** File descriptor: the file, or 1 for standard output */
+    int fd_;
+    /** Standard output pipe: splice on commit */
+    bool pipe_;
+};
+
+#endif
@@ -0,0 +1,313 @@
+/**
+ * @file
+ * @brief Parallel loops on host threads
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "profiler.h"
+
+/**
+ * @brief Settings of the parallel loops, 0 = default
+ */
+typedef struct {
+    /** Host threads, 0 = hardware threads */
+    int threads;
+    /** Rows (items) per chunk, 0 = one chunk per thread */
+    int bandRows;
+} ParallelSettings;
+
+/**
+ * @brief Current settings of the parallel loops
+ */
+inline ParallelSettings &parallelSettings()
+{
+    static ParallelSettings settings = {0, 0};
+    return settings;
+}
+
+/**
+ * @brief Sets the number of host threads used by parallel loops
+ * @param threads Number of threads, 0 = number of hardware threads
+ */
+inline void setParallelThreads(int threads)
+{
+    parallelSettings().threads = std::max(0, threads);
+}
+
+/**
+ * @brief Sets the number of items of each chunk of the parallel loops.
+ * Smaller chunks balance uneven work and keep each chunk in the cache,
+ * at the cost of more scheduling.
+ * @param rows Items per chunk, 0 = one chunk per thread
+ */
+inline void setParallelBandRows(int rows)
+{
+    parallelSettings().bandRows = std::max(0, rows);
+}
+
+/**
+ * @brief Number of host threads used by parallel loops
+ * @return Number of threads set by setParallelThreads(), or of hardware threads, at least 1
+ */
+inline int parallelThreads()
+{
+    if (parallelSettings().threads > 0)
+    {
+        return parallelSettings().threads;
+    }
+    return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+/**
+ * @brief Reference to a function or lambda, called without copying it: unlike
+ * std::function, it never allocates. Valid while the referenced callable lives,
+ * i.e. as a parameter.
+ */
+template <typename Signature>
+class FunctionRef;
+
+template <typename R, typename... Args>
+class FunctionRef<R(Args...)> {
+public:
+    template <typename F>
+    FunctionRef(const F &function)
+        : object_(&function), call_([](const void *object, Args... args) -> R {
+              return (*static_cast<const F *>(object))(args...);
+          })
+    {
+    }
+
+    R operator()(Args... args) const { return call_(object_, args...); }
+
+private:
+    const void *object_;
+    R (*call_)(const void *, Args...);
+};
+
+/**
+ * @brief Persistent worker threads, so that parallel loops do not start threads.
+ * Used by the parallel loops of the thread that installed it (ThreadPoolScope).
+ */
+class ThreadPool {
+public:
+    /**
+     * @param threads Threads of the parallel loops, including the calling thread. 0 = hardware threads.
+     */
+    explicit ThreadPool(int threads = 0)
+        : task_(nullptr), count_(0), pending_(0), generation_(0), stop_(false)
+    {
+        threads = threads > 0 ? threads : std::max(1, (int)std::thread::hardware_concurrency());
+        for (int t = 1; t < threads; t++)
+        {
+            workers_.emplace_back([this, t]() { work(t); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_.notify_all();
+        for (std::thread &worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * @brief Threads, including the calling thread
+     */
+    int threads() const { return (int)workers_.size() + 1; }
+
+    /**
+     * @brief Runs task(t) on the calling thread (t = 0) and on count - 1 workers, returns when all are done
+     * @param count Number of threads, at most threads()
+     * @param task Task
+     */
+    void run(int count, FunctionRef<void(int thread)> task)
+    {
+        count = std::max(1, std::min(count, threads()));
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task_ = &task;
+            count_ = count;
+            pending_ = count - 1;
+            generation_++;
+        }
+        start_.notify_all();
+
+        task(0);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return pending_ == 0; });
+        task_ = nullptr;
+    }
+
+private:
+    /**
+     * @brief Worker t: waits for each run, takes part if t < count
+     */
+    void work(int t)
+    {
+        unsigned long seen = 0;
+        for (;;)
+        {
+            const FunctionRef<void(int)> *task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                start_.wait(lock, [this, seen]() { return stop_ || generation_ != seen; });
+                if (stop_)
+                {
+                    return;
+                }
+                seen = generation_;
+                if (t >= count_)
+                {
+                    continue;
+                }
+                task = task_;
+            }
+
+            {
+                ProfileThread profile(t);
+                (*task)(t);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0)
+            {
+                done_.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    /** Task of the current run */
+    const FunctionRef<void(int)> *task_;
+    /** Threads of the current run */
+    int count_;
+    /** Workers of the current run still running */
+    int pending_;
+    /** Run number */
+    unsigned long generation_;
+    bool stop_;
+};
+
+/**
+ * @brief Thread pool of the parallel loops started by this thread, nullptr = start threads
+ */
+inline ThreadPool *&currentThreadPool()
+{
+    static thread_local ThreadPool *pool = nullptr;
+    return pool;
+}
+
+/**
+ * @brief Runs the parallel loops of this thread on a pool while in scope
+ */
+class ThreadPoolScope {
+public:
+    explicit ThreadPoolScope(ThreadPool &pool) : previous_(currentThreadPool())
+    {
+        currentThreadPool() = &pool;
+    }
+
+    ~ThreadPoolScope()
+    {
+        currentThreadPool() = previous_;
+    }
+
+private:
+    ThreadPool *previous_;
+};
+
+/**
+ * @brief Number of chunks of a parallel loop
+ * @param count Number of items
+ * @param chunks Requested chunks, 0 = by the band rows setting, or one per thread
+ * @return Number of chunks, between 1 and count
+ */
+inline int parallelChunks(int count, int chunks = 0)
+{
+    if (chunks <= 0)
+    {
+        int bandRows = parallelSettings().bandRows;
+        chunks = bandRows > 0 ? (count + bandRows - 1) / bandRows : parallelThreads();
+    }
+    return std::max(1, std::min(count, chunks));
+}
+
+/**
+ * @brief Splits [0, count) into contiguous chunks and runs them on host threads.
+ * Each thread takes the next chunk not yet taken, the calling thread takes part
+ * too. Worker threads are counted by the profiler as threads 1 and above.
+ * The threads come from the current thread pool if there is one, at most its size.
+ * @param count Number of items
+ * @param body Function called with the chunk index and its [begin, end) range, not copied
+ * @param chunks Number of chunks, 0 = by the band rows setting, or one per thread
+ * @return Number of chunks
+ */
+inline int parallelFor(int count, FunctionRef<void(int chunk, int begin, int end)> body, int chunks = 0)
+{
+    chunks = parallelChunks(count, chunks);
+    ThreadPool *pool = currentThreadPool();
+    int threadCount = std::min(chunks, parallelThreads());
+    if (pool)
+    {
+        threadCount = std::min(threadCount, pool->threads());
+    }
+
+    // Thread t starts with chunk t, then takes the next free one
+    std::atomic<int> next(threadCount);
+    auto run = [&](int chunk) {
+        for (; chunk < chunks; chunk = next.fetch_add(1))
+        {
+            TRACE_SCOPE("parallel", "chunk");
+            body(chunk, (int)((long long)count * chunk / chunks), (int)((long long)count * (chunk + 1) / chunks));
+        }
+    };
+
+    if (pool)
+    {
+        pool->run(threadCount, run);
+        return chunks;
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < threadCount; t++)
+    {
+        threads.emplace_back([&run, t]() {
+            ProfileThread profile(t);
+            run(t);
+        });
+    }
+    run(0);
+
+    TRACE_SCOPE("wait", "join");
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+    return chunks;
+}
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * @file
+ * @brief Hardware performance counters of the calling thread (Linux perf_event_open)
+ * Each event is opened on its own, so a host that lacks some of them (virtual
+ * machines, containers with perf_event_paranoid > 2) still reports the rest.
+ * On other systems, or when no event can be opened, every counter is invalid
+ * and the callers carry on without them.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <string>
+
+using std::string;
+
+/**
+ * @brief Counted events
+ */
+typedef enum {
+    /** CPU cycles */
+    COUNTER_CYCLES,
+    /** Retired instructions */
+    COUNTER_INSTRUCTIONS,
+    /** L1 data cache read misses */
+    COUNTER_L1D_MISSES,
+    /** Last level cache misses */
+    COUNTER_LLC_MISSES,
+    /** Mispredicted branches */
+    COUNTER_BRANCH_MISSES,
+    /** CPU time of the thread, nanoseconds (software event). Much lower than the
+     * wall time means the thread was waiting: I/O, device or other threads. */
+    COUNTER_TASK_CLOCK,
+    COUNTER_COUNT
+} PerfCounter;
+
+/**
+ * @brief Counter values, scaled when the kernel multiplexed the counters
+ */
+typedef struct {
+    /** Values */
+    double value[COUNTER_COUNT];
+} PerfSample;
+
+/**
+ * @brief Counters of one thread. Counting starts on open() and never stops,
+ * stages subtract two samples.
+ */
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    /**
+     * @brief Opens every counter on the calling thread
+     * @return true if at least one counter is available
+     */
+    bool open();
+
+    /**
+     * @brief At least one counter is open
+     */
+    bool available() const { return available_; }
+
+    /**
+     * @brief Why the first unavailable counter could not be opened, empty if all are open
+     */
+    const string &error() const { return error_; }
+
+    /**
+     * @brief Counter is open
+     */
+    bool valid(PerfCounter counter) const { return fd_[counter] >= 0; }
+
+    /**
+     * @brief Reads every open counter, invalid counters read 0
+     */
+    void read(PerfSample &sample) const;
+
+private:
+    /** One file descriptor for each counter, -1 if not available */
+    int fd_[COUNTER_COUNT];
+    /** At least one counter is open */
+    bool available_;
+    /** First open error */
+    string error_;
+};
+
+/**
+ * @brief Counters of the calling thread, opened on first use
+ * @return Counters, check available() before using them
+ */
+PerfCounters &threadPerfCounters();
+
+/**
+ * @brief Name of a counter, as used in the reports
+ */
+const char *counterName(PerfCounter counter);
+
+#endif
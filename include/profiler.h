@@ -0,0 +1,401 @@
+/**
+ * @file
+ * @brief Stage profiler - Times every stage of the pipeline
+ * Stages are timed with the SDK stop watches (helper_timer.h). Device stages
+ * synchronize the device before stopping the watch, so asynchronous NPP calls
+ * are charged to the stage that issued them. A run is one full render; after
+ * the warmup runs, the per run times of every stage are kept to report
+ * percentiles as JSON.
+ * With counters enabled, the hardware performance counters of the main thread
+ * are read around every stage, and the worker threads of the parallel loops
+ * add their own counters to the stage that was running when they started.
+ * Allocations made through the UtilNPP image and signal allocators are counted
+ * too (live and peak bytes, sizes), by stage and by run.
+ * Startup (options, tuning cache, CUDA context...) is timed from the start of
+ * main() up to the first byte of output, whether or not profiling is enabled,
+ * and reported with the runs. Each run reports its time to the first line of
+ * output, which comes early when the output is streamed (row_stream.h), and
+ * the bytes of its outputs, to compare output formats.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <AllocationHooks.h>
+#include <helper_timer.h>
+
+#include "perf_counters.h"
+#include "trace.h"
+
+using std::ostream;
+using std::string;
+using std::vector;
+
+/**
+ * @brief Pipeline stages
+ */
+typedef enum {
+    /** Check that the image exists */
+    STAGE_EXISTS,
+    /** Decode the image file */
+    STAGE_DECODE,
+    /** Host to device copies */
+    STAGE_UPLOAD,
+    /** Box blur before filtering */
+    STAGE_BLUR,
+    /** Reduction before filtering (resize first) */
+    STAGE_REDUCE,
+    /** Edge detection filters */
+    STAGE_FILTER,
+    /** Resize (or area sampling) to the ASCII art size */
+    STAGE_RESIZE,
+    /** Device to host copies */
+    STAGE_DOWNLOAD,
+    /** Pixels to characters */
+    STAGE_QUANTIZE,
+    /** Write the ASCII art to its destination */
+    STAGE_WRITE,
+    STAGE_COUNT
+} ProfileStage;
+
+/**
+ * @brief Totals of one stage on one run
+ */
+typedef struct {
+    /** Number of times the stage ran */
+    int calls;
+    /** Bytes read and written by the stage */
+    double bytes;
+    /** Pixels processed by the stage (characters for the write stage) */
+    double pixels;
+    /** Allocations made by the stage */
+    int allocations;
+    /** Bytes allocated by the stage */
+    double allocatedBytes;
+} StageCounters;
+
+/** Allocation size classes: up to 1, 2, 4, ... 2^(MEMORY_SIZE_CLASSES - 1) bytes */
+#define MEMORY_SIZE_CLASSES 48
+
+/**
+ * @brief Allocations of one memory pool (host or device) since profiling was enabled
+ */
+typedef struct {
+    /** Bytes allocated and not freed */
+    double liveBytes;
+    /** Maximum of liveBytes */
+    double peakBytes;
+    /** Number of allocations */
+    long long allocations;
+    /** Number of frees */
+    long long frees;
+    /** Allocations by size class */
+    long long sizes[MEMORY_SIZE_CLASSES];
+} MemoryPool;
+
+/**
+ * @brief Profiler of the pipeline stages. Disabled until enable() is called.
+ */
+class Profiler {
+public:
+    Profiler();
+    ~Profiler();
+
+    /**
+     * @brief Enables the profiler
+     */
+    void enable();
+
+    /**
+     * @brief Profiler enabled
+     */
+    bool enabled() const { return enabled_; }
+
+    /**
+     * @brief Enables the profiler and the hardware performance counters.
+     * Missing counters are reported, not an error.
+     */
+    void enableCounters();
+
+    /**
+     * @brief Counters enabled
+     */
+    bool countersEnabled() const { return countersEnabled_; }
+
+    /**
+     * @brief Starts a run, resetting the stage timers
+     * @param measured false for warmup runs, not included in the report
+     */
+    void beginRun(bool measured);
+
+    /**
+     * @brief Ends a run, keeping its times if measured
+     */
+    void endRun();
+
+    /**
+     * @brief Starts timing a stage
+     */
+    void start(ProfileStage stage);
+
+    /**
+     * @brief Stops timing a stage and adds its counters
+     * @param stage Stage
+     * @param bytes Bytes read and written
+     * @param pixels Pixels processed
+     * @param device Synchronize the device before stopping the timer
+     */
+    void stop(ProfileStage stage, double bytes, double pixels, bool device);
+
+    /**
+     * @brief Adds the counters of a worker thread to the running stage
+     * @param thread Thread index, the main thread is 0
+     * @param begin Counters when the thread started its work
+     * @param end Counters when the thread finished its work
+     */
+    void addThreadCounters(int thread, const PerfSample &begin, const PerfSample &end);
+
+    /**
+     * @brief Counts an allocation (bytes > 0) or a free (bytes = 0), charged to the running stage
+     * @param pool Host or device memory
+     * @param data Address
+     * @param bytes Bytes allocated, 0 on free
+     */
+    void allocation(npp::AllocationPool pool, const void *data, size_t bytes);
+
+    /**
+     * @brief Starts the startup clock, at the start of main()
+     */
+    void startupBegin();
+
+    /**
+     * @brief Milliseconds since startupBegin()
+     */
+    double startupMs() const;
+
+    /**
+     * @brief Adds a startup phase, in the order they ran
+     * @param phase Phase name
+     * @param ms Milliseconds
+     */
+    void addStartup(const char *phase, double ms);
+
+    /**
+     * @brief Marks the first byte of output, only the first call counts
+     */
+    void firstByte();
+
+    /**
+     * @brief Marks the first complete line of output of the current run, only the first call of a run counts.
+     * Marks the first byte too.
+     */
+    void firstLine();
+
+    /**
+     * @brief Sets the name of the output format, as reported
+     */
+    void setOutputFormat(const string &format) { outputFormat_ = format; }
+
+    /**
+     * @brief Adds an output of the current run
+     * @param bytes Bytes of the output
+     */
+    void addOutput(double bytes);
+
+    /**
+     * @brief Writes the JSON report
+     * @param out Output stream
+     * @param imagePath Image path
+     * @param warmup Number of warmup runs
+     * @return Reference to the updated output stream
+     */
+    ostream &report(ostream &out, const string &imagePath, int warmup) const;
+
+private:
+    /** Profiling enabled */
+    bool enabled_;
+    /** Current run is measured */
+    bool measured_;
+    /** Stage timers */
+    StopWatchInterface *timers_[STAGE_COUNT];
+    /** Whole run timer */
+    StopWatchInterface *runTimer_;
+    /** Counters of the current run */
+    StageCounters counters_[STAGE_COUNT];
+    /** Counters of the last measured run */
+    StageCounters lastCounters_[STAGE_COUNT];
+    /** Milliseconds of every measured run, by stage */
+    vector<float> times_[STAGE_COUNT];
+    /** Milliseconds of every measured run */
+    vector<float> runTimes_;
+    /** A device stage ran on the current run */
+    bool deviceUsed_;
+    /** Milliseconds from the start of the current run to its first line of output, < 0 = none yet */
+    float firstLineMs_;
+    /** Milliseconds to the first line of every measured run that wrote one */
+    vector<float> firstLineTimes_;
+    /** Output format, outputs and their bytes, of the current and of the last measured run */
+    string outputFormat_;
+    int outputs_;
+    double outputBytes_;
+    int lastOutputs_;
+    double lastOutputBytes_;
+
+    /** Start of main() */
+    std::chrono::steady_clock::time_point startupBegin_;
+    /** Startup phases and their milliseconds */
+    vector<std::pair<string, double>> startup_;
+    /** Milliseconds from the start of main() to the first byte of output, < 0 = none yet */
+    double firstByteMs_;
+
+    /** Hardware counters enabled */
+    bool countersEnabled_;
+    /** Running stage, -1 = none */
+    int activeStage_;
+    /** Stage that was running when each stage started */
+    int parentStage_[STAGE_COUNT];
+    /** Main thread counters when the current run and each stage started */
+    PerfSample runStart_;
+    PerfSample stageStart_[STAGE_COUNT];
+    /** Counters of the current run, by stage and by thread */
+    PerfSample stageCounters_[STAGE_COUNT];
+    vector<PerfSample> threadCounters_;
+    /** Sums over the measured runs, by stage and by thread */
+    PerfSample stageTotals_[STAGE_COUNT];
+    vector<PerfSample> threadTotals_;
+    /** Protects the counters added by worker threads and the allocations */
+    std::mutex mutex_;
+
+    /** Host and device allocations */
+    MemoryPool pools_[2];
+    /** Size and pool of every live allocation */
+    std::unordered_map<const void *, std::pair<size_t, npp::AllocationPool>> live_;
+    /** Allocations of the current run, and of every measured run */
+    int runAllocations_;
+    vector<int> allocationsPerRun_;
+};
+
+/**
+ * @brief Profiler shared by the whole program
+ */
+Profiler &profiler();
+
+/**
+ * @brief Name of a stage, as used in the report
+ */
+const char *stageName(ProfileStage stage);
+
+/**
+ * @brief Times a stage from construction to destruction, does nothing when profiling is disabled.
+ * The stage is traced too, when tracing is built in and enabled.
+ */
+class ProfileScope {
+public:
+    /**
+     * @param stage Stage
+     * @param bytes Bytes read and written
+     * @param pixels Pixels processed
+     * @param device Device stage, synchronize before stopping the timer
+     */
+    ProfileScope(ProfileStage stage, double bytes = 0, double pixels = 0, bool device = false)
+        : stage_(stage), bytes_(bytes), pixels_(pixels), device_(device)
+#ifdef ASCIIART_TRACE
+        , trace_("stage", stageName(stage))
+#endif
+    {
+        if (profiler().enabled())
+        {
+            profiler().start(stage_);
+        }
+    }
+
+    /**
+     * @brief Sets the counters, when they are only known at the end of the stage
+     */
+    void count(double bytes, double pixels)
+    {
+        bytes_ = bytes;
+        pixels_ = pixels;
+    }
+
+    ~ProfileScope()
+    {
+        if (profiler().enabled())
+        {
+            profiler().stop(stage_, bytes_, pixels_, device_);
+        }
+    }
+
+private:
+    ProfileStage stage_;
+    double bytes_;
+    double pixels_;
+    bool device_;
+#ifdef ASCIIART_TRACE
+    TraceScope trace_;
+#endif
+};
+
+/**
+ * @brief Times a startup phase from construction to destruction
+ */
+class StartupScope {
+public:
+    /**
+     * @param phase Phase name, as reported
+     */
+    explicit StartupScope(const char *phase) : phase_(phase), begin_(profiler().startupMs()) {}
+
+    ~StartupScope()
+    {
+        profiler().addStartup(phase_, profiler().startupMs() - begin_);
+    }
+
+private:
+    const char *phase_;
+    double begin_;
+};
+
+/**
+ * @brief Counts the work of a worker thread from construction to destruction,
+ * does nothing unless the counters are enabled
+ */
+class ProfileThread {
+public:
+    /**
+     * @param thread Thread index, 1 and above
+     */
+    explicit ProfileThread(int thread) : thread_(thread)
+    {
+        if (profiler().countersEnabled())
+        {
+            threadPerfCounters().read(begin_);
+        }
+    }
+
+    ~ProfileThread()
+    {
+        if (profiler().countersEnabled())
+        {
+            PerfSample end;
+            threadPerfCounters().read(end);
+            profiler().addThreadCounters(thread_, begin_, end);
+        }
+    }
+
+private:
+    int thread_;
+    PerfSample begin_;
+};
+
+#endif
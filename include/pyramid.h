@@ -0,0 +1,92 @@
+/**
+ * @file
+ * @brief Image pyramid - Successive 2x reductions of a host image
+ * Level k is the source reduced 2^k times, each level the exact (rounded)
+ * 2x2 mean of the previous one. Any target size is served from the nearest
+ * larger level plus one area average resize of less than 2x, so large
+ * reductions are both fast and free of aliasing. Several target sizes share
+ * the same pyramid.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <ImagesCPU.h>
+#include <npp.h>
+
+/**
+ * @brief Maximum number of levels, including the source (level 0)
+ */
+#define PYRAMID_MAX_LEVELS 16
+
+/**
+ * @brief Pyramid of 2x reductions of a host image
+ */
+class ImagePyramid {
+public:
+    ImagePyramid() : base_(nullptr), levelCount_(0) {}
+
+    /**
+     * @brief Builds the levels needed to serve a target width
+     * @param src Source image (level 0). Not copied, must outlive the pyramid.
+     * @param minWidth Smallest width that will be requested. Reduction stops at
+     * the last level at least minWidth pixels wide.
+     * @return Number of levels, including the source
+     */
+    int build(const npp::ImageCPU_8u_C1 &src, int minWidth);
+
+    /**
+     * @brief Number of levels, including the source
+     */
+    int levelCount() const { return levelCount_; }
+
+    /**
+     * @brief Level of the pyramid, 0 = source
+     */
+    const npp::ImageCPU_8u_C1 &level(int i) const { return i == 0 ? *base_ : levels_[i - 1]; }
+
+    /**
+     * @brief Resizes the source to the given size, starting from the nearest larger level
+     * @param dstSize Destination size
+     * @param dst Destination image, allocated with dstSize
+     * @return Level used, -1 if the pyramid is empty
+     */
+    int resize(NppiSize dstSize, npp::ImageCPU_8u_C1 &dst) const;
+
+private:
+    /** Source image */
+    const npp::ImageCPU_8u_C1 *base_;
+    /** Number of levels, including the source */
+    int levelCount_;
+    /** Levels 1 .. levelCount_ - 1 */
+    npp::ImageCPU_8u_C1 levels_[PYRAMID_MAX_LEVELS - 1];
+};
+
+/**
+ * @brief Nearest pyramid level at least as large as a target size
+ * @param srcSize Size of the source image
+ * @param dstSize Target size
+ * @param maxLevel Last available level
+ * @return Level, 0 if the target is larger than half the source
+ */
+int pyramidLevel(NppiSize srcSize, NppiSize dstSize, int maxLevel = PYRAMID_MAX_LEVELS - 1);
+
+/**
+ * @brief Reduces an image 2x, each destination pixel is the rounded mean of a 2x2 block.
+ * Odd last rows and columns are dropped. Uses SSE2 when available.
+ * @param src Source image
+ * @param dst Destination image, allocated with (width / 2) x (height / 2)
+ */
+void reduce2x(const npp::ImageCPU_8u_C1 &src, npp::ImageCPU_8u_C1 &dst);
+
+/**
+ * @brief Resizes an image by area averaging: each destination pixel is the
+ * mean of the source area it covers (same as NPPI_INTER_SUPER).
+ * @param src Source image
+ * @param dst Destination image, allocated with the destination size
+ */
+void areaResize(const npp::ImageCPU_8u_C1 &src, npp::ImageCPU_8u_C1 &dst);
+
+#endif
@@ -0,0 +1,149 @@
+/**
+ * @file
+ * @brief Render context - Library API of the ASCII art renderer
+ * A RenderContext is created once and renders any number of images: it keeps
+ * the NPP stream context, the filter kernels on the device, a thread pool for
+ * the host stages and the intermediate images, which are reused while the
+ * image size and the settings stay the same. Images are passed in memory
+ * (ImageView) and the ASCII art is written to a buffer owned by the caller,
+ * sized beforehand with RenderContext::outputSize(). Once the buffers have
+ * been sized, a render of the same size allocates nothing, heap or device,
+ * whatever the pattern or mode (checked by the benchmark).
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef RENDER_CONTEXT_H
+#define RENDER_CONTEXT_H
+
+#include <future>
+#include <mutex>
+
+#include <ImagesCPU.h>
+#include <ImagesNPP.h>
+#include <npp.h>
+
+#include "ascii_art.h"
+#include "host_npp.h"
+#include "integral_image.h"
+#include "parallel.h"
+#include "render_plan.h"
+
+/**
+ * @brief 8-bit single channel image in host memory, owned by the caller
+ */
+typedef struct {
+    const Npp8u *data;
+    int width;
+    int height;
+    /** Bytes from one row to the next */
+    int pitch;
+} ImageView;
+
+/**
+ * @brief Settings of one render
+ */
+typedef struct {
+    /** Width of the ASCII art, 0 = original width, < 0: abs(columns) */
+    int columns;
+    /** Edge detection filter, -1 = default filter */
+    int filter;
+    /** ASCII (or UTF-8) pattern, nullptr or empty = default pattern */
+    const char *asciiPattern;
+    /** Reduction of the filtered image to the ASCII art size, BACKEND_HOST: SAMPLING_AREA only */
+    RenderSampling sampling;
+    /** Text or Braille characters, MODE_HALFBLOCK needs colors and is not supported */
+    RenderMode mode;
+    /** Threshold of a Braille dot, 0 = ordered dithering */
+    int threshold;
+} RenderSettings;
+
+/**
+ * @brief Long-lived renderer: backend, thread pool and reusable buffers.
+ * Renders are serialized: concurrent calls on the same context wait for each other.
+ */
+class RenderContext {
+public:
+    /**
+     * @param backend Backend of the filter and the resize
+     * @param threads Host threads, including the calling thread. 0 = hardware threads.
+     */
+    explicit RenderContext(RenderBackend backend = BACKEND_NPP, int threads = 0);
+    ~RenderContext();
+
+    RenderContext(const RenderContext &) = delete;
+    RenderContext &operator=(const RenderContext &) = delete;
+
+    /**
+     * @brief Whether the backend could be set up (NPP: a CUDA device was found)
+     */
+    bool valid() const { return valid_; }
+
+    RenderBackend backend() const { return backend_; }
+
+    /**
+     * @brief Bytes of the ASCII art of an image: one line of columns glyphs and a '\n' per row.
+     * Exact when every glyph of the pattern has the same length, the longest glyphs otherwise.
+     * @param srcSize Image size, at least 3 x 3
+     * @param settings Render settings
+     * @return Size in bytes, 0 if the image is too small or the mode is MODE_HALFBLOCK (needs a color image)
+     */
+    static size_t outputSize(NppiSize srcSize, const RenderSettings &settings);
+
+    /**
+     * @brief Renders an image into a buffer
+     * @param image Source image
+     * @param settings Render settings
+     * @param out Destination buffer, not terminated
+     * @param capacity Size of the buffer, at least outputSize()
+     * @return Bytes written, 0 on error (message on cerr) or if the buffer is too small
+     */
+    size_t render(const ImageView &image, const RenderSettings &settings, char *out, size_t capacity);
+
+    /**
+     * @brief Renders an image into a buffer on another thread. The image and the buffer
+     * must stay valid until the future is ready.
+     * @return Future of the bytes written, as render()
+     */
+    std::future<size_t> renderAsync(const ImageView &image, const RenderSettings &settings, char *out,
+                                    size_t capacity);
+
+private:
+    /**
+     * @brief Filter and resize on the device, result in hostResized_
+     */
+    bool renderDevice(const ImageView &image, const RenderSettings &settings, NppiSize artSize);
+
+    /**
+     * @brief Filter and area sampling on the host, result in *result
+     */
+    bool renderHost(const ImageView &image, const RenderSettings &settings, NppiSize artSize,
+                    const npp::ImageCPU_8u_C1 *&result);
+
+    RenderBackend backend_;
+    bool valid_;
+    NppStreamContext nppStreamCtx_;
+    /** Kernels of every filter on the device, uploaded once */
+    Npp32s *deviceKernels_;
+    ThreadPool pool_;
+    std::mutex mutex_;
+
+    /** Intermediate images, reused while their size does not change */
+    npp::ImageNPP_8u_C1 deviceSrc_;
+    npp::ImageNPP_8u_C1 deviceFiltered_;
+    npp::ImageNPP_8u_C1 deviceResized_;
+    npp::ImageCPU_8u_C1 hostFiltered_;
+    npp::ImageCPU_8u_C1 hostResized_;
+    /** Braille cells of the resized image */
+    npp::ImageCPU_8u_C1 hostCells_;
+    /** Row of no dots below the image, Braille */
+    vector<Npp8u> brailleBlank_;
+    IntegralImage integral_;
+    AreaSampleTables areaTables_;
+    /** Row offsets of the ASCII art, patterns of glyphs of different lengths */
+    vector<size_t> offsets_;
+    /** Bytes of every chunk of rows, while the offsets are summed */
+    vector<size_t> chunkBytes_;
+};
+
+#endif
@@ -0,0 +1,321 @@
+/**
+ * @file
+ * @brief Render plan - Builds several ASCII art outputs from a single image
+ * The plan is a tree (DAG with a single root) rooted at the decode node:
+ * decode -> reduce -> filter -> resize -> quantize -> write. Requests that
+ * share a reduction, a filter, a resize or a pattern share the corresponding
+ * node, so every distinct piece of work runs exactly once.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef RENDER_PLAN_H
+#define RENDER_PLAN_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <ImagesNPP.h>
+#include <npp.h>
+
+#include "ansi_color.h"
+#include "braille.h"
+#include "html_output.h"
+
+using std::ostream;
+using std::string;
+using std::vector;
+
+/**
+ * @brief One requested output: width x filter x pattern -> file
+ */
+typedef struct {
+    /** Requested width, 0 = original width, < 0: abs(columns) */
+    int columns;
+    /** Requested filter (-1 = default filter) */
+    int filter;
+    /** ASCII pattern, empty = default pattern */
+    string asciiPattern;
+    /** Output path, "-" = standard output, empty = keep in memory */
+    string outputPath;
+} RenderRequest;
+
+/**
+ * @brief Execution order of the filter and the resize
+ */
+typedef enum {
+    /** Choose with the cost model, see renderOrder() */
+    ORDER_AUTO,
+    /** Filter at full resolution, then resize (original behavior) */
+    ORDER_FILTER_FIRST,
+    /** Reduce to RESIZE_FIRST_OVERSAMPLING x the target through an image pyramid, filter, then resize */
+    ORDER_RESIZE_FIRST
+} RenderOrder;
+
+/**
+ * @brief Resize first reduces the image to this many pixels per output character
+ * before filtering, so the filter still sees some detail inside each character.
+ */
+#define RESIZE_FIRST_OVERSAMPLING 3
+
+/**
+ * @brief How the filtered image is reduced to one pixel per character
+ */
+typedef enum {
+    /** Cubic resize (original behavior) */
+    SAMPLING_RESIZE,
+    /** Mean of the cell covered by each character, from an integral image */
+    SAMPLING_AREA
+} RenderSampling;
+
+/**
+ * @brief What a character shows
+ */
+typedef enum {
+    /** A grey level, a glyph of the pattern (original behavior) */
+    MODE_TEXT,
+    /** 2 x 4 dots, a Braille glyph (braille.h) */
+    MODE_BRAILLE,
+    /** Two pixels, upper half block with foreground and background colors (ansi_color.h) */
+    MODE_HALFBLOCK
+} RenderMode;
+
+/**
+ * @brief Where the filter and the resize run
+ */
+typedef enum {
+    /** NPP on the CUDA device (original behavior) */
+    BACKEND_NPP,
+    /** Host versions of the NPP filter (host_npp.h) and area sampling, no CUDA device used */
+    BACKEND_HOST
+} RenderBackend;
+
+/**
+ * @brief Render options
+ */
+typedef struct {
+    /** Print the render plan to cerr before running it */
+    bool printPlan;
+    /** Execution order of the filter and the resize */
+    RenderOrder order;
+    /** Reduction of the filtered image to the ASCII art size */
+    RenderSampling sampling;
+    /** Box blur radius applied to the image before filtering, 0 = no blur */
+    int blurRadius;
+    /** Backend of the filter and the resize */
+    RenderBackend backend;
+    /** Text, Braille or half-block characters */
+    RenderMode mode;
+    /** Threshold of a Braille dot, 0 = ordered dithering */
+    int threshold;
+    /** ANSI colors of the characters, from the color image */
+    ColorMode color;
+    /** Plain text (or ANSI escapes) or an HTML fragment */
+    OutputFormat format;
+} RenderOptions;
+
+/**
+ * @brief Kind of work done by a plan node
+ */
+typedef enum {
+    PLAN_DECODE,
+    PLAN_REDUCE,
+    PLAN_FILTER,
+    PLAN_RESIZE,
+    PLAN_QUANTIZE,
+    PLAN_WRITE
+} PlanNodeType;
+
+/**
+ * @brief Node of the render plan
+ */
+typedef struct {
+    /** Kind of work */
+    PlanNodeType type;
+    /** Parent node (-1 for the decode node) */
+    int parent;
+    /** Effective filter (filter nodes) */
+    int filter;
+    /** Requested width (resize nodes), reduced width (reduce nodes, 0 = not reduced) */
+    int columns;
+    /** Pattern (quantize nodes) */
+    string asciiPattern;
+    /** Index of the request (write nodes) */
+    int request;
+    /** Output path (write nodes), empty = keep in memory, see captured() */
+    string outputPath;
+    /** Child nodes */
+    vector<int> children;
+} PlanNode;
+
+/**
+ * @brief Render plan. Node 0 is always the decode node.
+ */
+class RenderPlan {
+public:
+    /**
+     * @brief Builds the plan for a list of requests over the same image
+     * @param imagePath Image path
+     * @param requests Requested outputs
+     * @param srcSize Size of the image, required to reduce it before filtering
+     * @param options Execution order, sampling and blur. printPlan is ignored.
+     */
+    RenderPlan(const string &imagePath,
+               const vector<RenderRequest> &requests,
+               NppiSize srcSize = {0, 0},
+               const RenderOptions &options = {false, ORDER_FILTER_FIRST, SAMPLING_RESIZE, 0, BACKEND_NPP,
+                                                  MODE_TEXT, BRAILLE_THRESHOLD, COLOR_NONE, FORMAT_TEXT});
+
+    /**
+     * @brief Builds the requests for a matrix of widths x filters x patterns
+     * @param widths Requested widths
+     * @param filters Requested filters
+     * @param patterns Requested patterns
+     * @param outputTemplate Output path template. {w} is replaced by the width ("full" for 0),
+     * {f} by the filter number, {filter} by the filter name and {p} by the pattern index.
+     * "-" sends every output to the standard output.
+     * @return List of requests, one for each combination
+     */
+    static vector<RenderRequest> matrix(const vector<int> &widths,
+                                        const vector<int> &filters,
+                                        const vector<string> &patterns,
+                                        const string &outputTemplate);
+
+    /**
+     * @brief Prints the plan, showing how many outputs share each node
+     * @param out Output stream
+     * @return Reference to the updated output stream
+     */
+    ostream &print(ostream &out) const;
+
+    /**
+     * @brief Runs the plan depth first, releasing intermediate images as soon as
+     * all of their children are done. When the image has more than one filter,
+     * every filter runs in a single multi filter pass over the source.
+     * @param nppStreamCtx Stream context (required on 12.9)
+     * @return true if every output was written, false otherwise
+     */
+    bool execute(const NppStreamContext &nppStreamCtx);
+
+    /**
+     * @brief Runs the plan on the host (BACKEND_HOST), as execute() but with the host filters
+     * and area sampling only. No CUDA context is created.
+     * @return true if every output was written, false otherwise
+     */
+    bool executeHost();
+
+    /**
+     * @brief Plan nodes
+     */
+    const vector<PlanNode> &nodes() const { return nodes_; }
+
+    /**
+     * @brief ASCII art of the requests with an empty output path, indexed by request
+     */
+    const vector<string> &captured() const { return captured_; }
+
+private:
+    /** Finds or creates a child of parent matching the given node */
+    int child(int parent, const PlanNode &node);
+
+    /** Number of write nodes below a node */
+    int outputCount(int node) const;
+
+    /** Reduces a filtered image to the size of every resize node below a filter node and quantizes it */
+    bool executeResizes(int filterNode, npp::ImageNPP_8u_C1 &filtered, NppiSize srcSize, const NppStreamContext &nppStreamCtx);
+
+    /** Runs the filters below a reduce node over its (reduced) source image */
+    bool executeFilters(int reduceNode, npp::ImageNPP_8u_C1 &src, NppiSize srcSize, const NppStreamContext &nppStreamCtx);
+
+    /** Host version of executeFilters() */
+    bool executeHostFilters(int reduceNode, const npp::ImageCPU_8u_C1 &src, NppiSize srcSize);
+
+    /** Host version of executeResizes(), area sampling only */
+    bool executeHostResizes(int filterNode, const npp::ImageCPU_8u_C1 &filtered, NppiSize srcSize);
+
+    /** Quantize node of the single output below a resize node written to a file or cout, nullptr if none */
+    const PlanNode *streamedQuantize(int resizeNode) const;
+
+    /** Packs the Braille dots, adds the colors, quantizes and writes a host image to the outputs of a resize node */
+    bool writeResized(int resizeNode, const npp::ImageCPU_8u_C1 &resized);
+
+    /** Image path */
+    string imagePath_;
+    /** Image size, {0, 0} if unknown */
+    NppiSize srcSize_;
+    /** Execution order, sampling and blur */
+    RenderOptions options_;
+    /** Plan nodes */
+    vector<PlanNode> nodes_;
+    /** ASCII art kept in memory */
+    vector<string> captured_;
+    /** Channels of the color image, to color the characters (options_.color) */
+    ColorPlanes colors_;
+};
+
+/**
+ * @brief Renders several ASCII art outputs of the same image, sharing the decode,
+ * filter and resize work between them.
+ * @param imagePath Image path
+ * @param requests Requested outputs
+ * @param options Render options
+ * @return true if successful, false otherwise.
+ */
+bool renderASCIIArt(const string &imagePath, const vector<RenderRequest> &requests, const RenderOptions &options);
+
+/**
+ * @brief Width of the reduced image for resize first, see RESIZE_FIRST_OVERSAMPLING
+ * @param srcSize Size of the source image
+ * @param outColumns Requested width. 0 = original width, outColumns < 0: abs(outColumns)
+ * @return Reduced width, 0 if the image can not be reduced at least 2x
+ */
+int reducedWidth(NppiSize srcSize, int outColumns);
+
+/**
+ * @brief Size of the reduced image, keeping the aspect ratio
+ * @param srcSize Size of the source image
+ * @param reducedColumns Reduced width, see reducedWidth()
+ * @return Reduced size, at least 3 rows high
+ */
+NppiSize reducedSize(NppiSize srcSize, int reducedColumns);
+
+/**
+ * @brief Estimated cost of rendering one width, in pixel operations.
+ * A 3x3 filter costs 9 operations per pixel, the pyramid reduction 1 operation
+ * per source pixel and the cubic resize 16 operations per output pixel.
+ * @param srcSize Size of the source image
+ * @param outColumns Requested width
+ * @param filterCount Number of filters applied to the image
+ * @param order ORDER_FILTER_FIRST or ORDER_RESIZE_FIRST
+ * @return Estimated number of pixel operations
+ */
+double renderCost(NppiSize srcSize, int outColumns, int filterCount, RenderOrder order);
+
+/**
+ * @brief Resolves the execution order for one width. ORDER_AUTO chooses resize
+ * first only when the image can be reduced at least 2x (quality) and the
+ * estimated cost is lower.
+ * @param srcSize Size of the source image, {0, 0} if unknown (filter first)
+ * @param outColumns Requested width
+ * @param filterCount Number of filters applied to the image
+ * @param order Requested order
+ * @return ORDER_FILTER_FIRST or ORDER_RESIZE_FIRST
+ */
+RenderOrder renderOrder(NppiSize srcSize, int outColumns, int filterCount, RenderOrder order);
+
+/**
+ * @brief Renders the image with every available filter and prints the results
+ * side by side, to pick the best filter at a glance. The filters run in a
+ * single pass over the source.
+ * @param out Output stream
+ * @param imagePath Image path
+ * @param columns Width of each ASCII art
+ * @param asciiPattern ASCII pattern
+ * @param backend Backend of the filters and the resize. BACKEND_HOST: area sampling.
+ * @return true if successful, false otherwise.
+ */
+bool previewASCIIArt(ostream &out, const string &imagePath, int columns, const string &asciiPattern,
+                     RenderBackend backend = BACKEND_NPP);
+
+#endif
@@ -0,0 +1,161 @@
+/**
+ * @file
+ * @brief Row streaming - Writes the ASCII art one band of rows at a time
+ * Each band is downloaded (device images), quantized on host threads, each
+ * thread into its own buffer (output_assembler.h), and written in order and
+ * flushed at once, so the first lines reach the destination before the rest of
+ * the image is quantized, and the whole ASCII art is never held in memory. The profiler reports the time to the first line of each run.
+ * HTML without colors is streamed the same way: the opening <pre>, the rows
+ * with their glyphs escaped (html_output.h), and the closing </pre>.
+ * Large outputs that can be mapped (output_map.h) are quantized in place instead,
+ * in parallel, with no stream in between.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef ROW_STREAM_H
+#define ROW_STREAM_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <ImagesCPU.h>
+#include <ImagesNPP.h>
+#include <npp.h>
+
+#include "ascii_art.h"
+#include "html_output.h"
+#include "output_assembler.h"
+#include "output_map.h"
+#include "parallel.h"
+
+using std::ostream;
+using std::string;
+using std::unique_ptr;
+
+/**
+ * @brief Rows per band: small enough for a fast first line, large enough to amortize the flush
+ */
+#define STREAM_BAND_ROWS 64
+
+/**
+ * @brief Quantizes bands of rows and writes each one to a stream as soon as it is ready
+ */
+class RowStreamWriter {
+public:
+    /**
+     * @param out Destination stream
+     * @param asciiPattern ASCII (or UTF-8) pattern, empty = default pattern
+     * @param width Width of the image, in pixels (characters)
+     * @param format FORMAT_TEXT, or FORMAT_HTML: the opening <pre> is written first, the glyphs are escaped
+     * @param bandRows Rows per band
+     */
+    RowStreamWriter(ostream &out, const string &asciiPattern, int width, OutputFormat format = FORMAT_TEXT,
+                    int bandRows = STREAM_BAND_ROWS);
+
+    /**
+     * @brief Rows per band
+     */
+    int bandRows() const { return bandRows_; }
+
+    /**
+     * @brief Quantizes a band of rows on host threads, writes and flushes it
+     * @param rows First row of the band, on host
+     * @param pitch Bytes from one row to the next
+     * @param count Rows, at most bandRows()
+     * @return true if the stream is still good, false otherwise
+     */
+    bool writeBand(const Npp8u *rows, int pitch, int count);
+
+    /**
+     * @brief Writes the end of the output (the closing </pre> of HTML) and flushes it
+     * @return true if the stream is still good, false otherwise
+     */
+    bool finish();
+
+    /**
+     * @brief Bytes written so far
+     */
+    size_t bytes() const { return bytes_; }
+
+private:
+    ostream &out_;
+    GlyphTable table_;
+    /** HTML: escaped glyphs, and the encoder of the rows, no colors */
+    OutputFormat format_;
+    HtmlGlyphTable htmlTable_;
+    HtmlEncoder htmlEncoder_;
+    int width_;
+    int bandRows_;
+    /** Glyphs of one band, a '\n' after each row, one buffer per thread */
+    OutputAssembler assembler_;
+    /** Threads of the bands, unless the caller runs on a pool already */
+    unique_ptr<ThreadPool> pool_;
+    size_t bytes_;
+};
+
+/**
+ * @brief Streams the ASCII art of a host image, and adds the bytes written to the output of the profile
+ * @param out Destination stream
+ * @param img Host image
+ * @param asciiPattern ASCII pattern, empty = default pattern
+ * @param format Text, or HTML without colors
+ * @return true if successful, false otherwise
+ */
+bool streamAsciiArt(ostream &out, const npp::ImageCPU_8u_C1 &img, const string &asciiPattern,
+                    OutputFormat format = FORMAT_TEXT);
+
+/**
+ * @brief Streams the ASCII art of a device image, downloading one band at a time, and adds the bytes written to
+ * the output of the profile
+ * @param out Destination stream
+ * @param img Device image
+ * @param asciiPattern ASCII pattern, empty = default pattern
+ * @param format Text, or HTML without colors
+ * @return true if successful, false otherwise
+ */
+bool streamAsciiArt(ostream &out, npp::ImageNPP_8u_C1 &img, const string &asciiPattern,
+                    OutputFormat format = FORMAT_TEXT);
+
+/**
+ * @brief Bytes of the ASCII art of a host image, see asciiArtOffsets()
+ * @param img Host image
+ * @param table Glyph table
+ * @param offsets Offset of every row, empty when every glyph has the same length
+ * @return Bytes of the ASCII art
+ */
+size_t asciiArtLength(const npp::ImageCPU_8u_C1 &img, const GlyphTable &table, vector<size_t> &offsets);
+
+/**
+ * @brief Bytes of the ASCII art of a device image, known before downloading it when
+ * every glyph has the same length
+ * @param img Device image
+ * @param table Glyph table
+ * @param offsets Cleared, rows are at a fixed stride
+ * @return Bytes of the ASCII art, 0 when the glyphs have different lengths
+ */
+size_t asciiArtLength(npp::ImageNPP_8u_C1 &img, const GlyphTable &table, vector<size_t> &offsets);
+
+/**
+ * @brief Quantizes the ASCII art of a host image into an output map, on host threads
+ * @param map Output map, asciiArtLength() bytes
+ * @param img Host image
+ * @param table Glyph table
+ * @param offsets Row offsets given by asciiArtLength()
+ * @return true if successful, false otherwise
+ */
+bool mapAsciiArt(OutputMap &map, const npp::ImageCPU_8u_C1 &img, const GlyphTable &table,
+                 const vector<size_t> &offsets);
+
+/**
+ * @brief Quantizes the ASCII art of a device image into an output map, downloading one band at a time
+ * @param map Output map, asciiArtLength() bytes
+ * @param img Device image
+ * @param table Glyph table, every glyph of the same length
+ * @param offsets Row offsets given by asciiArtLength(), empty
+ * @return true if successful, false otherwise
+ */
+bool mapAsciiArt(OutputMap &map, npp::ImageNPP_8u_C1 &img, const GlyphTable &table, const vector<size_t> &offsets);
+
+#endif
@@ -0,0 +1,64 @@
+/**
+ * @file
+ * @brief Synthetic images - Procedural test images of any size
+ * Gradients, seeded noise, edges (rectangles and circles) and text-like
+ * glyph rows, laid out in tiles chosen by the seed. Every pixel depends only
+ * on its coordinates and the seed, so the same seed gives the same image
+ * whatever the number of threads. Wherever an image path is expected, the
+ * path "synthetic:WIDTHxHEIGHT[:SEED]" generates the image in memory instead
+ * of reading a file.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include <string>
+
+#include <ImagesCPU.h>
+#include <npp.h>
+
+using std::string;
+
+/**
+ * @brief Prefix of the synthetic image paths
+ */
+#define SYNTHETIC_PREFIX "synthetic:"
+
+/**
+ * @brief Side of the square tiles of the synthetic images, pixels
+ */
+#define SYNTHETIC_TILE 256
+
+/**
+ * @brief Path is a synthetic image path
+ */
+bool isSyntheticImage(const string &imagePath);
+
+/**
+ * @brief Parses a synthetic image path, "synthetic:WIDTHxHEIGHT[:SEED]"
+ * @param imagePath Path
+ * @param size Image size
+ * @param seed Seed, 1 if not given
+ * @return true if the path is a valid synthetic image path, of at most INT_MAX pixels
+ */
+bool parseSyntheticImage(const string &imagePath, NppiSize &size, unsigned int &seed);
+
+/**
+ * @brief Generates a synthetic image, in parallel bands of rows
+ * @param size Image size
+ * @param seed Seed
+ * @param dst Destination, allocated with the image size
+ */
+void generateImage(NppiSize size, unsigned int seed, npp::ImageCPU_8u_C1 &dst);
+
+/**
+ * @brief Writes an image as PGM (.pgm) or raw 8 bit gray pixels (any other extension)
+ * @param img Image
+ * @param path Output path
+ * @return true if successful, false otherwise
+ */
+bool writeImage(const npp::ImageCPU_8u_C1 &img, const string &path);
+
+#endif
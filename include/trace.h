@@ -0,0 +1,112 @@
+/**
+ * @file
+ * @brief Event tracing - Timeline of the stages, waits and I/O of every thread
+ * Built only with ASCIIART_TRACE defined (make TRACE=1, cmake -DASCIIART_TRACE=ON),
+ * otherwise the TRACE_ macros expand to nothing. When built in, tracing starts
+ * with traceEnable() (--trace): each thread records complete events (name,
+ * start, duration) into its own ring buffer, without locks, and traceWrite()
+ * saves them as Chrome trace JSON, which loads in Perfetto (ui.perfetto.dev)
+ * and chrome://tracing. Full buffers drop their oldest events.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef ASCIIART_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/** Events kept by each thread */
+#define TRACE_BUFFER_EVENTS 65536
+
+/** Threads traced at once, the events of any further thread are dropped */
+#define TRACE_MAX_THREADS 256
+
+/** Tracing started */
+extern std::atomic<bool> traceActive;
+
+/**
+ * @brief Starts tracing, the calling thread is the main thread of the timeline
+ */
+void traceEnable();
+
+/**
+ * @brief Stops tracing, the events recorded so far are kept for traceWrite()
+ */
+void traceDisable();
+
+/**
+ * @brief Tracing started
+ */
+inline bool traceEnabled()
+{
+    return traceActive.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Nanoseconds on the trace clock
+ */
+inline long long traceNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * @brief Records a complete event on the calling thread
+ * @param category Category, static string
+ * @param name Name, static string
+ * @param start Start, from traceNow()
+ * @param end End, from traceNow()
+ */
+void traceEvent(const char *category, const char *name, long long start, long long end);
+
+/**
+ * @brief Writes the events of every thread as Chrome trace JSON. Call when no thread is tracing.
+ * @param path Output path
+ * @return true if successful, false otherwise
+ */
+bool traceWrite(const std::string &path);
+
+/**
+ * @brief Records an event from construction to destruction
+ */
+class TraceScope {
+public:
+    TraceScope(const char *category, const char *name)
+        : category_(category), name_(name), start_(traceEnabled() ? traceNow() : 0)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (start_)
+        {
+            traceEvent(category_, name_, start_, traceNow());
+        }
+    }
+
+private:
+    const char *category_;
+    const char *name_;
+    long long start_;
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+
+/** Traces the rest of the enclosing block */
+#define TRACE_SCOPE(category, name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(category, name)
+
+#else
+
+#define TRACE_SCOPE(category, name) ((void)0)
+
+#endif
+
+#endif
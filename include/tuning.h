@@ -0,0 +1,115 @@
+/**
+ * @file
+ * @brief Autotuning of the host stages - Best parallel settings for this machine
+ * --tune times candidate settings (threads, rows per chunk) of the threaded
+ * host stages (integral image, area sampling, box blur) on synthetic images of
+ * each size class, and keeps the fastest in a cache file, keyed by CPU model
+ * and size class. Normal runs load the entry of their CPU and apply the one of
+ * the image size class once the image is decoded.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifndef TUNING_H
+#define TUNING_H
+
+#include <iostream>
+#include <string>
+
+#include <npp.h>
+
+#include "parallel.h"
+
+using std::ostream;
+using std::string;
+
+/**
+ * @brief Image size classes
+ */
+typedef enum {
+    /** Up to 2 Mpixels */
+    SIZE_SMALL,
+    /** Up to 16 Mpixels */
+    SIZE_MEDIUM,
+    /** Up to 64 Mpixels */
+    SIZE_LARGE,
+    /** Above 64 Mpixels */
+    SIZE_HUGE,
+    SIZE_CLASS_COUNT
+} SizeClass;
+
+/**
+ * @brief Best settings of every size class on one CPU
+ */
+typedef struct {
+    /** Settings of each size class */
+    ParallelSettings settings[SIZE_CLASS_COUNT];
+    /** Size class has been tuned */
+    bool tuned[SIZE_CLASS_COUNT];
+} TuningTable;
+
+/**
+ * @brief Size class of an image
+ */
+SizeClass sizeClass(NppiSize size);
+
+/**
+ * @brief Name of a size class, as used in the cache file
+ */
+const char *sizeClassName(SizeClass sizeClass);
+
+/**
+ * @brief CPU model, from /proc/cpuinfo ("unknown" elsewhere)
+ */
+string cpuModel();
+
+/**
+ * @brief Default tuning cache: $ASCIIART_TUNING, or $XDG_CACHE_HOME/asciiArtNpp/tuning.txt,
+ * or $HOME/.cache/asciiArtNpp/tuning.txt
+ */
+string defaultTuningPath();
+
+/**
+ * @brief Loads the entries of a CPU from the tuning cache
+ * @param path Cache file
+ * @param cpu CPU model
+ * @param table Tuned settings, untouched classes keep tuned = false
+ * @return true if at least one size class was found
+ */
+bool loadTuning(const string &path, const string &cpu, TuningTable &table);
+
+/**
+ * @brief Saves the entries of a CPU in the tuning cache, keeping the other CPUs
+ * @return true if successful, false otherwise
+ */
+bool saveTuning(const string &path, const string &cpu, const TuningTable &table);
+
+/**
+ * @brief Parses a size class name
+ * @return Size class, SIZE_CLASS_COUNT if unknown
+ */
+SizeClass parseSizeClass(const string &name);
+
+/**
+ * @brief Times the candidate settings on a synthetic image of each size class
+ * @param log Progress and results
+ * @param table Best settings found, for the tuned classes
+ * @param classes Bit mask of the size classes to tune
+ * @param repeat Timed runs of each candidate
+ */
+void tune(ostream &log, TuningTable &table, unsigned int classes = ~0u, int repeat = 3);
+
+/**
+ * @brief Uses the tuned settings of an image size from now on
+ * @param table Tuned settings. Classes not tuned keep the current settings.
+ * @param size Image size
+ */
+void applyTuning(const TuningTable &table, NppiSize size);
+
+/**
+ * @brief Tuned settings loaded at startup, applied by the render plan
+ * @return Table, nothing tuned unless loaded
+ */
+TuningTable &activeTuning();
+
+#endif
@@ -0,0 +1,305 @@
+/**
+ * @file
+ * @brief ANSI color - Colors the characters of the ASCII art with ANSI escape sequences
+ * See ansi_color.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <cstdlib>
+#include <cstring>
+
+#include "ansi_color.h"
+
+using namespace std;
+
+/**
+ * @brief Escape of the default colors, at the end of every row
+ */
+static const char ansiReset[] = "\x1b[0m";
+
+/**
+ * @brief UTF-8 of the block glyphs of half-block mode
+ */
+static const char upperHalfBlock[] = "\xE2\x96\x80";
+static const char lowerHalfBlock[] = "\xE2\x96\x84";
+static const char fullBlock[] = "\xE2\x96\x88";
+
+void ColorPlanes::build(const npp::ImageCPU_8u_C1 planes[3])
+{
+    for (int c = 0; c < 3; c++)
+    {
+        integral_[c].build(planes[c]);
+    }
+}
+
+void ColorPlanes::sample(NppiSize size, npp::ImageCPU_8u_C1 cells[3]) const
+{
+    for (int c = 0; c < 3; c++)
+    {
+        if ((int)cells[c].width() != size.width || (int)cells[c].height() != size.height)
+        {
+            npp::ImageCPU_8u_C1 oCells(size.width, size.height);
+            cells[c].swap(oCells);
+        }
+        areaSample(integral_[c], cells[c]);
+    }
+}
+
+/**
+ * @brief xterm palette index of every color, 5 bits per channel: the nearest color of
+ * the 6 x 6 x 6 cube (16 - 231) or of the grey ramp (232 - 255) to the center of the bucket
+ */
+static const Npp8u *paletteTable()
+{
+    static const vector<Npp8u> table = [] {
+        static const int levels[6] = {0, 95, 135, 175, 215, 255};
+        static const int strides[3] = {36, 6, 1};
+        vector<Npp8u> t(32 * 32 * 32);
+        for (int i = 0; i < (int)t.size(); i++)
+        {
+            int rgb[3] = {((i >> 10) & 31) * 8 + 4, ((i >> 5) & 31) * 8 + 4, (i & 31) * 8 + 4};
+
+            // Cube: nearest level of each channel
+            int cube = 16;
+            int cubeDistance = 0;
+            for (int c = 0; c < 3; c++)
+            {
+                int level = 0;
+                for (int l = 1; l < 6; l++)
+                {
+                    level = abs(levels[l] - rgb[c]) < abs(levels[level] - rgb[c]) ? l : level;
+                }
+                cube += level * strides[c];
+                cubeDistance += (levels[level] - rgb[c]) * (levels[level] - rgb[c]);
+            }
+
+            // Ramp: 8, 18, ... 238
+            int ramp = min(23, max(0, ((rgb[0] + rgb[1] + rgb[2]) / 3 - 3) / 10));
+            int rampDistance = 0;
+            for (int c = 0; c < 3; c++)
+            {
+                rampDistance += (8 + 10 * ramp - rgb[c]) * (8 + 10 * ramp - rgb[c]);
+            }
+
+            t[i] = (Npp8u)(rampDistance < cubeDistance ? 232 + ramp : cube);
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+/**
+ * @brief Appends the decimal digits of a value, 0 - 255
+ */
+static char *appendDecimal(char *p, int value)
+{
+    if (value >= 100)
+    {
+        *p++ = (char)('0' + value / 100);
+    }
+    if (value >= 10)
+    {
+        *p++ = (char)('0' + value / 10 % 10);
+    }
+    *p++ = (char)('0' + value % 10);
+    return p;
+}
+
+AnsiEncoder::AnsiEncoder(ColorMode color) : color_(color), palette_(paletteTable())
+{
+}
+
+Npp32u AnsiEncoder::color(Npp8u r, Npp8u g, Npp8u b) const
+{
+    if (color_ == COLOR_256)
+    {
+        return palette_[(r >> 3) << 10 | (g >> 3) << 5 | (b >> 3)];
+    }
+    return (Npp32u)r << 16 | (Npp32u)g << 8 | b;
+}
+
+Npp32u AnsiEncoder::rgb(Npp32u c) const
+{
+    if (color_ != COLOR_256)
+    {
+        return c;
+    }
+    // Only the cube and the grey ramp come out of the palette table
+    if (c >= 232)
+    {
+        Npp32u grey = 8 + 10 * (c - 232);
+        return grey << 16 | grey << 8 | grey;
+    }
+    static const Npp32u levels[6] = {0, 95, 135, 175, 215, 255};
+    c -= 16;
+    return levels[c / 36] << 16 | levels[c / 6 % 6] << 8 | levels[c % 6];
+}
+
+void AnsiEncoder::appendColors(vector<char> &out, Npp32u fg, Npp32u bg) const
+{
+    // Longest: ESC[38;2;255;255;255;48;2;255;255;255m
+    char sgr[48];
+    char *p = sgr;
+    *p++ = '\x1b';
+    *p++ = '[';
+    Npp32u colors[2] = {fg, bg};
+    for (int layer = 0; layer < 2; layer++)
+    {
+        Npp32u c = colors[layer];
+        if (c == ANSI_NO_COLOR)
+        {
+            continue;
+        }
+        if (p[-1] != '[')
+        {
+            *p++ = ';';
+        }
+        // 38 = foreground, 48 = background; 5 = palette index, 2 = RGB
+        *p++ = layer ? '4' : '3';
+        *p++ = '8';
+        *p++ = ';';
+        if (color_ == COLOR_256)
+        {
+            *p++ = '5';
+            *p++ = ';';
+            p = appendDecimal(p, (int)c);
+        }
+        else
+        {
+            *p++ = '2';
+            *p++ = ';';
+            p = appendDecimal(p, (int)(c >> 16));
+            *p++ = ';';
+            p = appendDecimal(p, (int)(c >> 8) & 255);
+            *p++ = ';';
+            p = appendDecimal(p, (int)c & 255);
+        }
+    }
+    *p++ = 'm';
+    out.insert(out.end(), sgr, p);
+}
+
+/**
+ * @brief Padded glyph of a UTF-8 character, as in GlyphTable
+ */
+static Npp32u paddedGlyph(const char *utf8)
+{
+    char glyph[GLYPH_BYTES] = {0};
+    memcpy(glyph, utf8, strlen(utf8));
+    Npp32u padded;
+    memcpy(&padded, glyph, GLYPH_BYTES);
+    return padded;
+}
+
+void AnsiEncoder::textRow(const Npp8u *grey, const Npp8u *const rgb[3], int width, const GlyphTable &table,
+                          vector<char> &out) const
+{
+    // Space and empty Braille cell (U+2800)
+    static const Npp32u space = paddedGlyph(" ");
+    static const Npp32u noDots = paddedGlyph("\xE2\xA0\x80");
+
+    Npp32u fg = ANSI_NO_COLOR;
+    for (int x = 0; x < width; x++)
+    {
+        Npp8u level = grey[x];
+        int length = table.lengths[level];
+
+        // A blank shows no foreground, the current one is kept
+        if (table.glyphs[level] != space && table.glyphs[level] != noDots)
+        {
+            Npp32u c = color(rgb[0][x], rgb[1][x], rgb[2][x]);
+            if (c != fg)
+            {
+                appendColors(out, c, ANSI_NO_COLOR);
+                fg = c;
+            }
+        }
+        const char *glyph = (const char *)&table.glyphs[level];
+        out.insert(out.end(), glyph, glyph + length);
+    }
+
+    if (fg != ANSI_NO_COLOR)
+    {
+        out.insert(out.end(), ansiReset, ansiReset + sizeof(ansiReset) - 1);
+    }
+    out.push_back('\n');
+}
+
+void AnsiEncoder::blockRow(const Npp8u *const top[3], const Npp8u *const bottom[3], int width,
+                           vector<char> &out) const
+{
+    Npp32u fg = ANSI_NO_COLOR;
+    Npp32u bg = ANSI_NO_COLOR;
+    for (int x = 0; x < width; x++)
+    {
+        Npp32u t = color(top[0][x], top[1][x], top[2][x]);
+        Npp32u b = color(bottom[0][x], bottom[1][x], bottom[2][x]);
+
+        // Glyph and the colors it needs: the one that changes the fewest
+        const char *glyph;
+        Npp32u glyphFg;
+        Npp32u glyphBg;
+        if (t == b)
+        {
+            // A blank on the background, or a full block on the foreground
+            bool full = bg != t && fg == t;
+            glyph = full ? fullBlock : " ";
+            glyphFg = full ? t : fg;
+            glyphBg = full ? bg : t;
+        }
+        else if ((fg == b) + (bg == t) > (fg == t) + (bg == b))
+        {
+            glyph = lowerHalfBlock;
+            glyphFg = b;
+            glyphBg = t;
+        }
+        else
+        {
+            glyph = upperHalfBlock;
+            glyphFg = t;
+            glyphBg = b;
+        }
+
+        if (glyphFg != fg || glyphBg != bg)
+        {
+            appendColors(out, glyphFg != fg ? glyphFg : ANSI_NO_COLOR, glyphBg != bg ? glyphBg : ANSI_NO_COLOR);
+            fg = glyphFg;
+            bg = glyphBg;
+        }
+        out.insert(out.end(), glyph, glyph + strlen(glyph));
+    }
+
+    if (fg != ANSI_NO_COLOR || bg != ANSI_NO_COLOR)
+    {
+        out.insert(out.end(), ansiReset, ansiReset + sizeof(ansiReset) - 1);
+    }
+    out.push_back('\n');
+}
+
+void colorAsciiArt(const npp::ImageCPU_8u_C1 &grey, const npp::ImageCPU_8u_C1 colors[3], const string &asciiPattern,
+                   ColorMode color, OutputAssembler &assembler)
+{
+    GlyphTable table;
+    glyphTable(asciiPattern.c_str(), table);
+    AnsiEncoder encoder(color);
+
+    int width = (int)grey.width();
+    assembler.encode(0, (int)grey.height(), [&](int y, vector<char> &band) {
+        const Npp8u *rgb[3] = {colors[0].data(0, y), colors[1].data(0, y), colors[2].data(0, y)};
+        encoder.textRow(grey.data(0, y), rgb, width, table, band);
+    });
+}
+
+void halfBlockArt(const npp::ImageCPU_8u_C1 colors[3], ColorMode color, OutputAssembler &assembler)
+{
+    AnsiEncoder encoder(color);
+
+    int width = (int)colors[0].width();
+    assembler.encode(0, (int)colors[0].height() / 2, [&](int y, vector<char> &band) {
+        const Npp8u *top[3] = {colors[0].data(0, 2 * y), colors[1].data(0, 2 * y), colors[2].data(0, 2 * y)};
+        const Npp8u *bottom[3] = {colors[0].data(0, 2 * y + 1), colors[1].data(0, 2 * y + 1),
+                                  colors[2].data(0, 2 * y + 1)};
+        encoder.blockRow(top, bottom, width, band);
+    });
+}
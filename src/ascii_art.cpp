@@ -19,23 +19,34 @@
 #include <ImageIO.h>
 #include <ImagesCPU.h>
 #include <ImagesNPP.h>
+#include <climits>
 #include <cmath>
 #include <cuda_runtime.h>
 #include <filesystem> // Requires c++ 17
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <limits>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <tuple>
 
 #include <helper_cuda.h>
+#include <helper_image.h>
 #include <helper_string.h>
 #include <npp.h>
 #include <string.h>
 
 #include "ascii_art.h"
+#include "color_image.h"
+#include "cpu_dispatch.h"
+#include "output_assembler.h"
+#include "parallel.h"
+#include "profiler.h"
+#include "render_plan.h"
+#include "synthetic.h"
+#include "trace.h"
 
 using namespace std;
 namespace fs = std::filesystem;
@@ -43,10 +54,11 @@ namespace fs = std::filesystem;
 void usage(char * program) {
   cout
   << "ASCII Art - PGM to ASCII Art." << endl
-  << "  Usage: " << program << "image.pgm [width [filter [asciiPattern]]]" << endl
+  << "  Usage: " << program << " [options] image.pgm [width [filter [asciiPattern]]]" << endl
   << "  Applies one of the edge detection filters over the input image" << endl
+  << "  image.pgm: Image path, or synthetic:WIDTHxHEIGHT[:SEED] to generate a test image in memory" << endl
   << "  width: Width of the ASCII representation, 0 = original size, default = 80" << endl
-  << "  asciiPattern: ASCII pattern to calculate gray scale. First character is black, last is white." << endl
+  << "  asciiPattern: ASCII (or UTF-8) pattern to calculate gray scale. First character is black, last is white." << endl
   << "  - 1 : Sobel X" << endl
   << "  - 2 : Sobel Y" << endl
   << "  - 3 : Scharr X" << endl
@@ -56,17 +68,61 @@ void usage(char * program) {
   << "  - 7 : Kayali X" << endl
   << "  - 9 : Kayali Y" << endl
   << "  - 9 : Prewitt X" << endl
-  << "  - 10: Prewitt Y" << endl;
+  << "  - 10: Prewitt Y" << endl
+  << "  Options (--name=value or --name value, optional values only as --name=value):" << endl
+  << "  --widths=w1,w2,...   Render every width (overrides width)" << endl
+  << "  --filters=f1,f2,...  Render every filter (overrides filter), all = every filter" << endl
+  << "  --pattern=pattern    Render with this pattern, may be repeated (overrides asciiPattern)" << endl
+  << "  --output=template    Output path, {w} = width, {f} = filter number, {filter} = filter name," << endl
+  << "                       {p} = pattern index. Default: - (standard output)" << endl
+  << "  --plan               Print the render plan (shared work) to the standard error" << endl
+  << "  --preview            Show every filter side by side, to pick the best one" << endl
+  << "  --order=order        filter-first (default): filter at full resolution, then resize" << endl
+  << "                       resize-first: area average down to 3x the width, filter, then resize" << endl
+  << "                       auto: resize first when the estimated cost is lower" << endl
+  << "  --sampling=sampling  resize (default, npp backend): cubic resize to the ASCII art size" << endl
+  << "                       area (default, host backend): each character is the mean of the cell it covers" << endl
+  << "  --backend=backend    npp (default): filter and resize on the CUDA device" << endl
+  << "                       host: host filter and area sampling, no CUDA device" << endl
+  << "  --mode=mode          text (default): one grey level per character, a glyph of the pattern" << endl
+  << "                       braille: 2 x 4 dots per character, Unicode Braille (pattern ignored)" << endl
+  << "                       halfblock: 2 pixels per character, upper half block in two colors (no filter)" << endl
+  << "  --threshold=t        Grey level of a Braille dot (1 - 255, default 128), dither = ordered dithering" << endl
+  << "  --color=color        none (default), 256 or truecolor: ANSI color of every character, from the image" << endl
+  << "                       (halfblock mode: truecolor by default)" << endl
+  << "  --format=format      text (default) or html: a <pre>, one <span> per run of a color" << endl
+  << "  --luma=weights       Grey level of color images: bt601 (default) or bt709" << endl
+  << "  --blur=radius        Box blur the image before filtering" << endl
+  << "  --profile[=path]     Time every stage and write a JSON report (default: standard error)" << endl
+  << "  --counters           Add hardware performance counters to the profile (implies --profile)" << endl
+  << "  --threads=n          Host threads of the parallel loops. Default: hardware threads" << endl
+  << "  --cpu=level          Highest SIMD level of the host kernels: scalar, sse4.2, avx2, avx512. Default: detected" << endl
+  << "  --tune[=classes]     Tune the host stages for this CPU (small,medium,large,huge; default all) and exit" << endl
+  << "  --tuning=path        Tuning cache, \"none\" to ignore it. Default: ~/.cache/asciiArtNpp/tuning.txt" << endl
+  << "  --trace=path         Write a Chrome trace of every thread (builds with TRACE=1 only)" << endl
+  << "  --repeat=n           With --profile, measure n runs and report percentiles. Default: 1" << endl
+  << "  --warmup=m           With --profile, run m times before measuring. Default: 0" << endl;
 }
 
-bool getCPUandDeviceImage(const string &imagePath, npp::ImageCPU_8u_C1 &hostImage, npp::ImageNPP_8u_C1 &deviceImage)
+bool getCPUandDeviceImage(const string &imagePath, npp::ImageCPU_8u_C1 &hostImage, npp::ImageNPP_8u_C1 &deviceImage,
+                          npp::ImageCPU_8u_C1 *colorPlanes)
 {
     try
     {
         // Load image on host
         npp::ImageCPU_8u_C1 oHost;
-        npp::loadImage(imagePath, oHost);
+        {
+            ProfileScope scope(STAGE_DECODE);
+            if (!loadHostImage(imagePath, oHost, colorPlanes))
+            {
+                return false;
+            }
+            double pixels = (double)oHost.width() * oHost.height();
+            double fileBytes = isSyntheticImage(imagePath) ? 0 : (double)fs::file_size(imagePath);
+            scope.count(fileBytes + pixels * (colorPlanes ? 4 : 1), pixels);
+        }
         // Create image on device. This allocates memory and copies to device.
+        ProfileScope scope(STAGE_UPLOAD, (double)oHost.width() * oHost.height(), (double)oHost.width() * oHost.height(), true);
         npp::ImageNPP_8u_C1 oDevice(oHost);
         // Update target reference to host
         oHost.swap(hostImage);
@@ -81,7 +137,152 @@ bool getCPUandDeviceImage(const string &imagePath, npp::ImageCPU_8u_C1 &hostImag
     return true;
 }
 
-NppStatus resizeDeviceImage(npp::ImageNPP_8u_C1 &src, NppiSize dstSize, npp::ImageNPP_8u_C1 &dst, const NppStreamContext &nppStreamCtx)
+/**
+ * @brief Reads the header of a binary 8-bit PGM (P5) image
+ * @param imagePath Path to the image file
+ * @param size Reference to the image size
+ * @return true if the file is a binary PGM with at most 255 grey levels, false otherwise
+ */
+static bool readPGMHeader(const string &imagePath, NppiSize &size)
+{
+    ifstream ifs(imagePath, ios::binary);
+    char magic[2];
+    if (!ifs.read(magic, 2) || magic[0] != 'P' || magic[1] != '5')
+    {
+        return false;
+    }
+
+    // Width, height and maximum grey level, separated by white space and comments
+    int values[3];
+    for (int &value : values)
+    {
+        ifs >> ws;
+        while (ifs.peek() == '#')
+        {
+            ifs.ignore(numeric_limits<streamsize>::max(), '\n');
+            ifs >> ws;
+        }
+        if (!(ifs >> value))
+        {
+            return false;
+        }
+    }
+
+    size = {values[0], values[1]};
+    return size.width > 0 && size.height > 0 && values[2] > 0 && values[2] < 256;
+}
+
+/**
+ * @brief Reads the header of an image through FreeImage, without decoding its pixels
+ * @param imagePath Path to the image file
+ * @return Bitmap without pixels, to unload by the caller, nullptr if the format is unknown or can not be read
+ */
+static FIBITMAP *loadImageHeader(const string &imagePath)
+{
+    FREE_IMAGE_FORMAT eFormat = FreeImage_GetFileType(imagePath.c_str());
+
+    // no signature? try to guess the file format from the file extension
+    if (eFormat == FIF_UNKNOWN)
+    {
+        eFormat = FreeImage_GetFIFFromFilename(imagePath.c_str());
+    }
+
+    if (eFormat == FIF_UNKNOWN || !FreeImage_FIFSupportsReading(eFormat))
+    {
+        return nullptr;
+    }
+
+    return FreeImage_Load(eFormat, imagePath.c_str(), FIF_LOAD_NOPIXELS);
+}
+
+bool loadHostImage(const string &imagePath, npp::ImageCPU_8u_C1 &hostImage, npp::ImageCPU_8u_C1 *colorPlanes)
+{
+    TRACE_SCOPE("io", "load image");
+
+    // Generated in memory, no file
+    NppiSize size;
+    unsigned int seed;
+    if (isSyntheticImage(imagePath))
+    {
+        if (!parseSyntheticImage(imagePath, size, seed))
+        {
+            cerr << "Invalid synthetic image " << imagePath << ", expected " << SYNTHETIC_PREFIX
+                 << "WIDTHxHEIGHT[:SEED] of at most " << INT_MAX << " pixels" << endl;
+            return false;
+        }
+        generateImage(size, seed, hostImage);
+        if (colorPlanes)
+        {
+            greyPlanes(hostImage, colorPlanes);
+        }
+        return true;
+    }
+
+    // 8-bit PGM: read directly, without FreeImage
+    if (readPGMHeader(imagePath, size))
+    {
+        unsigned char *pData = nullptr;
+        unsigned int width, height;
+        if (!sdkLoadPGM(imagePath.c_str(), &pData, &width, &height))
+        {
+            return false;
+        }
+
+        npp::ImageCPU_8u_C1 oImage(width, height);
+        for (unsigned int y = 0; y < height; y++)
+        {
+            memcpy(oImage.data(0, y), pData + (size_t)y * width, width);
+        }
+        free(pData);
+        oImage.swap(hostImage);
+        if (colorPlanes)
+        {
+            greyPlanes(hostImage, colorPlanes);
+        }
+        return true;
+    }
+
+    try
+    {
+        // Color pixels to luma (and planes) in the row copy of the decoder
+        ColorRowConverter converter;
+        npp::loadImage(imagePath, hostImage, converter, colorPlanes);
+    }
+    catch (npp::Exception &e)
+    {
+        cerr << e.message() << endl;
+        return false;
+    }
+    return true;
+}
+
+bool getImageSize(const string &imagePath, NppiSize &size)
+{
+    unsigned int seed;
+    if (isSyntheticImage(imagePath))
+    {
+        return parseSyntheticImage(imagePath, size, seed);
+    }
+
+    if (readPGMHeader(imagePath, size))
+    {
+        return true;
+    }
+
+    // Read the header only
+    FIBITMAP *pBitmap = loadImageHeader(imagePath);
+    if (!pBitmap)
+    {
+        return false;
+    }
+
+    size = {(int)FreeImage_GetWidth(pBitmap), (int)FreeImage_GetHeight(pBitmap)};
+    FreeImage_Unload(pBitmap);
+
+    return true;
+}
+
+NppStatus resizeDeviceImage(npp::ImageNPP_8u_C1 &src, NppiSize dstSize, npp::ImageNPP_8u_C1 &dst, const NppStreamContext &nppStreamCtx, int eInterpolation)
 {
 
     // Get source image dimensions
@@ -96,8 +297,6 @@ NppStatus resizeDeviceImage(npp::ImageNPP_8u_C1 &src, NppiSize dstSize, npp::Ima
     // output ROI {upper left x, upper left y, ROI width, ROI height}
     NppiRect dstROI = {0, 0, dstSize.width, dstSize.height};
 
-    int eInterpolation = NPPI_INTER_CUBIC;
-
     NppStatus nppStatus = nppiResize_8u_C1R_Ctx(
         src.data(),
         src.pitch(),
@@ -133,19 +332,6 @@ NppStatus getStreamContext(NppStreamContext &nppStreamCtx, cudaStream_t stream)
     // Associate this stream context to the selected stream
     nppStreamCtx.hStream = stream;
 
-    // Get NPP version
-    const NppLibraryVersion *libVer = nppGetLibVersion();
-
-    // cout << "NPP Library Version" << libVer->major << "." << libVer->minor << "." << libVer->build << endl;
-
-    // Get driver and runtime version
-    int driverVersion, runtimeVersion;
-    cudaDriverGetVersion(&driverVersion);
-    cudaRuntimeGetVersion(&runtimeVersion);
-
-    // cout << "CUDA Driver  Version: " << driverVersion / 1000 << "." << (driverVersion % 100) / 10 << endl;
-    // cout << "CUDA Runtime Version: " << runtimeVersion / 1000 << "." << (runtimeVersion % 100) / 10 << endl;
-
     // Set capability fields on this stream context
     cudaError = cudaDeviceGetAttribute(&nppStreamCtx.nCudaDevAttrComputeCapabilityMajor,
                                        cudaDevAttrComputeCapabilityMajor,
@@ -178,31 +364,182 @@ NppStatus getStreamContext(NppStreamContext &nppStreamCtx, cudaStream_t stream)
 
 ostream &outAsciiArt(ostream &out, npp::ImageNPP_8u_C1 &img,  int filter, string asciiPattern)
 {
+    // Create host image based on device image size
+    npp::ImageCPU_8u_C1 hostImg(img.size());
+
+    // Copy to host
+    img.copyTo(hostImg.data(), hostImg.pitch());
 
-    if (!asciiPattern.length())
+    return outAsciiArt(out, hostImg, asciiPattern);
+}
+
+/**
+ * @brief Default pattern, first character is black
+ */
+static const char *defaultAsciiPattern = "  -.,-=+:;cba?0123456789$WN#@";
+// static const char *defaultAsciiPattern = "    .:-i|=+xO#@";
+
+void asciiPatternTable(const char *asciiPattern, char table[256])
+{
+    if (asciiPattern == nullptr || *asciiPattern == '\0')
     {
-        asciiPattern = "  -.,-=+:;cba?0123456789$WN#@";
-        // asciiPattern ="    .:-i|=+xO#@";
+        asciiPattern = defaultAsciiPattern;
     }
 
-    // Create host image based on device image size
-    npp::ImageCPU_8u_C1 hostImg(img.size());
+    // Character of every grey level
+    int patternLength = strlen(asciiPattern);
+    for (int grey = 0; grey < 256; grey++)
+    {
+        int patternIndex = (grey * patternLength - 1) / 255;
+        table[grey] = asciiPattern[patternIndex];
+    }
+}
+
+/**
+ * @brief Bytes of the UTF-8 sequence starting at a byte, 1 if it is not a valid sequence
+ */
+static int utf8Length(const unsigned char *s)
+{
+    int length = 1;
+    if ((s[0] & 0xE0) == 0xC0)
+    {
+        length = 2;
+    }
+    else if ((s[0] & 0xF0) == 0xE0)
+    {
+        length = 3;
+    }
+    else if ((s[0] & 0xF8) == 0xF0)
+    {
+        length = 4;
+    }
+    for (int i = 1; i < length; i++)
+    {
+        // Also stops at the terminating zero
+        if ((s[i] & 0xC0) != 0x80)
+        {
+            return 1;
+        }
+    }
+    return length;
+}
+
+void glyphTable(const char *asciiPattern, GlyphTable &table)
+{
+    if (asciiPattern == nullptr || *asciiPattern == '\0')
+    {
+        asciiPattern = defaultAsciiPattern;
+    }
+
+    // Glyphs of the pattern, counted without allocating (renders call this every time)
+    int patternLength = 0;
+    for (const char *p = asciiPattern; *p != '\0'; p += utf8Length((const unsigned char *)p))
+    {
+        patternLength++;
+    }
 
+    // Same mapping as asciiPatternTable(), on glyphs instead of bytes. The glyph
+    // index never decreases with the grey level, so the pattern is walked once.
+    const char *current = asciiPattern;
+    int currentIndex = 0;
+    table.maxLength = 0;
+    for (int grey = 0; grey < 256; grey++)
+    {
+        int patternIndex = (grey * patternLength - 1) / 255;
+        for (; currentIndex < patternIndex; currentIndex++)
+        {
+            current += utf8Length((const unsigned char *)current);
+        }
+        int length = utf8Length((const unsigned char *)current);
+        char glyph[GLYPH_BYTES] = {0};
+        memcpy(glyph, current, length);
+        memcpy(&table.glyphs[grey], glyph, GLYPH_BYTES);
+        table.lengths[grey] = (Npp8u)length;
+        table.ascii[grey] = glyph[0];
+        table.maxLength = max(table.maxLength, length);
+    }
+
+    table.fixedLength = table.maxLength;
+    for (int grey = 0; grey < 256; grey++)
+    {
+        if (table.lengths[grey] != table.maxLength)
+        {
+            table.fixedLength = 0;
+        }
+    }
+}
+
+int encodeGlyphRow(const Npp8u *src, int width, const GlyphTable &table, char *dst)
+{
+    if (table.fixedLength == 1)
+    {
+        hostKernels().quantizeRow(src, width, table.ascii, dst);
+        return width;
+    }
+    return hostKernels().glyphRow(src, width, table.glyphs, table.lengths, dst);
+}
+
+size_t asciiArtOffsets(const Npp8u *pSrc, int nSrcStep, NppiSize size, const GlyphTable &table,
+                       vector<size_t> &offsets)
+{
+    vector<size_t> chunkBytes;
+    return asciiArtOffsets(pSrc, nSrcStep, size, table, offsets, chunkBytes);
+}
+
+size_t asciiArtOffsets(const Npp8u *pSrc, int nSrcStep, NppiSize size, const GlyphTable &table,
+                       vector<size_t> &offsets, vector<size_t> &chunkBytes)
+{
+    if (table.fixedLength > 0)
+    {
+        offsets.clear();
+        return ((size_t)size.width * table.fixedLength + 1) * size.height;
+    }
+
+    return rowOffsets(size.height, [&](int y) {
+        const Npp8u *row = pSrc + (size_t)y * nSrcStep;
+        size_t bytes = 1;
+        for (int x = 0; x < size.width; x++)
+        {
+            bytes += table.lengths[row[x]];
+        }
+        return bytes;
+    }, offsets, chunkBytes);
+}
+
+void quantizeAsciiArt(const Npp8u *pSrc, int nSrcStep, NppiSize size, const GlyphTable &table,
+                      const vector<size_t> &offsets, char *out)
+{
+    if (offsets.empty())
+    {
+        size_t lineBytes = (size_t)size.width * table.fixedLength + 1;
+        parallelFor(size.height, [&](int chunk, int begin, int end) {
+            for (int y = begin; y < end; y++)
+            {
+                char *line = out + y * lineBytes;
+                line[encodeGlyphRow(pSrc + (size_t)y * nSrcStep, size.width, table, line)] = '\n';
+            }
+        });
+        return;
+    }
+
+    // Every row at its offset, whatever the thread that encodes it
+    assembleRows(size.height, offsets, [&](int y, char *line) {
+        line[encodeGlyphRow(pSrc + (size_t)y * nSrcStep, size.width, table, line)] = '\n';
+    }, out);
+}
+
+ostream &outAsciiArt(ostream &out, const npp::ImageCPU_8u_C1 &hostImg, string asciiPattern)
+{
     // Get image size
     NppiSize imgSize = {(int)hostImg.width(), (int)hostImg.height()};
 
-    // Copy to host
-    img.copyTo(hostImg.data(), hostImg.pitch());
+    GlyphTable table;
+    glyphTable(asciiPattern.c_str(), table);
 
-    int patternLength = asciiPattern.length();
+    string line((size_t)imgSize.width * table.maxLength, ' ');
     for (int i = 0; i < imgSize.height; i++)
     {
-        for (int j = 0; j < imgSize.width; j++)
-        {
-            int grey = hostImg.pixels(j, i)->x;
-            int patternIndex = (grey * patternLength - 1) / 255;
-            out << asciiPattern[patternIndex];
-        }
+        out.write(line.data(), encodeGlyphRow(hostImg.data(0, i), imgSize.width, table, &line[0]));
         out << endl;
     }
     return out;
@@ -210,7 +547,7 @@ ostream &outAsciiArt(ostream &out, npp::ImageNPP_8u_C1 &img,  int filter, string
 
 NppStatus convolutionFilter(npp::ImageNPP_8u_C1 &src,
                             npp::ImageNPP_8u_C1 &dst,
-                            Npp32s *kernel,
+                            const Npp32s *kernel,
                             NppiSize kernelSize,
                             NppiPoint anchor,
                             Npp32s divisor,
@@ -225,14 +562,17 @@ NppStatus convolutionFilter(npp::ImageNPP_8u_C1 &src,
     Npp32s *deviceKernel;
     // Allocate memory for the kernel and copy to device
     cudaMalloc((void **)&deviceKernel, kernelSize.width * kernelSize.height * sizeof(Npp32s));
+    npp::allocated(npp::ALLOCATION_DEVICE, deviceKernel, kernelSize.width * kernelSize.height * sizeof(Npp32s));
     cudaMemcpy(deviceKernel, kernel, kernelSize.width * kernelSize.height * sizeof(Npp32s), cudaMemcpyHostToDevice);
 
-    // Apply convolution filter
-    NppStatus nppStatus = nppiFilter_8u_C1R_Ctx(src.data(), src.pitch(),
+    // Apply convolution filter. NPP reads the neighborhood at (x - anchor.x, y - anchor.y),
+    // so the source ROI starts at the anchor to keep every read inside the image.
+    NppStatus nppStatus = nppiFilter_8u_C1R_Ctx(src.data(anchor.x, anchor.y), src.pitch(),
                                                 deviceDst.data(), deviceDst.pitch(),
                                                 srcROI, deviceKernel, kernelSize, anchor, divisor, nppStreamCtx);
 
     // Release device kernel memory
+    npp::freed(npp::ALLOCATION_DEVICE, deviceKernel);
     err = cudaFree(deviceKernel);
 
     if (err != cudaSuccess)
@@ -247,21 +587,43 @@ NppStatus convolutionFilter(npp::ImageNPP_8u_C1 &src,
 }
 
 
-/**
- * @brief Available filters. Feel free to add more!
- */
-typedef enum {
-    SOBEL_X,
-    SOBEL_Y,
-    SCHARR_X,
-    SCHARR_Y,
-    SCHARR_X_IMPROVED,
-    SCHARR_Y_IMPROVED,
-    KAYALI_X,
-    KAYALI_Y,
-    PREWITT_X,
-    PREWITT_Y
-}ConvolutionFilter;
+const Npp32s filterKernels[FILTER_COUNT][9] = {
+    {-1, 0, 1, -2, 0, 2, -1, 0, 1}, // Sobel x
+    {-1, -2, -1, 0, 0, 0, 1, 2, 1}, // Sobel y
+    {3, 0, -3, 10, 0, -10, 3, 0, -3}, // Scharr x
+    {3, 10, 3, 0, 0, 0, -3, -10, -3}, // Scharr y
+    {47, 0, -47, 162, 0, -162, 47, 0, -47}, // Scharr x (2)
+    {47, 162, 47, 0, 0, 0, -47, -162, -47}, // Scharr y (2)
+    {6, 0, -6, 0, 0, 0, -6, 0, 6}, // Kayali x
+    {-6, 0, 6, 0, 0, 0, 6, 0, -6}, // Kayali y
+    {1, 1, 1, 0, 0, 0, -1, -1, -1}, // Prewitt X
+    {1, 0, -1, 1, 0, -1, 1, 0, -1}, // Prewitt Y
+};
+
+int effectiveFilter(int filter)
+{
+    if (filter < 0 || filter >= FILTER_COUNT)
+    {
+        return PREWITT_X;
+    }
+    return filter;
+}
+
+const char *filterName(int filter)
+{
+    static const char *names[FILTER_COUNT] = {
+        "sobel_x",
+        "sobel_y",
+        "scharr_x",
+        "scharr_y",
+        "scharr_x_improved",
+        "scharr_y_improved",
+        "kayali_x",
+        "kayali_y",
+        "prewitt_x",
+        "prewitt_y"};
+    return names[effectiveFilter(filter)];
+}
 
 /**
  * @brief Sobel X filter
@@ -272,8 +634,7 @@ typedef enum {
  */
 NppStatus SobelXFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, const NppStreamContext &nppStreamCtx)
 {
-    Npp32s kernel[9] = {-1, 0, 1, -2, 0, 2, -1, 0, 1}; // Sobel x
-    return convolutionFilter(src, dst, kernel, {3, 3}, {2, 2}, 1, nppStreamCtx);
+    return convolutionFilter(src, dst, filterKernels[SOBEL_X], {3, 3}, {2, 2}, 1, nppStreamCtx);
 }
 
 /**
@@ -285,8 +646,7 @@ NppStatus SobelXFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, const
  */
 NppStatus SobelYFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, const NppStreamContext &nppStreamCtx)
 {
-    Npp32s kernel[9] = {-1, -2, -1, 0, 0, 0, 1, 2, 1}; // Sobel y
-    return convolutionFilter(src, dst, kernel, {3, 3}, {2, 2}, 1, nppStreamCtx);
+    return convolutionFilter(src, dst, filterKernels[SOBEL_Y], {3, 3}, {2, 2}, 1, nppStreamCtx);
 }
 
 /**
@@ -298,8 +658,7 @@ NppStatus SobelYFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, const
  */
 NppStatus ScharrXFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, const NppStreamContext &nppStreamCtx)
 {
-    Npp32s kernel[9] = {3, 0, -3, 10, 0, -10, 3, 0, -3}; // Scharr x
-    return convolutionFilter(src, dst, kernel, {3, 3}, {2, 2}, 1, nppStreamCtx);
+    return convolutionFilter(src, dst, filterKernels[SCHARR_X], {3, 3}, {2, 2}, 1, nppStreamCtx);
 }
 
 /**
@@ -311,8 +670,7 @@ NppStatus ScharrXFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, cons
  */
 NppStatus ScharrYFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, const NppStreamContext &nppStreamCtx)
 {
-    Npp32s kernel[9] = {3, 10, 3, 0, 0, 0, -3, -10, -3}; // Scharr y
-    return convolutionFilter(src, dst, kernel, {3, 3}, {2, 2}, 1, nppStreamCtx);
+    return convolutionFilter(src, dst, filterKernels[SCHARR_Y], {3, 3}, {2, 2}, 1, nppStreamCtx);
 }
 
 /**
@@ -324,8 +682,7 @@ NppStatus ScharrYFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, cons
  */
 NppStatus ScharrXImprovedFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, const NppStreamContext &nppStreamCtx)
 {
-    Npp32s kernel[9] = {47, 0, -47, 162, 0, -162, 47, 0, -47}; // Scharr x (2)
-    return convolutionFilter(src, dst, kernel, {3, 3}, {2, 2}, 1, nppStreamCtx);
+    return convolutionFilter(src, dst, filterKernels[SCHARR_X_IMPROVED], {3, 3}, {2, 2}, 1, nppStreamCtx);
 }
 
 /**
@@ -337,8 +694,7 @@ NppStatus ScharrXImprovedFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &d
  */
 NppStatus ScharrYImprovedFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, const NppStreamContext &nppStreamCtx)
 {
-    Npp32s kernel[9] = {47, 162, 47, 0, 0, 0, -47, -162, -47}; // Scharr y (2)
-    return convolutionFilter(src, dst, kernel, {3, 3}, {2, 2}, 1, nppStreamCtx);
+    return convolutionFilter(src, dst, filterKernels[SCHARR_Y_IMPROVED], {3, 3}, {2, 2}, 1, nppStreamCtx);
 }
 
 /**
@@ -350,8 +706,7 @@ NppStatus ScharrYImprovedFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &d
  */
 NppStatus KayaliXFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, const NppStreamContext &nppStreamCtx)
 {
-    Npp32s kernel[9] = {6, 0, -6, 0, 0, 0, -6, 0, 6}; // Kayali x
-    return convolutionFilter(src, dst, kernel, {3, 3}, {2, 2}, 1, nppStreamCtx);
+    return convolutionFilter(src, dst, filterKernels[KAYALI_X], {3, 3}, {2, 2}, 1, nppStreamCtx);
 }
 
 /**
@@ -363,8 +718,7 @@ NppStatus KayaliXFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, cons
  */
 NppStatus KayaliYFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, const NppStreamContext &nppStreamCtx)
 {
-    Npp32s kernel[9] = {-6, 0, 6, 0, 0, 0, 6, 0, -6}; // Kayali y
-    return convolutionFilter(src, dst, kernel, {3, 3}, {2, 2}, 1, nppStreamCtx);
+    return convolutionFilter(src, dst, filterKernels[KAYALI_Y], {3, 3}, {2, 2}, 1, nppStreamCtx);
 }
 
 /**
@@ -376,8 +730,7 @@ NppStatus KayaliYFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, cons
  */
 NppStatus PrewittXFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, const NppStreamContext &nppStreamCtx)
 {
-    Npp32s kernel[9] = {1, 1, 1, 0, 0, 0, -1, -1, -1}; // Prewitt X
-    return convolutionFilter(src, dst, kernel, {3, 3}, {2, 2}, 1, nppStreamCtx);
+    return convolutionFilter(src, dst, filterKernels[PREWITT_X], {3, 3}, {2, 2}, 1, nppStreamCtx);
 }
 
 /**
@@ -389,17 +742,9 @@ NppStatus PrewittXFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, con
  */
 NppStatus PrewittYFilter(npp::ImageNPP_8u_C1 &src, npp::ImageNPP_8u_C1 &dst, const NppStreamContext &nppStreamCtx)
 {
-    Npp32s kernel[9] = {1, 0, -1, 1, 0, -1, 1, 0, -1}; // Prewitt Y
-    return convolutionFilter(src, dst, kernel, {3, 3}, {2, 2}, 1, nppStreamCtx);
+    return convolutionFilter(src, dst, filterKernels[PREWITT_Y], {3, 3}, {2, 2}, 1, nppStreamCtx);
 }
 
-/**
- * @brief Applies the selected convolution filter
- * @param filter number
- * @param src Source image on device
- * @param dst Reference to destination image where result is stored
- * @preturn NPP_NO_ERROR on success, npp error otherwise.
- */
 NppStatus applyConvolutionFilter(int filter,
     npp::ImageNPP_8u_C1 &src,
     npp::ImageNPP_8u_C1 &dst,
@@ -442,181 +787,33 @@ NppStatus applyConvolutionFilter(int filter,
     }
 }
 
-/**
- * @brief Image ASCII Art. Transforms an 8-bit gray image to ASCII art
- * @param imagePath Image path
- * @param outColumns Width of the ASCII art, defaults to 80. 0 = no resize, outColumns < 0: Resize to abs(outColumns)
- * @param filter Edge detection filter
- * @param asciiPattern ASCII pattern to interpret grey intensity. [0] is black, [.length() - 1] is white.
- * @return true if successful, false otherwise.
- */
-bool imageASCIIArt(const string &imagePath, int outColumns = 80, int filter=-1, string asciiPattern = "")
+NppiSize asciiArtSize(NppiSize srcSize, NppiSize filteredSize, int outColumns)
 {
-    fs::path srcPath(imagePath);
-
-    if (!fs::exists(srcPath))
+    // If outColumns < 0, set to abs(outColumns)
+    if (outColumns < 0)
     {
-        cerr << "Image " << imagePath << " does not exist or is not accessible" << endl;
-        return false;
+        outColumns = abs(outColumns);
     }
-
-    cudaError_t err;
-    NppStatus nppStatus;
-
-    NppStreamContext nppStreamCtx;
-
-    // Get stream context
-    nppStatus = getStreamContext(nppStreamCtx);
-
-    if (nppStatus != NPP_SUCCESS)
+    else if (outColumns == 0)
     {
-        cerr << "Unable to get NPP stream context";
-        return false;
+        outColumns = srcSize.width;
     }
 
-    try
-    {
-        npp::ImageCPU_8u_C1 oHostSrc;
-        npp::ImageNPP_8u_C1 oDeviceSrc;
-
-        // Load image into CPU and GPU instances
-        getCPUandDeviceImage(imagePath, oHostSrc, oDeviceSrc);
-
-        npp::ImageNPP_8u_C1 oDeviceDst;
-        //nppStatus = PrewittXFilter(oDeviceSrc, oDeviceDst, nppStreamCtx);
-        nppStatus = applyConvolutionFilter(filter, oDeviceSrc, oDeviceDst, nppStreamCtx);
-        if (nppStatus != NPP_NO_ERROR)
-        {
-            cerr << "Error applying filter" << endl;
-            nppiFree(oDeviceSrc.data());
-            nppiFree(oDeviceDst.data());
-            return false;
-        }
-
-        // Calculate outColumns depending on parameters
-
-        // Get size of source image
-        NppiSize oSrcSize = {(int)oHostSrc.width(), (int)oHostSrc.height()};
-
-        // cout << "Dimensions: " << oSrcSize.width << " x " << oSrcSize.height << " pitch: " << oHostSrc.pitch() << endl;
-
-        // If outColumns < 0, set to abs(outColumns)
-        if (outColumns < 0)
-        {
-            outColumns = abs(outColumns);
-        }
-        else if (outColumns == 0)
-        {
-            outColumns = oSrcSize.width;
-        }
-
-        if (outColumns == oSrcSize.width)
-        {
-            // Don't resize image
-            // Create ASCII art and store it into oss
-            ostringstream oss;
-
-            outAsciiArt(oss, oDeviceDst, filter, asciiPattern);
-
-            // Send oss to cout, or any other output stream
-            cout << oss.str();
-        }
-        else
-        {
-            // Resize filtered device image
-
-            npp::ImageNPP_8u_C1 oDeviceDstResized;
-
-            // Get size of the host destination image
-            NppiSize oDstSize = {(int)oDeviceDst.width(), (int)oDeviceDst.height()};
-            // cout << "Destination size: " << oDstSize.width << " x " << oDstSize.height << endl;
-
-            // Resize resulting image
-            // Calculate resize factor to fit into outColumns
-            float resizeFactor = (float)outColumns / (float)oSrcSize.width;
-
-            NppiSize oDstResizedSize = oDstSize;
-
-            if (resizeFactor < 1)
-            {
-                oDstResizedSize = {(int)ceil((float)oSrcSize.width * resizeFactor), (int)ceil((float)oSrcSize.height * resizeFactor)};
-            }
-
-            // Resize te image and store on oDstResizedSize
-            nppStatus = resizeDeviceImage(oDeviceDst, oDstResizedSize, oDeviceDstResized, nppStreamCtx);
+    // Calculate resize factor to fit into outColumns
+    float resizeFactor = (float)outColumns / (float)srcSize.width;
 
-            if (nppStatus != NPP_NO_ERROR)
-            {
-                cerr << "Error resizing image" << endl;
-                return false;
-            }
-
-            // Create ASCII art and store it into oss
-            ostringstream oss;
-
-            outAsciiArt(oss, oDeviceDstResized, filter, asciiPattern);
-
-            // Send oss to cout, or any other output stream
-            cout << oss.str();
-
-            // Release resized image data
-            nppiFree(oDeviceDstResized.data());
-        }
-
-        // Free nppi device memory
-        nppiFree(oDeviceSrc.data());
-        nppiFree(oDeviceDst.data());
-    }
-    catch (npp::Exception &ex)
+    if (outColumns == srcSize.width || resizeFactor >= 1)
     {
-        cerr << ex.message() << endl;
-        return false;
+        // Don't resize image
+        return filteredSize;
     }
 
-    return true;
+    return {(int)ceil((float)srcSize.width * resizeFactor), (int)ceil((float)srcSize.height * resizeFactor)};
 }
 
-int main(int argc, char *argv[])
+bool imageASCIIArt(const string &imagePath, int outColumns, int filter, string asciiPattern)
 {
-
-    // Path to a pgm image
-    string imagePath = "teapot512.pgm";
-
-    // Default - resize to 80 chars width terminal, set to 0 for no resize
-    int columnWidth = 80;
-
-    // ASCII pattern. It should start with space character " " for black.
-    string asciiPattern = "  -.,-=+:;cba?0123456789$WN#@";
-
-    // Edge detection filter.
-    int filter = -1;
-
-    // Parse image path
-    if (argc == 1)
-    {
-        usage(argv[0]);
-        exit(0);
-    }
-
-    // Get image path
-    imagePath = string(argv[1]);
-
-    // Parse column width
-    if (argc > 2)
-    {
-        columnWidth = std::stoi(argv[2]);
-    }
-
-    if (argc > 3) {
-        filter = std::stoi(argv[3]);
-    }
-
-    // Parse ASCII pattern
-    if (argc > 4)
-    {
-        asciiPattern = string(argv[4]);
-    }
-
-    // Do de magic!
-    imageASCIIArt(imagePath, columnWidth, filter, asciiPattern);
-}
\ No newline at end of file
+    RenderOptions options = {false, ORDER_FILTER_FIRST, SAMPLING_RESIZE, 0, BACKEND_NPP, MODE_TEXT,
+                             BRAILLE_THRESHOLD, COLOR_NONE, FORMAT_TEXT};
+    return renderASCIIArt(imagePath, {{outColumns, filter, asciiPattern, "-"}}, options);
+}
@@ -0,0 +1,82 @@
+/**
+ * @file
+ * @brief Braille - 2 x 4 dots per character
+ * See braille.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <vector>
+
+#include "braille.h"
+#include "cpu_dispatch.h"
+#include "parallel.h"
+
+using namespace std;
+
+const string &braillePattern()
+{
+    static const string pattern = [] {
+        // U+2800 + bits: E2 A0 + bits / 64, 80 + bits % 64
+        string p;
+        for (int bits = 0; bits < 256; bits++)
+        {
+            p += (char)0xE2;
+            p += (char)(0xA0 | (bits >> 6));
+            p += (char)(0x80 | (bits & 0x3F));
+        }
+        return p;
+    }();
+    return pattern;
+}
+
+NppiSize brailleCellSize(NppiSize dotSize)
+{
+    return {(dotSize.width + BRAILLE_CELL_WIDTH - 1) / BRAILLE_CELL_WIDTH,
+            (dotSize.height + BRAILLE_CELL_HEIGHT - 1) / BRAILLE_CELL_HEIGHT};
+}
+
+void brailleThresholds(int threshold, Npp8u thresholds[16])
+{
+    static const int bayer[16] = {0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5};
+    for (int i = 0; i < 16; i++)
+    {
+        // Dithering: thresholds spread over 8 - 248
+        thresholds[i] = (Npp8u)(threshold > 0 ? min(threshold, 255) : bayer[i] * 16 + 8);
+    }
+}
+
+void brailleCells(const npp::ImageCPU_8u_C1 &dots, const Npp8u thresholds[16], npp::ImageCPU_8u_C1 &cells)
+{
+    vector<Npp8u> blank;
+    brailleCells(dots, thresholds, cells, blank);
+}
+
+void brailleCells(const npp::ImageCPU_8u_C1 &dots, const Npp8u thresholds[16], npp::ImageCPU_8u_C1 &cells,
+                  vector<Npp8u> &blank)
+{
+    NppiSize dotSize = {(int)dots.width(), (int)dots.height()};
+    NppiSize cellSize = brailleCellSize(dotSize);
+    if ((int)cells.width() != cellSize.width || (int)cells.height() != cellSize.height)
+    {
+        npp::ImageCPU_8u_C1 oCells(cellSize.width, cellSize.height);
+        cells.swap(oCells);
+    }
+
+    // Rows past the bottom of the image have no dots
+    blank.assign(dotSize.width, 0);
+    BrailleRowKernel brailleRow = hostKernels().brailleRow;
+
+    parallelFor(cellSize.height, [&](int chunk, int begin, int end) {
+        for (int y = begin; y < end; y++)
+        {
+            const Npp8u *rows[BRAILLE_CELL_HEIGHT];
+            for (int r = 0; r < BRAILLE_CELL_HEIGHT; r++)
+            {
+                int row = y * BRAILLE_CELL_HEIGHT + r;
+                rows[r] = row < dotSize.height ? dots.data(0, row) : blank.data();
+            }
+            brailleRow(rows, dotSize.width, thresholds, cells.data(0, y));
+        }
+    });
+}
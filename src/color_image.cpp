@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @brief Color images - Luma and planes of interleaved color pixels
+ * See color_image.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <cmath>
+#include <cstring>
+
+#include "color_image.h"
+#include "cpu_dispatch.h"
+#include "parallel.h"
+
+using namespace std;
+
+/**
+ * @brief Weights selected by setLumaStandard()
+ */
+static LumaStandard &activeLumaStandard()
+{
+    static LumaStandard standard = LUMA_BT601;
+    return standard;
+}
+
+void setLumaStandard(LumaStandard standard)
+{
+    activeLumaStandard() = standard;
+}
+
+LumaStandard lumaStandard()
+{
+    return activeLumaStandard();
+}
+
+void lumaWeights(LumaStandard standard, Npp16u weights[3])
+{
+    double red = standard == LUMA_BT709 ? 0.2126 : 0.299;
+    double blue = standard == LUMA_BT709 ? 0.0722 : 0.114;
+    weights[0] = (Npp16u)lround(red * (1 << LUMA_WEIGHT_BITS));
+    weights[2] = (Npp16u)lround(blue * (1 << LUMA_WEIGHT_BITS));
+    // Green takes the rounding, so white stays white
+    weights[1] = (Npp16u)((1 << LUMA_WEIGHT_BITS) - weights[0] - weights[2]);
+}
+
+ColorRowConverter::ColorRowConverter() : pixelBytes_(3), offsets_{0, 1, 2}, weights_{0, 0, 0}, lumaRow_(nullptr),
+                                         planesRow_(nullptr)
+{
+}
+
+void ColorRowConverter::begin(int pixelBytes, const int offsets[3])
+{
+    pixelBytes_ = pixelBytes;
+    Npp16u rgbWeights[3];
+    lumaWeights(lumaStandard(), rgbWeights);
+    for (int c = 0; c < 3; c++)
+    {
+        offsets_[c] = offsets[c];
+        weights_[offsets[c]] = rgbWeights[c];
+    }
+    const HostKernels &kernels = hostKernels();
+    lumaRow_ = kernels.lumaRow;
+    planesRow_ = kernels.planesRow;
+}
+
+void ColorRowConverter::row(const Npp8u *src, int width, Npp8u *luma, Npp8u *const *planes) const
+{
+    lumaRow_(src, width, pixelBytes_, weights_, luma);
+    if (planes != nullptr)
+    {
+        planesRow_(src, width, pixelBytes_, offsets_, planes);
+    }
+}
+
+/**
+ * @brief Allocates the planes of an image of a size, unless they already have it
+ */
+static void allocatePlanes(unsigned int width, unsigned int height, npp::ImageCPU_8u_C1 planes[3])
+{
+    for (int c = 0; c < 3; c++)
+    {
+        if (planes[c].width() != width || planes[c].height() != height)
+        {
+            npp::ImageCPU_8u_C1 oPlane(width, height);
+            planes[c].swap(oPlane);
+        }
+    }
+}
+
+void planarImage(const npp::ImageCPU_8u_C3 &rgb, npp::ImageCPU_8u_C1 planes[3])
+{
+    allocatePlanes(rgb.width(), rgb.height(), planes);
+
+    static const int offsets[3] = {0, 1, 2};
+    PlanesRowKernel planesRow = hostKernels().planesRow;
+    int width = (int)rgb.width();
+    parallelFor((int)rgb.height(), [&](int chunk, int begin, int end) {
+        for (int y = begin; y < end; y++)
+        {
+            Npp8u *const rows[3] = {planes[0].data(0, y), planes[1].data(0, y), planes[2].data(0, y)};
+            planesRow(rgb.data(0, y), width, 3, offsets, rows);
+        }
+    });
+}
+
+void greyPlanes(const npp::ImageCPU_8u_C1 &grey, npp::ImageCPU_8u_C1 planes[3])
+{
+    allocatePlanes(grey.width(), grey.height(), planes);
+
+    parallelFor((int)grey.height(), [&](int chunk, int begin, int end) {
+        for (int y = begin; y < end; y++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                memcpy(planes[c].data(0, y), grey.data(0, y), grey.width());
+            }
+        }
+    });
+}
@@ -0,0 +1,182 @@
+/**
+ * @file
+ * @brief Runtime CPU dispatch of the host SIMD kernels
+ * See cpu_dispatch.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <stdlib.h>
+
+#include "cpu_dispatch.h"
+
+using namespace std;
+
+/**
+ * @brief Level names, in CpuLevel order
+ */
+static const char *cpuLevelNames[CPU_LEVEL_COUNT] = {"scalar", "sse4.2", "avx2", "avx512"};
+
+/**
+ * @brief CPU probe results
+ */
+typedef struct {
+    CpuLevel level;
+    /** AVX-512 VBMI (byte permutes), used by the quantization */
+    bool vbmi;
+    /** AVX-512 VBMI2 (byte compress), used by the glyph encoding */
+    bool vbmi2;
+} CpuFeatures;
+
+/**
+ * @brief Probes the CPU once. The GCC builtins read cpuid and check that the OS saves the vector registers.
+ */
+static const CpuFeatures &cpuFeatures()
+{
+    static const CpuFeatures features = [] {
+        CpuFeatures f = {CPU_SCALAR, false, false};
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.2"))
+        {
+            f.level = CPU_SSE42;
+            if (__builtin_cpu_supports("avx2"))
+            {
+                f.level = CPU_AVX2;
+                if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+                {
+                    f.level = CPU_AVX512;
+                    f.vbmi = __builtin_cpu_supports("avx512vbmi");
+                    f.vbmi2 = __builtin_cpu_supports("avx512vbmi2");
+                }
+            }
+        }
+#endif
+        return f;
+    }();
+    return features;
+}
+
+/**
+ * @brief Best variant of a kernel up to a level
+ * @param variants Variants of every level
+ * @param level Highest level
+ * @param selected Level of the variant found
+ */
+template <typename Kernel>
+static Kernel bestVariant(const Kernel (&variants)[CPU_LEVEL_COUNT], CpuLevel level, CpuLevel &selected)
+{
+    int l = level;
+    while (l > CPU_SCALAR && variants[l] == nullptr)
+    {
+        l--;
+    }
+    selected = (CpuLevel)l;
+    return variants[l];
+}
+
+/**
+ * @brief Binds every kernel to its best variant up to a level
+ */
+static void bindKernels(HostKernels &k, CpuLevel level)
+{
+    k.filter3x3Row = bestVariant(filter3x3RowVariants, level, k.filter3x3Level);
+    k.reduce2xRow = bestVariant(reduce2xRowVariants, level, k.reduce2xLevel);
+    k.cubicColumnRow = bestVariant(cubicColumnRowVariants, level, k.cubicColumnLevel);
+    k.quantizeRow = bestVariant(quantizeRowVariants,
+                                (level == CPU_AVX512 && !cpuFeatures().vbmi) ? CPU_AVX2 : level,
+                                k.quantizeLevel);
+    k.glyphRow = bestVariant(glyphRowVariants, (level == CPU_AVX512 && !cpuFeatures().vbmi2) ? CPU_AVX2 : level,
+                             k.glyphLevel);
+    k.brailleRow = bestVariant(brailleRowVariants, level, k.brailleLevel);
+    k.lumaRow = bestVariant(lumaRowVariants, level, k.lumaLevel);
+    k.planesRow = bestVariant(planesRowVariants, level, k.planesLevel);
+}
+
+/**
+ * @brief Kernels in use
+ */
+static HostKernels &activeKernels()
+{
+    static HostKernels kernels = [] {
+        HostKernels k;
+        CpuLevel level = detectedCpuLevel();
+
+        // Override for testing: ASCIIART_CPU=scalar|sse4.2|avx2|avx512
+        const char *forced = getenv("ASCIIART_CPU");
+        if (forced != nullptr && *forced != '\0')
+        {
+            CpuLevel l = parseCpuLevel(forced);
+            if (l == CPU_LEVEL_COUNT)
+            {
+                cerr << "Unknown ASCIIART_CPU level: " << forced << endl;
+            }
+            else if (l > level)
+            {
+                cerr << "ASCIIART_CPU=" << forced << " is not supported by this CPU, using " << cpuLevelName(level)
+                     << endl;
+            }
+            else
+            {
+                level = l;
+            }
+        }
+
+        bindKernels(k, level);
+        return k;
+    }();
+    return kernels;
+}
+
+const HostKernels &hostKernels()
+{
+    return activeKernels();
+}
+
+CpuLevel detectedCpuLevel()
+{
+    return cpuFeatures().level;
+}
+
+CpuLevel selectCpuLevel(CpuLevel level)
+{
+    if (level > detectedCpuLevel())
+    {
+        level = detectedCpuLevel();
+    }
+
+    bindKernels(activeKernels(), level);
+    return level;
+}
+
+CpuLevel parseCpuLevel(const string &name)
+{
+    for (int l = 0; l < CPU_LEVEL_COUNT; l++)
+    {
+        if (name == cpuLevelNames[l])
+        {
+            return (CpuLevel)l;
+        }
+    }
+    return CPU_LEVEL_COUNT;
+}
+
+const char *cpuLevelName(CpuLevel level)
+{
+    return level < CPU_LEVEL_COUNT ? cpuLevelNames[level] : "unknown";
+}
+
+ostream &printDispatch(ostream &out)
+{
+    const HostKernels &k = hostKernels();
+    out << "{\"detected\": \"" << cpuLevelName(detectedCpuLevel()) << "\""
+        << ", \"filter3x3\": \"" << cpuLevelName(k.filter3x3Level) << "\""
+        << ", \"reduce2x\": \"" << cpuLevelName(k.reduce2xLevel) << "\""
+        << ", \"cubic\": \"" << cpuLevelName(k.cubicColumnLevel) << "\""
+        << ", \"quantize\": \"" << cpuLevelName(k.quantizeLevel) << "\""
+        << ", \"glyph\": \"" << cpuLevelName(k.glyphLevel) << "\""
+        << ", \"braille\": \"" << cpuLevelName(k.brailleLevel) << "\""
+        << ", \"luma\": \"" << cpuLevelName(k.lumaLevel) << "\""
+        << ", \"planes\": \"" << cpuLevelName(k.planesLevel) << "\"}";
+    return out;
+}
@@ -0,0 +1,819 @@
+/**
+ * @file
+ * @brief Host kernels - Scalar, SSE4.2, AVX2 and AVX-512 variants
+ * Every variant gives the same bytes as the scalar reference. The SIMD
+ * variants are compiled with function target attributes, so the rest of the
+ * program keeps the baseline instruction set and cpu_dispatch.cpp only calls
+ * them on CPUs that support them. See cpu_dispatch.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <cstring>
+
+#include "cpu_dispatch.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HOST_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Vertical cubic pass: shift to pixels, and bias of the rows plus one half
+ */
+#define CUBIC_SHIFT (CUBIC_WEIGHT_BITS + CUBIC_ROW_BITS)
+#define CUBIC_ROUND ((CUBIC_ROW_BIAS << CUBIC_SHIFT) + (1 << (CUBIC_SHIFT - 1)))
+
+/**
+ * @brief Scalar 3x3 filter of pixels [x, width) of a row
+ */
+static inline void filter3x3Scalar(const Npp8u *row0, const Npp8u *row1, const Npp8u *row2, int x, int width,
+                                   const Npp32s kernel[9], Npp8u *dst)
+{
+    for (; x < width; x++)
+    {
+        int sum = row0[x] * kernel[8] + row0[x + 1] * kernel[7] + row0[x + 2] * kernel[6] +
+                  row1[x] * kernel[5] + row1[x + 1] * kernel[4] + row1[x + 2] * kernel[3] +
+                  row2[x] * kernel[2] + row2[x + 1] * kernel[1] + row2[x + 2] * kernel[0];
+        dst[x] = (Npp8u)(sum < 0 ? 0 : (sum > 255 ? 255 : sum));
+    }
+}
+
+/**
+ * @brief Scalar 2x reduction of pixels [x, width) of a row
+ */
+static inline void reduce2xScalar(const Npp8u *row0, const Npp8u *row1, int x, int width, Npp8u *dst)
+{
+    for (; x < width; x++)
+    {
+        dst[x] = (Npp8u)((row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1] + 2) >> 2);
+    }
+}
+
+/**
+ * @brief Scalar vertical cubic pass of pixels [x, width) of a row
+ */
+static inline void cubicColumnScalar(const Npp16s *const rows[4], const Npp16s weights[4], int x, int width, Npp8u *dst)
+{
+    for (; x < width; x++)
+    {
+        int sum = rows[0][x] * weights[0] + rows[1][x] * weights[1] + rows[2][x] * weights[2] + rows[3][x] * weights[3];
+        sum = (sum + CUBIC_ROUND) >> CUBIC_SHIFT;
+        dst[x] = (Npp8u)(sum < 0 ? 0 : (sum > 255 ? 255 : sum));
+    }
+}
+
+/**
+ * @brief Every partial sum of the kernel fits in 16 bits
+ */
+static inline bool narrowKernel(const Npp32s kernel[9])
+{
+    int weight = 0;
+    for (int t = 0; t < 9; t++)
+    {
+        weight += kernel[t] < 0 ? -kernel[t] : kernel[t];
+    }
+    return 255 * weight <= 32767;
+}
+
+static void filter3x3RowScalar(const Npp8u *row0, const Npp8u *row1, const Npp8u *row2, int width,
+                               const Npp32s kernel[9], Npp8u *dst)
+{
+    filter3x3Scalar(row0, row1, row2, 0, width, kernel, dst);
+}
+
+static void reduce2xRowScalar(const Npp8u *row0, const Npp8u *row1, int width, Npp8u *dst)
+{
+    reduce2xScalar(row0, row1, 0, width, dst);
+}
+
+static void cubicColumnRowScalar(const Npp16s *const rows[4], const Npp16s weights[4], int width, Npp8u *dst)
+{
+    cubicColumnScalar(rows, weights, 0, width, dst);
+}
+
+static void quantizeRowScalar(const Npp8u *src, int width, const char table[256], char *dst)
+{
+    for (int x = 0; x < width; x++)
+    {
+        dst[x] = table[src[x]];
+    }
+}
+
+/**
+ * @brief Exact glyphs of pixels [x, width) of a row, no byte written past the last one
+ */
+static inline char *glyphScalar(const Npp8u *src, int x, int width, const Npp32u glyphs[256],
+                                const Npp8u lengths[256], char *dst)
+{
+    for (; x < width; x++)
+    {
+        memcpy(dst, &glyphs[src[x]], lengths[src[x]]);
+        dst += lengths[src[x]];
+    }
+    return dst;
+}
+
+static int glyphRowScalar(const Npp8u *src, int width, const Npp32u glyphs[256], const Npp8u lengths[256], char *dst)
+{
+    char *out = dst;
+    int x = 0;
+    // Whole padded glyphs at a fixed stride: the padding written past a glyph is
+    // overwritten by the next three glyphs, of one byte at least each
+    for (; x + 4 <= width; x++)
+    {
+        memcpy(out, &glyphs[src[x]], 4);
+        out += lengths[src[x]];
+    }
+    return (int)(glyphScalar(src, x, width, glyphs, lengths, out) - dst);
+}
+
+/**
+ * @brief Bit of every dot of a Braille cell, [row][column]
+ */
+static const Npp8u brailleBits[4][2] = {{0x01, 0x08}, {0x02, 0x10}, {0x04, 0x20}, {0x40, 0x80}};
+
+/**
+ * @brief Braille cells [cell, (width + 1) / 2) of four rows of dots
+ */
+static inline void brailleScalar(const Npp8u *const rows[4], int cell, int width, const Npp8u thresholds[16],
+                                 Npp8u *dst)
+{
+    for (; cell * 2 < width; cell++)
+    {
+        Npp8u bits = 0;
+        for (int r = 0; r < 4; r++)
+        {
+            for (int d = 0; d < 2; d++)
+            {
+                int x = cell * 2 + d;
+                if (x < width && rows[r][x] >= thresholds[r * 4 + (x & 3)])
+                {
+                    bits |= brailleBits[r][d];
+                }
+            }
+        }
+        dst[cell] = bits;
+    }
+}
+
+static void brailleRowScalar(const Npp8u *const rows[4], int width, const Npp8u thresholds[16], Npp8u *dst)
+{
+    brailleScalar(rows, 0, width, thresholds, dst);
+}
+
+/**
+ * @brief Scalar luma of pixels [x, width) of a row
+ */
+static inline void lumaScalar(const Npp8u *src, int x, int width, int pixelBytes, const Npp16u weights[3], Npp8u *dst)
+{
+    for (; x < width; x++)
+    {
+        const Npp8u *p = src + x * pixelBytes;
+        dst[x] = (Npp8u)((p[0] * weights[0] + p[1] * weights[1] + p[2] * weights[2] + (1 << (LUMA_WEIGHT_BITS - 1))) >>
+                         LUMA_WEIGHT_BITS);
+    }
+}
+
+static void lumaRowScalar(const Npp8u *src, int width, int pixelBytes, const Npp16u weights[3], Npp8u *dst)
+{
+    lumaScalar(src, 0, width, pixelBytes, weights, dst);
+}
+
+/**
+ * @brief Scalar planes of pixels [x, width) of a row
+ */
+static inline void planesScalar(const Npp8u *src, int x, int width, int pixelBytes, const int offsets[3],
+                                Npp8u *const planes[3])
+{
+    for (int c = 0; c < 3; c++)
+    {
+        const Npp8u *s = src + offsets[c];
+        Npp8u *d = planes[c];
+        for (int i = x; i < width; i++)
+        {
+            d[i] = s[i * pixelBytes];
+        }
+    }
+}
+
+static void planesRowScalar(const Npp8u *src, int width, int pixelBytes, const int offsets[3], Npp8u *const planes[3])
+{
+    planesScalar(src, 0, width, pixelBytes, offsets, planes);
+}
+
+#ifdef HOST_KERNELS_X86
+
+// GCC 12 warns about the self initialized "undefined" register of the AVX-512 intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+/*
+ * 3x3 filter: products and sums on 16 bit lanes when no sum of the kernel
+ * can overflow them (Sobel, Scharr, Prewitt ...), on 32 bit lanes otherwise
+ * (improved Scharr), saturated to 0 - 255 at the end. Tap t of the row major
+ * neighborhood uses kernel[8 - t] (NPP mirrors it).
+ */
+
+__attribute__((target("sse4.2"))) static void filter3x3RowSse42(const Npp8u *row0, const Npp8u *row1,
+                                                                const Npp8u *row2, int width,
+                                                                const Npp32s kernel[9], Npp8u *dst)
+{
+    const Npp8u *rows[3] = {row0, row1, row2};
+    __m128i weight[9];
+    for (int t = 0; t < 9; t++)
+    {
+        weight[t] = _mm_set1_epi32(kernel[8 - t]);
+    }
+
+    int x = 0;
+    if (narrowKernel(kernel))
+    {
+        __m128i weight16[9];
+        for (int t = 0; t < 9; t++)
+        {
+            weight16[t] = _mm_set1_epi16((short)kernel[8 - t]);
+        }
+        for (; x + 16 <= width; x += 16)
+        {
+            __m128i lo = _mm_setzero_si128();
+            __m128i hi = _mm_setzero_si128();
+            for (int t = 0; t < 9; t++)
+            {
+                __m128i p = _mm_loadu_si128((const __m128i *)(rows[t / 3] + x + t % 3));
+                lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_cvtepu8_epi16(p), weight16[t]));
+                hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(p, 8)), weight16[t]));
+            }
+            _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+        }
+    }
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+        for (int t = 0; t < 9; t++)
+        {
+            __m128i p = _mm_loadl_epi64((const __m128i *)(rows[t / 3] + x + t % 3));
+            lo = _mm_add_epi32(lo, _mm_mullo_epi32(_mm_cvtepu8_epi32(p), weight[t]));
+            hi = _mm_add_epi32(hi, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(p, 4)), weight[t]));
+        }
+        // Signed saturation to 16 bits, then unsigned to 8 bits: exactly the 0 - 255 clamp
+        __m128i words = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64((__m128i *)(dst + x), _mm_packus_epi16(words, words));
+    }
+    filter3x3Scalar(row0, row1, row2, x, width, kernel, dst);
+}
+
+__attribute__((target("avx2"))) static void filter3x3RowAvx2(const Npp8u *row0, const Npp8u *row1,
+                                                             const Npp8u *row2, int width,
+                                                             const Npp32s kernel[9], Npp8u *dst)
+{
+    const Npp8u *rows[3] = {row0, row1, row2};
+    __m256i weight[9];
+    for (int t = 0; t < 9; t++)
+    {
+        weight[t] = _mm256_set1_epi32(kernel[8 - t]);
+    }
+
+    int x = 0;
+    if (narrowKernel(kernel))
+    {
+        __m256i weight16[9];
+        for (int t = 0; t < 9; t++)
+        {
+            weight16[t] = _mm256_set1_epi16((short)kernel[8 - t]);
+        }
+        for (; x + 32 <= width; x += 32)
+        {
+            __m256i lo = _mm256_setzero_si256();
+            __m256i hi = _mm256_setzero_si256();
+            for (int t = 0; t < 9; t++)
+            {
+                const Npp8u *p = rows[t / 3] + x + t % 3;
+                lo = _mm256_add_epi16(lo, _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p)), weight16[t]));
+                hi = _mm256_add_epi16(hi, _mm256_mullo_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p + 16))), weight16[t]));
+            }
+            _mm256_storeu_si256((__m256i *)(dst + x), _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8));
+        }
+    }
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i lo = _mm256_setzero_si256();
+        __m256i hi = _mm256_setzero_si256();
+        for (int t = 0; t < 9; t++)
+        {
+            __m128i p = _mm_loadu_si128((const __m128i *)(rows[t / 3] + x + t % 3));
+            lo = _mm256_add_epi32(lo, _mm256_mullo_epi32(_mm256_cvtepu8_epi32(p), weight[t]));
+            hi = _mm256_add_epi32(hi, _mm256_mullo_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(p, 8)), weight[t]));
+        }
+        // Packs work within 128 bit lanes: restore the pixel order after packing
+        __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128((__m128i *)(dst + x), bytes);
+    }
+    filter3x3Scalar(row0, row1, row2, x, width, kernel, dst);
+}
+
+__attribute__((target("avx512f,avx512bw"))) static void filter3x3RowAvx512(const Npp8u *row0, const Npp8u *row1,
+                                                                  const Npp8u *row2, int width,
+                                                                  const Npp32s kernel[9], Npp8u *dst)
+{
+    const Npp8u *rows[3] = {row0, row1, row2};
+    __m512i weight[9];
+    for (int t = 0; t < 9; t++)
+    {
+        weight[t] = _mm512_set1_epi32(kernel[8 - t]);
+    }
+
+    const __m512i zero = _mm512_setzero_si512();
+    int x = 0;
+    if (narrowKernel(kernel))
+    {
+        __m512i weight16[9];
+        for (int t = 0; t < 9; t++)
+        {
+            weight16[t] = _mm512_set1_epi16((short)kernel[8 - t]);
+        }
+        for (; x + 32 <= width; x += 32)
+        {
+            __m512i sum = zero;
+            for (int t = 0; t < 9; t++)
+            {
+                __m256i p = _mm256_loadu_si256((const __m256i *)(rows[t / 3] + x + t % 3));
+                sum = _mm512_add_epi16(sum, _mm512_mullo_epi16(_mm512_cvtepu8_epi16(p), weight16[t]));
+            }
+            _mm256_storeu_si256((__m256i *)(dst + x), _mm512_cvtusepi16_epi8(_mm512_max_epi16(sum, zero)));
+        }
+    }
+    for (; x + 16 <= width; x += 16)
+    {
+        __m512i sum = zero;
+        for (int t = 0; t < 9; t++)
+        {
+            __m128i p = _mm_loadu_si128((const __m128i *)(rows[t / 3] + x + t % 3));
+            sum = _mm512_add_epi32(sum, _mm512_mullo_epi32(_mm512_cvtepu8_epi32(p), weight[t]));
+        }
+        // Negative sums to 0, then unsigned saturation to 255
+        _mm_storeu_si128((__m128i *)(dst + x), _mm512_cvtusepi32_epi8(_mm512_max_epi32(sum, zero)));
+    }
+    filter3x3Scalar(row0, row1, row2, x, width, kernel, dst);
+}
+
+/*
+ * 2x reduction: two chained pavgb round up twice, which biases every level
+ * up, so the 2x2 sums are taken on 16 bit lanes instead.
+ */
+
+__attribute__((target("sse4.2"))) static void reduce2xRowSse42(const Npp8u *row0, const Npp8u *row1, int width,
+                                                               Npp8u *dst)
+{
+    const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+    const __m128i two = _mm_set1_epi16(2);
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i a0 = _mm_loadu_si128((const __m128i *)(row0 + 2 * x));
+        __m128i a1 = _mm_loadu_si128((const __m128i *)(row0 + 2 * x + 16));
+        __m128i b0 = _mm_loadu_si128((const __m128i *)(row1 + 2 * x));
+        __m128i b1 = _mm_loadu_si128((const __m128i *)(row1 + 2 * x + 16));
+
+        // Horizontal pairs: even + odd bytes of each 16 bit lane
+        __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0, lowBytes), _mm_srli_epi16(a0, 8)),
+                                   _mm_add_epi16(_mm_and_si128(b0, lowBytes), _mm_srli_epi16(b0, 8)));
+        __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a1, lowBytes), _mm_srli_epi16(a1, 8)),
+                                   _mm_add_epi16(_mm_and_si128(b1, lowBytes), _mm_srli_epi16(b1, 8)));
+
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    reduce2xScalar(row0, row1, x, width, dst);
+}
+
+__attribute__((target("avx2"))) static void reduce2xRowAvx2(const Npp8u *row0, const Npp8u *row1, int width,
+                                                            Npp8u *dst)
+{
+    const __m256i lowBytes = _mm256_set1_epi16(0x00FF);
+    const __m256i two = _mm256_set1_epi16(2);
+    int x = 0;
+    for (; x + 32 <= width; x += 32)
+    {
+        __m256i a0 = _mm256_loadu_si256((const __m256i *)(row0 + 2 * x));
+        __m256i a1 = _mm256_loadu_si256((const __m256i *)(row0 + 2 * x + 32));
+        __m256i b0 = _mm256_loadu_si256((const __m256i *)(row1 + 2 * x));
+        __m256i b1 = _mm256_loadu_si256((const __m256i *)(row1 + 2 * x + 32));
+
+        __m256i lo = _mm256_add_epi16(_mm256_add_epi16(_mm256_and_si256(a0, lowBytes), _mm256_srli_epi16(a0, 8)),
+                                      _mm256_add_epi16(_mm256_and_si256(b0, lowBytes), _mm256_srli_epi16(b0, 8)));
+        __m256i hi = _mm256_add_epi16(_mm256_add_epi16(_mm256_and_si256(a1, lowBytes), _mm256_srli_epi16(a1, 8)),
+                                      _mm256_add_epi16(_mm256_and_si256(b1, lowBytes), _mm256_srli_epi16(b1, 8)));
+
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, two), 2);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, two), 2);
+        // Packs work within 128 bit lanes: restore the pixel order after packing
+        __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+        _mm256_storeu_si256((__m256i *)(dst + x), bytes);
+    }
+    reduce2xScalar(row0, row1, x, width, dst);
+}
+
+__attribute__((target("avx512f,avx512bw"))) static void reduce2xRowAvx512(const Npp8u *row0, const Npp8u *row1,
+                                                                         int width, Npp8u *dst)
+{
+    const __m512i lowBytes = _mm512_set1_epi16(0x00FF);
+    const __m512i two = _mm512_set1_epi16(2);
+    const __m512i order = _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7);
+    int x = 0;
+    for (; x + 64 <= width; x += 64)
+    {
+        __m512i a0 = _mm512_loadu_si512((const void *)(row0 + 2 * x));
+        __m512i a1 = _mm512_loadu_si512((const void *)(row0 + 2 * x + 64));
+        __m512i b0 = _mm512_loadu_si512((const void *)(row1 + 2 * x));
+        __m512i b1 = _mm512_loadu_si512((const void *)(row1 + 2 * x + 64));
+
+        __m512i lo = _mm512_add_epi16(_mm512_add_epi16(_mm512_and_si512(a0, lowBytes), _mm512_srli_epi16(a0, 8)),
+                                      _mm512_add_epi16(_mm512_and_si512(b0, lowBytes), _mm512_srli_epi16(b0, 8)));
+        __m512i hi = _mm512_add_epi16(_mm512_add_epi16(_mm512_and_si512(a1, lowBytes), _mm512_srli_epi16(a1, 8)),
+                                      _mm512_add_epi16(_mm512_and_si512(b1, lowBytes), _mm512_srli_epi16(b1, 8)));
+
+        lo = _mm512_srli_epi16(_mm512_add_epi16(lo, two), 2);
+        hi = _mm512_srli_epi16(_mm512_add_epi16(hi, two), 2);
+        __m512i bytes = _mm512_permutexvar_epi64(order, _mm512_packus_epi16(lo, hi));
+        _mm512_storeu_si512((void *)(dst + x), bytes);
+    }
+    reduce2xScalar(row0, row1, x, width, dst);
+}
+
+/*
+ * Vertical cubic pass: rows and weights are 16 bit, pmaddwd multiplies the
+ * pairs (row 0, row 1) and (row 2, row 3) and adds each pair on 32 bit lanes.
+ */
+
+__attribute__((target("sse4.2"))) static void cubicColumnRowSse42(const Npp16s *const rows[4], const Npp16s weights[4],
+                                                                  int width, Npp8u *dst)
+{
+    const __m128i w01 = _mm_set1_epi32((int)(unsigned short)weights[0] | ((int)weights[1] << 16));
+    const __m128i w23 = _mm_set1_epi32((int)(unsigned short)weights[2] | ((int)weights[3] << 16));
+    const __m128i round = _mm_set1_epi32(CUBIC_ROUND);
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        __m128i r0 = _mm_loadu_si128((const __m128i *)(rows[0] + x));
+        __m128i r1 = _mm_loadu_si128((const __m128i *)(rows[1] + x));
+        __m128i r2 = _mm_loadu_si128((const __m128i *)(rows[2] + x));
+        __m128i r3 = _mm_loadu_si128((const __m128i *)(rows[3] + x));
+        __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(r0, r1), w01),
+                                   _mm_madd_epi16(_mm_unpacklo_epi16(r2, r3), w23));
+        __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(r0, r1), w01),
+                                   _mm_madd_epi16(_mm_unpackhi_epi16(r2, r3), w23));
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, round), CUBIC_SHIFT);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, round), CUBIC_SHIFT);
+        __m128i words = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64((__m128i *)(dst + x), _mm_packus_epi16(words, words));
+    }
+    cubicColumnScalar(rows, weights, x, width, dst);
+}
+
+__attribute__((target("avx2"))) static void cubicColumnRowAvx2(const Npp16s *const rows[4], const Npp16s weights[4],
+                                                               int width, Npp8u *dst)
+{
+    const __m256i w01 = _mm256_set1_epi32((int)(unsigned short)weights[0] | ((int)weights[1] << 16));
+    const __m256i w23 = _mm256_set1_epi32((int)(unsigned short)weights[2] | ((int)weights[3] << 16));
+    const __m256i round = _mm256_set1_epi32(CUBIC_ROUND);
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i r0 = _mm256_loadu_si256((const __m256i *)(rows[0] + x));
+        __m256i r1 = _mm256_loadu_si256((const __m256i *)(rows[1] + x));
+        __m256i r2 = _mm256_loadu_si256((const __m256i *)(rows[2] + x));
+        __m256i r3 = _mm256_loadu_si256((const __m256i *)(rows[3] + x));
+        // Unpacks and packs work within 128 bit lanes, so the pixel order comes back after packing
+        __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(r0, r1), w01),
+                                      _mm256_madd_epi16(_mm256_unpacklo_epi16(r2, r3), w23));
+        __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(r0, r1), w01),
+                                      _mm256_madd_epi16(_mm256_unpackhi_epi16(r2, r3), w23));
+        lo = _mm256_srai_epi32(_mm256_add_epi32(lo, round), CUBIC_SHIFT);
+        hi = _mm256_srai_epi32(_mm256_add_epi32(hi, round), CUBIC_SHIFT);
+        __m256i words = _mm256_packs_epi32(lo, hi);
+        __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128((__m128i *)(dst + x), bytes);
+    }
+    cubicColumnScalar(rows, weights, x, width, dst);
+}
+
+__attribute__((target("avx512f,avx512bw"))) static void cubicColumnRowAvx512(const Npp16s *const rows[4],
+                                                                            const Npp16s weights[4], int width,
+                                                                            Npp8u *dst)
+{
+    const __m512i w01 = _mm512_set1_epi32((int)(unsigned short)weights[0] | ((int)weights[1] << 16));
+    const __m512i w23 = _mm512_set1_epi32((int)(unsigned short)weights[2] | ((int)weights[3] << 16));
+    const __m512i round = _mm512_set1_epi32(CUBIC_ROUND);
+    const __m512i zero = _mm512_setzero_si512();
+    int x = 0;
+    for (; x + 32 <= width; x += 32)
+    {
+        __m512i r0 = _mm512_loadu_si512((const void *)(rows[0] + x));
+        __m512i r1 = _mm512_loadu_si512((const void *)(rows[1] + x));
+        __m512i r2 = _mm512_loadu_si512((const void *)(rows[2] + x));
+        __m512i r3 = _mm512_loadu_si512((const void *)(rows[3] + x));
+        __m512i lo = _mm512_add_epi32(_mm512_madd_epi16(_mm512_unpacklo_epi16(r0, r1), w01),
+                                      _mm512_madd_epi16(_mm512_unpacklo_epi16(r2, r3), w23));
+        __m512i hi = _mm512_add_epi32(_mm512_madd_epi16(_mm512_unpackhi_epi16(r0, r1), w01),
+                                      _mm512_madd_epi16(_mm512_unpackhi_epi16(r2, r3), w23));
+        lo = _mm512_srai_epi32(_mm512_add_epi32(lo, round), CUBIC_SHIFT);
+        hi = _mm512_srai_epi32(_mm512_add_epi32(hi, round), CUBIC_SHIFT);
+        // Unpack and pack within 128 bit lanes give back the pixel order
+        __m512i words = _mm512_max_epi16(_mm512_packs_epi32(lo, hi), zero);
+        _mm256_storeu_si256((__m256i *)(dst + x), _mm512_cvtusepi16_epi8(words));
+    }
+    cubicColumnScalar(rows, weights, x, width, dst);
+}
+
+/*
+ * Quantization: a 256 entry table lookup is four 64 byte registers. The low 7
+ * bits of a pixel pick from the first or the last 128 entries (two byte
+ * permutes), bit 7 picks between both results. Needs AVX-512 VBMI.
+ */
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi"))) static void quantizeRowAvx512(const Npp8u *src, int width,
+                                                                                    const char table[256],
+                                                                                    char *dst)
+{
+    const __m512i t0 = _mm512_loadu_si512((const void *)table);
+    const __m512i t1 = _mm512_loadu_si512((const void *)(table + 64));
+    const __m512i t2 = _mm512_loadu_si512((const void *)(table + 128));
+    const __m512i t3 = _mm512_loadu_si512((const void *)(table + 192));
+    int x = 0;
+    for (; x + 64 <= width; x += 64)
+    {
+        __m512i p = _mm512_loadu_si512((const void *)(src + x));
+        __m512i low = _mm512_permutex2var_epi8(t0, p, t1);
+        __m512i high = _mm512_permutex2var_epi8(t2, p, t3);
+        _mm512_storeu_si512((void *)(dst + x), _mm512_mask_blend_epi8(_mm512_movepi8_mask(p), low, high));
+    }
+    for (; x < width; x++)
+    {
+        dst[x] = table[src[x]];
+    }
+}
+
+/*
+ * Glyphs: 16 pixels gather their padded glyphs (4 bytes each), the padding is
+ * squeezed out with a byte compress, the non zero bytes of the glyphs (UTF-8
+ * never contains zeros), and only the bytes left are stored. Needs AVX-512 VBMI2.
+ */
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi2,bmi2,popcnt"))) static int glyphRowAvx512(
+    const Npp8u *src, int width, const Npp32u glyphs[256], const Npp8u lengths[256], char *dst)
+{
+    char *out = dst;
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m512i index = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(src + x)));
+        __m512i g = _mm512_i32gather_epi32(index, (const void *)glyphs, 4);
+        __mmask64 bytes = _mm512_test_epi8_mask(g, g);
+        int count = (int)_mm_popcnt_u64(bytes);
+        _mm512_mask_storeu_epi8(out, _bzhi_u64(~0ULL, count), _mm512_maskz_compress_epi8(bytes, g));
+        out += count;
+    }
+    return (int)(glyphScalar(src, x, width, glyphs, lengths, out) - dst);
+}
+
+/*
+ * Braille: every row of dots is compared with its thresholds (a 4 byte pattern,
+ * every vector starts at a multiple of 4), the compare masks select the bit of
+ * each dot (left and right columns alternate), the four rows are ORed, and the
+ * left and right bytes of every cell are added by a multiply-add with ones.
+ */
+
+__attribute__((target("avx2"))) static void brailleRowAvx2(const Npp8u *const rows[4], int width,
+                                                         const Npp8u thresholds[16], Npp8u *dst)
+{
+    __m256i t[4], bits[4];
+    for (int r = 0; r < 4; r++)
+    {
+        Npp32s pattern;
+        memcpy(&pattern, thresholds + r * 4, 4);
+        t[r] = _mm256_set1_epi32(pattern);
+        bits[r] = _mm256_set1_epi16((short)(brailleBits[r][0] | (brailleBits[r][1] << 8)));
+    }
+    const __m256i ones = _mm256_set1_epi8(1);
+    int x = 0;
+    for (; x + 32 <= width; x += 32)
+    {
+        __m256i cells = _mm256_setzero_si256();
+        for (int r = 0; r < 4; r++)
+        {
+            __m256i p = _mm256_loadu_si256((const __m256i *)(rows[r] + x));
+            __m256i dot = _mm256_cmpeq_epi8(_mm256_max_epu8(p, t[r]), p);
+            cells = _mm256_or_si256(cells, _mm256_and_si256(dot, bits[r]));
+        }
+        __m256i sums = _mm256_maddubs_epi16(cells, ones);
+        // Pack within 128 bit lanes, then bring both halves together
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sums, sums), 0x08);
+        _mm_storeu_si128((__m128i *)(dst + x / 2), _mm256_castsi256_si128(packed));
+    }
+    brailleScalar(rows, x / 2, width, thresholds, dst);
+}
+
+__attribute__((target("avx512f,avx512bw"))) static void brailleRowAvx512(const Npp8u *const rows[4], int width,
+                                                                       const Npp8u thresholds[16], Npp8u *dst)
+{
+    __m512i t[4], bits[4];
+    for (int r = 0; r < 4; r++)
+    {
+        Npp32s pattern;
+        memcpy(&pattern, thresholds + r * 4, 4);
+        t[r] = _mm512_set1_epi32(pattern);
+        bits[r] = _mm512_set1_epi16((short)(brailleBits[r][0] | (brailleBits[r][1] << 8)));
+    }
+    const __m512i ones = _mm512_set1_epi8(1);
+    int x = 0;
+    for (; x + 64 <= width; x += 64)
+    {
+        __m512i cells = _mm512_setzero_si512();
+        for (int r = 0; r < 4; r++)
+        {
+            __m512i p = _mm512_loadu_si512((const void *)(rows[r] + x));
+            __mmask64 dots = _mm512_cmpge_epu8_mask(p, t[r]);
+            cells = _mm512_or_si512(cells, _mm512_maskz_mov_epi8(dots, bits[r]));
+        }
+        __m512i sums = _mm512_maddubs_epi16(cells, ones);
+        _mm256_storeu_si256((__m256i *)(dst + x / 2), _mm512_cvtepi16_epi8(sums));
+    }
+    brailleScalar(rows, x / 2, width, thresholds, dst);
+}
+
+/*
+ * Luma: every 128 bit lane holds 4 pixels, 3 byte pixels are spread to 4 bytes
+ * by a shuffle (the fourth byte is zeroed). Bytes are widened to 16 bits, a
+ * multiply-add with the weights (0 for the fourth byte) gives two partial sums
+ * per pixel, added by a horizontal add. 3 byte rows stop early enough not to
+ * read past the end of the row.
+ */
+
+__attribute__((target("sse4.2"))) static void lumaRowSse42(const Npp8u *src, int width, int pixelBytes,
+                                                           const Npp16u weights[3], Npp8u *dst)
+{
+    const __m128i spread = pixelBytes == 3 ? _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1)
+                                           : _mm_setr_epi8(0, 1, 2, -1, 4, 5, 6, -1, 8, 9, 10, -1, 12, 13, 14, -1);
+    const __m128i w = _mm_setr_epi16((short)weights[0], (short)weights[1], (short)weights[2], 0,
+                                     (short)weights[0], (short)weights[1], (short)weights[2], 0);
+    const __m128i round = _mm_set1_epi32(1 << (LUMA_WEIGHT_BITS - 1));
+    const __m128i zero = _mm_setzero_si128();
+    // 16 bytes read for 4 pixels
+    int last = pixelBytes == 3 ? width - 6 : width - 4;
+    int x = 0;
+    for (; x <= last; x += 4)
+    {
+        __m128i p = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + x * pixelBytes)), spread);
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(p, zero), w);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(p, zero), w);
+        __m128i sums = _mm_srli_epi32(_mm_add_epi32(_mm_hadd_epi32(lo, hi), round), LUMA_WEIGHT_BITS);
+        Npp32s luma = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packus_epi32(sums, sums), zero));
+        memcpy(dst + x, &luma, 4);
+    }
+    lumaScalar(src, x, width, pixelBytes, weights, dst);
+}
+
+__attribute__((target("avx2"))) static void lumaRowAvx2(const Npp8u *src, int width, int pixelBytes,
+                                                        const Npp16u weights[3], Npp8u *dst)
+{
+    const __m256i spread = pixelBytes == 3
+                               ? _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                                  0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1)
+                               : _mm256_setr_epi8(0, 1, 2, -1, 4, 5, 6, -1, 8, 9, 10, -1, 12, 13, 14, -1,
+                                                  0, 1, 2, -1, 4, 5, 6, -1, 8, 9, 10, -1, 12, 13, 14, -1);
+    const __m256i w = _mm256_setr_epi16((short)weights[0], (short)weights[1], (short)weights[2], 0,
+                                        (short)weights[0], (short)weights[1], (short)weights[2], 0,
+                                        (short)weights[0], (short)weights[1], (short)weights[2], 0,
+                                        (short)weights[0], (short)weights[1], (short)weights[2], 0);
+    const __m256i round = _mm256_set1_epi32(1 << (LUMA_WEIGHT_BITS - 1));
+    const __m256i zero = _mm256_setzero_si256();
+    // Luma of lane 0 (pixels 0 - 3) and lane 1 (pixels 4 - 7) together
+    const __m256i gather = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+    // 3 byte pixels: 4 pixels from each of two 16 byte loads, 12 bytes apart
+    int last = pixelBytes == 3 ? width - 10 : width - 8;
+    int x = 0;
+    for (; x <= last; x += 8)
+    {
+        const Npp8u *s = src + x * pixelBytes;
+        __m256i p = pixelBytes == 3
+                        ? _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)s)),
+                                                  _mm_loadu_si128((const __m128i *)(s + 12)), 1)
+                        : _mm256_loadu_si256((const __m256i *)s);
+        p = _mm256_shuffle_epi8(p, spread);
+        __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(p, zero), w);
+        __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(p, zero), w);
+        __m256i sums = _mm256_srli_epi32(_mm256_add_epi32(_mm256_hadd_epi32(lo, hi), round), LUMA_WEIGHT_BITS);
+        __m256i bytes = _mm256_packus_epi16(_mm256_packus_epi32(sums, sums), zero);
+        _mm_storel_epi64((__m128i *)(dst + x), _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(bytes, gather)));
+    }
+    lumaScalar(src, x, width, pixelBytes, weights, dst);
+}
+
+/*
+ * Planes: 16 byte chunks of 4 pixels (3 byte pixels: 12 bytes apart, the last
+ * 4 bytes ignored). A shuffle groups each chunk by byte of the pixel, one 32
+ * bit lane per byte, and a 4 x 4 transpose of the lanes of 4 chunks gives 16
+ * pixels of each byte. AVX2 does the same on both 128 bit halves, chunks 0 - 3
+ * in the lower one and 4 - 7 in the upper one: 32 contiguous pixels.
+ */
+
+__attribute__((target("sse4.2"))) static void planesRowSse42(const Npp8u *src, int width, int pixelBytes,
+                                                             const int offsets[3], Npp8u *const planes[3])
+{
+    const __m128i group = pixelBytes == 3 ? _mm_setr_epi8(0, 3, 6, 9, 1, 4, 7, 10, 2, 5, 8, 11, -1, -1, -1, -1)
+                                          : _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    int chunkBytes = 4 * pixelBytes;
+    // The last chunk reads 16 bytes: 3 byte rows stop 2 pixels earlier
+    int last = pixelBytes == 3 ? width - 18 : width - 16;
+    int x = 0;
+    for (; x <= last; x += 16)
+    {
+        const Npp8u *s = src + x * pixelBytes;
+        __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)s), group);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + chunkBytes)), group);
+        __m128i c = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 2 * chunkBytes)), group);
+        __m128i d = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 3 * chunkBytes)), group);
+        __m128i ab0 = _mm_unpacklo_epi32(a, b);
+        __m128i cd0 = _mm_unpacklo_epi32(c, d);
+        __m128i ab2 = _mm_unpackhi_epi32(a, b);
+        __m128i cd2 = _mm_unpackhi_epi32(c, d);
+        __m128i bytes[4] = {_mm_unpacklo_epi64(ab0, cd0), _mm_unpackhi_epi64(ab0, cd0), _mm_unpacklo_epi64(ab2, cd2),
+                            _mm_unpackhi_epi64(ab2, cd2)};
+        for (int p = 0; p < 3; p++)
+        {
+            _mm_storeu_si128((__m128i *)(planes[p] + x), bytes[offsets[p]]);
+        }
+    }
+    planesScalar(src, x, width, pixelBytes, offsets, planes);
+}
+
+__attribute__((target("avx2"))) static void planesRowAvx2(const Npp8u *src, int width, int pixelBytes,
+                                                          const int offsets[3], Npp8u *const planes[3])
+{
+    const __m256i group = pixelBytes == 3
+                              ? _mm256_setr_epi8(0, 3, 6, 9, 1, 4, 7, 10, 2, 5, 8, 11, -1, -1, -1, -1,
+                                                 0, 3, 6, 9, 1, 4, 7, 10, 2, 5, 8, 11, -1, -1, -1, -1)
+                              : _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+                                                 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    int chunkBytes = 4 * pixelBytes;
+    // The last chunk reads 16 bytes: 3 byte rows stop 2 pixels earlier
+    int last = pixelBytes == 3 ? width - 34 : width - 32;
+    int x = 0;
+    for (; x <= last; x += 32)
+    {
+        const Npp8u *s = src + x * pixelBytes;
+        __m256i chunks[4];
+        for (int i = 0; i < 4; i++)
+        {
+            __m128i low = _mm_loadu_si128((const __m128i *)(s + i * chunkBytes));
+            __m128i high = _mm_loadu_si128((const __m128i *)(s + (i + 4) * chunkBytes));
+            chunks[i] = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1), group);
+        }
+        __m256i ab0 = _mm256_unpacklo_epi32(chunks[0], chunks[1]);
+        __m256i cd0 = _mm256_unpacklo_epi32(chunks[2], chunks[3]);
+        __m256i ab2 = _mm256_unpackhi_epi32(chunks[0], chunks[1]);
+        __m256i cd2 = _mm256_unpackhi_epi32(chunks[2], chunks[3]);
+        __m256i bytes[4] = {_mm256_unpacklo_epi64(ab0, cd0), _mm256_unpackhi_epi64(ab0, cd0),
+                            _mm256_unpacklo_epi64(ab2, cd2), _mm256_unpackhi_epi64(ab2, cd2)};
+        for (int p = 0; p < 3; p++)
+        {
+            _mm256_storeu_si256((__m256i *)(planes[p] + x), bytes[offsets[p]]);
+        }
+    }
+    planesScalar(src, x, width, pixelBytes, offsets, planes);
+}
+
+#pragma GCC diagnostic pop
+
+const Filter3x3RowKernel filter3x3RowVariants[CPU_LEVEL_COUNT] = {
+    filter3x3RowScalar, filter3x3RowSse42, filter3x3RowAvx2, filter3x3RowAvx512};
+const Reduce2xRowKernel reduce2xRowVariants[CPU_LEVEL_COUNT] = {
+    reduce2xRowScalar, reduce2xRowSse42, reduce2xRowAvx2, reduce2xRowAvx512};
+const CubicColumnRowKernel cubicColumnRowVariants[CPU_LEVEL_COUNT] = {
+    cubicColumnRowScalar, cubicColumnRowSse42, cubicColumnRowAvx2, cubicColumnRowAvx512};
+// AVX-512 quantization needs VBMI too, cpu_dispatch.cpp checks it
+const QuantizeRowKernel quantizeRowVariants[CPU_LEVEL_COUNT] = {
+    quantizeRowScalar, nullptr, nullptr, quantizeRowAvx512};
+// AVX-512 glyphs need VBMI2, cpu_dispatch.cpp checks it
+const GlyphRowKernel glyphRowVariants[CPU_LEVEL_COUNT] = {glyphRowScalar, nullptr, nullptr, glyphRowAvx512};
+const BrailleRowKernel brailleRowVariants[CPU_LEVEL_COUNT] = {
+    brailleRowScalar, nullptr, brailleRowAvx2, brailleRowAvx512};
+const LumaRowKernel lumaRowVariants[CPU_LEVEL_COUNT] = {lumaRowScalar, lumaRowSse42, lumaRowAvx2, nullptr};
+const PlanesRowKernel planesRowVariants[CPU_LEVEL_COUNT] = {planesRowScalar, planesRowSse42, planesRowAvx2, nullptr};
+
+#else
+
+const Filter3x3RowKernel filter3x3RowVariants[CPU_LEVEL_COUNT] = {filter3x3RowScalar, nullptr, nullptr, nullptr};
+const Reduce2xRowKernel reduce2xRowVariants[CPU_LEVEL_COUNT] = {reduce2xRowScalar, nullptr, nullptr, nullptr};
+const CubicColumnRowKernel cubicColumnRowVariants[CPU_LEVEL_COUNT] = {cubicColumnRowScalar, nullptr, nullptr, nullptr};
+const QuantizeRowKernel quantizeRowVariants[CPU_LEVEL_COUNT] = {quantizeRowScalar, nullptr, nullptr, nullptr};
+const GlyphRowKernel glyphRowVariants[CPU_LEVEL_COUNT] = {glyphRowScalar, nullptr, nullptr, nullptr};
+const BrailleRowKernel brailleRowVariants[CPU_LEVEL_COUNT] = {brailleRowScalar, nullptr, nullptr, nullptr};
+const LumaRowKernel lumaRowVariants[CPU_LEVEL_COUNT] = {lumaRowScalar, nullptr, nullptr, nullptr};
+const PlanesRowKernel planesRowVariants[CPU_LEVEL_COUNT] = {planesRowScalar, nullptr, nullptr, nullptr};
+
+#endif
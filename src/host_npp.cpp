@@ -0,0 +1,257 @@
+/**
+ * @file
+ * @brief Host NPP - Host versions of the NPP filter and resize of the render path
+ * See host_npp.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "ascii_art.h"
+#include "cpu_dispatch.h"
+#include "host_npp.h"
+#include "parallel.h"
+
+using namespace std;
+
+NppStatus convolutionFilter(const Npp8u *pSrc,
+                            int nSrcStep,
+                            NppiSize srcSize,
+                            Npp8u *pDst,
+                            int nDstStep,
+                            const Npp32s *kernel,
+                            NppiSize kernelSize,
+                            Npp32s divisor)
+{
+    if (divisor == 0 || kernelSize.width < 1 || kernelSize.height < 1)
+    {
+        return NPP_BAD_ARGUMENT_ERROR;
+    }
+
+    NppiSize dstSize = {srcSize.width - kernelSize.width + 1, srcSize.height - kernelSize.height + 1};
+    if (dstSize.width < 1 || dstSize.height < 1)
+    {
+        return NPP_SIZE_ERROR;
+    }
+
+    if (kernelSize.width == 3 && kernelSize.height == 3 && divisor == 1)
+    {
+        // Every kernel of the render path: the SIMD row kernel
+        Filter3x3RowKernel filter3x3Row = hostKernels().filter3x3Row;
+        parallelFor(dstSize.height, [&](int band, int begin, int end) {
+            for (int y = begin; y < end; y++)
+            {
+                const Npp8u *row0 = pSrc + (size_t)y * nSrcStep;
+                filter3x3Row(row0, row0 + nSrcStep, row0 + 2 * nSrcStep, dstSize.width, kernel,
+                             pDst + (size_t)y * nDstStep);
+            }
+        });
+    }
+    else
+    {
+        int taps = kernelSize.width * kernelSize.height;
+        parallelFor(dstSize.height, [&](int band, int begin, int end) {
+            for (int y = begin; y < end; y++)
+            {
+                Npp8u *d = pDst + (size_t)y * nDstStep;
+                for (int x = 0; x < dstSize.width; x++)
+                {
+                    // Kernel mirrored, as NPP stores it
+                    int sum = 0;
+                    const Npp32s *k = kernel + taps - 1;
+                    for (int j = 0; j < kernelSize.height; j++)
+                    {
+                        const Npp8u *s = pSrc + (size_t)(y + j) * nSrcStep + x;
+                        for (int i = 0; i < kernelSize.width; i++)
+                        {
+                            sum += s[i] * *k--;
+                        }
+                    }
+                    sum /= divisor;
+                    d[x] = (Npp8u)(sum < 0 ? 0 : (sum > 255 ? 255 : sum));
+                }
+            }
+        });
+    }
+
+    return NPP_NO_ERROR;
+}
+
+/**
+ * @brief Makes a host image of a size, keeping it if it already has that size
+ */
+static void sizeHostImage(npp::ImageCPU_8u_C1 &image, NppiSize size)
+{
+    if ((int)image.width() != size.width || (int)image.height() != size.height)
+    {
+        npp::ImageCPU_8u_C1 oImage(size.width, size.height);
+        oImage.swap(image);
+    }
+}
+
+NppStatus convolutionFilter(const npp::ImageCPU_8u_C1 &src,
+                            npp::ImageCPU_8u_C1 &dst,
+                            const Npp32s *kernel,
+                            NppiSize kernelSize,
+                            Npp32s divisor)
+{
+    NppiSize srcSize = {(int)src.width(), (int)src.height()};
+    NppiSize dstSize = {srcSize.width - kernelSize.width + 1, srcSize.height - kernelSize.height + 1};
+    if (dstSize.width < 1 || dstSize.height < 1)
+    {
+        return NPP_SIZE_ERROR;
+    }
+
+    sizeHostImage(dst, dstSize);
+    return convolutionFilter(src.data(), src.pitch(), srcSize, dst.data(), dst.pitch(), kernel, kernelSize, divisor);
+}
+
+NppStatus applyConvolutionFilter(int filter, const npp::ImageCPU_8u_C1 &src, npp::ImageCPU_8u_C1 &dst)
+{
+    return convolutionFilter(src, dst, filterKernels[effectiveFilter(filter)], {3, 3}, 1);
+}
+
+/**
+ * @brief Cubic convolution kernel, a = -0.5
+ */
+static double cubicWeight(double t)
+{
+    const double a = -0.5;
+    t = fabs(t);
+    if (t < 1.0)
+    {
+        return ((a + 2.0) * t - (a + 3.0)) * t * t + 1.0;
+    }
+    if (t < 2.0)
+    {
+        return ((a * t - 5.0 * a) * t + 8.0 * a) * t - 4.0 * a;
+    }
+    return 0.0;
+}
+
+/**
+ * @brief Source pixels and fixed point weights of a 1D cubic resize
+ * @param srcLength Source length
+ * @param dstLength Destination length
+ * @param index 4 source pixels of each destination pixel, clamped to the source
+ * @param weights 4 weights of each destination pixel, adding up to 1 << CUBIC_WEIGHT_BITS
+ */
+static void cubicTaps(int srcLength, int dstLength, vector<int> &index, vector<Npp16s> &weights)
+{
+    double scale = (double)srcLength / dstLength;
+    const int one = 1 << CUBIC_WEIGHT_BITS;
+
+    index.resize(4 * (size_t)dstLength);
+    weights.resize(4 * (size_t)dstLength);
+    for (int i = 0; i < dstLength; i++)
+    {
+        double s = (i + 0.5) * scale - 0.5;
+        int i0 = (int)floor(s);
+        double f = s - i0;
+
+        int w[4];
+        int sum = 0;
+        for (int k = 0; k < 4; k++)
+        {
+            w[k] = (int)lround(cubicWeight(f + 1 - k) * one);
+            sum += w[k];
+            index[4 * i + k] = min(max(i0 - 1 + k, 0), srcLength - 1);
+        }
+        // Rounding error to the largest weight, so flat areas stay flat
+        w[f < 0.5 ? 1 : 2] += one - sum;
+        for (int k = 0; k < 4; k++)
+        {
+            weights[4 * i + k] = (Npp16s)w[k];
+        }
+    }
+}
+
+NppStatus resizeHostImage(const Npp8u *pSrc,
+                          int nSrcStep,
+                          NppiSize srcSize,
+                          Npp8u *pDst,
+                          int nDstStep,
+                          NppiSize dstSize,
+                          CubicResizeTables &tables)
+{
+    if (dstSize.width < 1 || dstSize.height < 1 || srcSize.width < 1 || srcSize.height < 1)
+    {
+        return NPP_SIZE_ERROR;
+    }
+
+    if (tables.srcSize.width != srcSize.width || tables.srcSize.height != srcSize.height ||
+        tables.dstSize.width != dstSize.width || tables.dstSize.height != dstSize.height)
+    {
+        cubicTaps(srcSize.width, dstSize.width, tables.columns, tables.columnWeights);
+        cubicTaps(srcSize.height, dstSize.height, tables.rows, tables.rowWeights);
+        tables.srcSize = srcSize;
+        tables.dstSize = dstSize;
+    }
+
+    // Horizontally resized source rows, 4 of each chunk
+    int chunks = parallelChunks(dstSize.height);
+    size_t rowsSize = (size_t)chunks * 4 * dstSize.width;
+    if (tables.rowBuffers.size() < rowsSize)
+    {
+        tables.rowBuffers.resize(rowsSize);
+    }
+
+    CubicColumnRowKernel cubicColumnRow = hostKernels().cubicColumnRow;
+    const int rowShift = CUBIC_WEIGHT_BITS - CUBIC_ROW_BITS;
+    const int *columns = tables.columns.data();
+    const Npp16s *columnWeights = tables.columnWeights.data();
+
+    parallelFor(
+        dstSize.height,
+        [&](int chunk, int begin, int end) {
+            // The 4 rows of a destination row are consecutive (or repeated on the borders),
+            // so row r always goes to slot r % 4.
+            Npp16s *slots = &tables.rowBuffers[(size_t)chunk * 4 * dstSize.width];
+            int slotRow[4] = {-1, -1, -1, -1};
+
+            for (int y = begin; y < end; y++)
+            {
+                const Npp16s *rowData[4];
+                for (int k = 0; k < 4; k++)
+                {
+                    int r = tables.rows[4 * y + k];
+                    int s = r % 4;
+                    Npp16s *h = slots + (size_t)s * dstSize.width;
+                    if (slotRow[s] != r)
+                    {
+                        const Npp8u *p = pSrc + (size_t)r * nSrcStep;
+                        for (int x = 0; x < dstSize.width; x++)
+                        {
+                            const int *c = &columns[4 * x];
+                            const Npp16s *w = &columnWeights[4 * x];
+                            int sum = p[c[0]] * w[0] + p[c[1]] * w[1] + p[c[2]] * w[2] + p[c[3]] * w[3];
+                            h[x] = (Npp16s)(((sum + (1 << (rowShift - 1))) >> rowShift) -
+                                            (CUBIC_ROW_BIAS << CUBIC_ROW_BITS));
+                        }
+                        slotRow[s] = r;
+                    }
+                    rowData[k] = h;
+                }
+                cubicColumnRow(rowData, &tables.rowWeights[4 * y], dstSize.width, pDst + (size_t)y * nDstStep);
+            }
+        },
+        chunks);
+
+    return NPP_NO_ERROR;
+}
+
+NppStatus resizeHostImage(const npp::ImageCPU_8u_C1 &src, NppiSize dstSize, npp::ImageCPU_8u_C1 &dst)
+{
+    if (dstSize.width < 1 || dstSize.height < 1)
+    {
+        return NPP_SIZE_ERROR;
+    }
+
+    CubicResizeTables tables = {};
+    sizeHostImage(dst, dstSize);
+    return resizeHostImage(src.data(), src.pitch(), {(int)src.width(), (int)src.height()}, dst.data(), dst.pitch(),
+                           dstSize, tables);
+}
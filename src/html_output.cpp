@@ -0,0 +1,398 @@
+/**
+ * @file
+ * @brief HTML output - The ASCII art as an HTML fragment for web pages
+ * See html_output.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "html_output.h"
+#include "parallel.h"
+
+using namespace std;
+
+/**
+ * @brief UTF-8 of the upper half block (U+2580)
+ */
+static const char upperHalfBlock[] = "\xE2\x96\x80";
+
+/**
+ * @brief Closing tag of a span
+ */
+static const char spanEnd[] = "</span>";
+
+/**
+ * @brief Entity of every byte that must be escaped inside a <pre>, nullptr for the others
+ */
+static const char *const *escapeTable()
+{
+    static const vector<const char *> table = [] {
+        vector<const char *> t(256, nullptr);
+        t['<'] = "&lt;";
+        t['>'] = "&gt;";
+        t['&'] = "&amp;";
+        return t;
+    }();
+    return table.data();
+}
+
+const char *outputFormatName(OutputFormat format)
+{
+    return format == FORMAT_HTML ? "html" : "text";
+}
+
+void htmlGlyphTable(const GlyphTable &table, HtmlGlyphTable &html)
+{
+    const char *const *escapes = escapeTable();
+    for (int level = 0; level < 256; level++)
+    {
+        const char *glyph = (const char *)&table.glyphs[level];
+        int length = table.lengths[level];
+        char *p = html.glyphs[level];
+        for (int i = 0; i < length; i++)
+        {
+            const char *entity = escapes[(unsigned char)glyph[i]];
+            if (entity)
+            {
+                size_t n = strlen(entity);
+                memcpy(p, entity, n);
+                p += n;
+            }
+            else
+            {
+                *p++ = glyph[i];
+            }
+        }
+        html.lengths[level] = (Npp8u)(p - html.glyphs[level]);
+
+        // Space and empty Braille cell (U+2800)
+        html.blanks[level] = (length == 1 && glyph[0] == ' ') || (length == 3 && !memcmp(glyph, "\xE2\xA0\x80", 3));
+    }
+}
+
+/**
+ * @brief Class name of the n-th most used color: a letter, then letters and digits
+ */
+static string className(size_t n)
+{
+    static const char first[] = "abcdefghijklmnopqrstuvwxyz";
+    static const char rest[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    string name(1, first[n % 26]);
+    n /= 26;
+    while (n > 0)
+    {
+        n--;
+        name += rest[n % 36];
+        n /= 36;
+    }
+    return name;
+}
+
+/**
+ * @brief Appends a CSS color, #rgb when it is exact
+ */
+static void appendHex(string &out, Npp32u rgb)
+{
+    static const char digits[] = "0123456789abcdef";
+    char hex[6];
+    bool shortened = true;
+    for (int i = 0; i < 6; i++)
+    {
+        hex[i] = digits[(rgb >> (20 - 4 * i)) & 15];
+        shortened = shortened && (i % 2 == 0 || hex[i] == hex[i - 1]);
+    }
+    out += '#';
+    for (int i = 0; i < 6; i += shortened ? 2 : 1)
+    {
+        out += hex[i];
+    }
+}
+
+/**
+ * @brief Key of a foreground and background
+ */
+static inline Npp64u colorKey(Npp32u fg, Npp32u bg)
+{
+    return (Npp64u)fg << 32 | bg;
+}
+
+HtmlEncoder::HtmlEncoder(ColorMode color) : ansi_(color)
+{
+}
+
+void HtmlEncoder::textClasses(const npp::ImageCPU_8u_C1 &grey, const npp::ImageCPU_8u_C1 colors[3],
+                              const HtmlGlyphTable &table)
+{
+    int width = (int)grey.width();
+    int height = (int)grey.height();
+    int chunks = height > 0 ? parallelChunks(height) : 0;
+    vector<unordered_map<Npp64u, size_t>> counts(max(chunks, 1));
+    if (chunks > 0)
+    {
+        parallelFor(height, [&](int chunk, int begin, int end) {
+            unordered_map<Npp64u, size_t> &c = counts[chunk];
+            for (int y = begin; y < end; y++)
+            {
+                const Npp8u *g = grey.data(0, y);
+                const Npp8u *r = colors[0].data(0, y);
+                const Npp8u *gr = colors[1].data(0, y);
+                const Npp8u *b = colors[2].data(0, y);
+                for (int x = 0; x < width; x++)
+                {
+                    if (!table.blanks[g[x]])
+                    {
+                        c[colorKey(ansi_.color(r[x], gr[x], b[x]), ANSI_NO_COLOR)]++;
+                    }
+                }
+            }
+        }, chunks);
+    }
+
+    nameClasses(counts);
+}
+
+void HtmlEncoder::blockClasses(const npp::ImageCPU_8u_C1 colors[3])
+{
+    int width = (int)colors[0].width();
+    int rows = (int)colors[0].height() / 2;
+    int chunks = rows > 0 ? parallelChunks(rows) : 0;
+    vector<unordered_map<Npp64u, size_t>> counts(max(chunks, 1));
+    if (chunks > 0)
+    {
+        parallelFor(rows, [&](int chunk, int begin, int end) {
+            unordered_map<Npp64u, size_t> &c = counts[chunk];
+            for (int y = begin; y < end; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    Npp32u t = ansi_.color(colors[0].data(0, 2 * y)[x], colors[1].data(0, 2 * y)[x],
+                                           colors[2].data(0, 2 * y)[x]);
+                    Npp32u b = ansi_.color(colors[0].data(0, 2 * y + 1)[x], colors[1].data(0, 2 * y + 1)[x],
+                                           colors[2].data(0, 2 * y + 1)[x]);
+                    // Both halves of the same color: a blank on the background
+                    c[t == b ? colorKey(ANSI_NO_COLOR, b) : colorKey(t, b)]++;
+                }
+            }
+        }, chunks);
+    }
+
+    nameClasses(counts);
+}
+
+void HtmlEncoder::nameClasses(vector<unordered_map<Npp64u, size_t>> &counts)
+{
+    for (size_t i = 1; i < counts.size(); i++)
+    {
+        for (const auto &entry : counts[i])
+        {
+            counts[0][entry.first] += entry.second;
+        }
+    }
+
+    // Most used first, ties by color so the names do not depend on the hash order
+    vector<pair<size_t, Npp64u>> sorted;
+    sorted.reserve(counts[0].size());
+    for (const auto &entry : counts[0])
+    {
+        sorted.push_back({entry.second, entry.first});
+    }
+    sort(sorted.begin(), sorted.end(), [](const pair<size_t, Npp64u> &a, const pair<size_t, Npp64u> &b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+
+    classes_.clear();
+    keys_.resize(sorted.size());
+    spans_.resize(sorted.size());
+    for (size_t i = 0; i < sorted.size(); i++)
+    {
+        keys_[i] = sorted[i].second;
+        classes_[keys_[i]] = (int)i;
+        spans_[i] = "<span class=" + className(i) + ">";
+    }
+}
+
+int HtmlEncoder::classOf(Npp32u fg, Npp32u bg) const
+{
+    return classes_.find(colorKey(fg, bg))->second;
+}
+
+void HtmlEncoder::header(bool halfBlocks, string &out) const
+{
+    if (!keys_.empty())
+    {
+        out += "<style>";
+        for (size_t i = 0; i < keys_.size(); i++)
+        {
+            Npp32u fg = (Npp32u)(keys_[i] >> 32);
+            Npp32u bg = (Npp32u)keys_[i];
+            out += '.';
+            out += className(i);
+            out += '{';
+            if (fg != ANSI_NO_COLOR)
+            {
+                out += "color:";
+                appendHex(out, ansi_.rgb(fg));
+            }
+            if (bg != ANSI_NO_COLOR)
+            {
+                out += fg != ANSI_NO_COLOR ? ";background:" : "background:";
+                appendHex(out, ansi_.rgb(bg));
+            }
+            out += '}';
+        }
+        out += "</style>\n";
+    }
+    // The line break right after <pre> is not part of its content
+    out += keys_.empty() ? "<pre" : "<pre class=a";
+    out += halfBlocks ? " style=line-height:1>\n" : ">\n";
+}
+
+void HtmlEncoder::footer(string &out) const
+{
+    out += "</pre>\n";
+}
+
+void HtmlEncoder::openSpan(int cls, int &open, vector<char> &out) const
+{
+    if (cls == open)
+    {
+        return;
+    }
+    if (open > 0)
+    {
+        out.insert(out.end(), spanEnd, spanEnd + sizeof(spanEnd) - 1);
+    }
+    // The most used class is the one of the <pre>, no span
+    if (cls > 0)
+    {
+        out.insert(out.end(), spans_[cls].begin(), spans_[cls].end());
+    }
+    open = cls;
+}
+
+void HtmlEncoder::textRow(const Npp8u *grey, const Npp8u *const *rgb, int width, const HtmlGlyphTable &table,
+                          vector<char> &out) const
+{
+    // Rows start in the class of the <pre>
+    int open = 0;
+    Npp32u last = ANSI_NO_COLOR;
+    int lastClass = -1;
+    for (int x = 0; x < width; x++)
+    {
+        Npp8u level = grey[x];
+
+        // A blank shows no foreground, it stays in the open span
+        if (rgb && !table.blanks[level])
+        {
+            Npp32u c = ansi_.color(rgb[0][x], rgb[1][x], rgb[2][x]);
+            if (c != last)
+            {
+                last = c;
+                lastClass = classOf(c, ANSI_NO_COLOR);
+            }
+            openSpan(lastClass, open, out);
+        }
+        out.insert(out.end(), table.glyphs[level], table.glyphs[level] + table.lengths[level]);
+    }
+
+    if (open > 0)
+    {
+        out.insert(out.end(), spanEnd, spanEnd + sizeof(spanEnd) - 1);
+    }
+    out.push_back('\n');
+}
+
+void HtmlEncoder::blockRow(const Npp8u *const top[3], const Npp8u *const bottom[3], int width,
+                           vector<char> &out) const
+{
+    int open = 0;
+    Npp64u last = colorKey(ANSI_NO_COLOR, ANSI_NO_COLOR);
+    int lastClass = -1;
+    for (int x = 0; x < width; x++)
+    {
+        Npp32u t = ansi_.color(top[0][x], top[1][x], top[2][x]);
+        Npp32u b = ansi_.color(bottom[0][x], bottom[1][x], bottom[2][x]);
+        // Both halves of the same color: a blank on the background
+        Npp32u fg = t == b ? ANSI_NO_COLOR : t;
+        Npp64u key = colorKey(fg, b);
+        if (key != last)
+        {
+            last = key;
+            lastClass = classOf(fg, b);
+        }
+        openSpan(lastClass, open, out);
+        if (t == b)
+        {
+            out.push_back(' ');
+        }
+        else
+        {
+            out.insert(out.end(), upperHalfBlock, upperHalfBlock + sizeof(upperHalfBlock) - 1);
+        }
+    }
+
+    if (open > 0)
+    {
+        out.insert(out.end(), spanEnd, spanEnd + sizeof(spanEnd) - 1);
+    }
+    out.push_back('\n');
+}
+
+/**
+ * @brief Puts the header, the encoded rows and the footer together
+ */
+static void assembleHtml(const HtmlEncoder &encoder, bool halfBlocks, const OutputAssembler &assembler, string &art)
+{
+    art.clear();
+    encoder.header(halfBlocks, art);
+    size_t offset = art.size();
+    art.resize(offset + assembler.size());
+    assembler.copyTo(&art[offset]);
+    encoder.footer(art);
+}
+
+void htmlAsciiArt(const npp::ImageCPU_8u_C1 &grey, const npp::ImageCPU_8u_C1 *colors, const string &asciiPattern,
+                  ColorMode color, OutputAssembler &assembler, string &art)
+{
+    GlyphTable glyphs;
+    glyphTable(asciiPattern.c_str(), glyphs);
+    HtmlGlyphTable table;
+    htmlGlyphTable(glyphs, table);
+
+    HtmlEncoder encoder(colors ? color : COLOR_NONE);
+    if (colors)
+    {
+        encoder.textClasses(grey, colors, table);
+    }
+
+    int width = (int)grey.width();
+    assembler.encode(0, (int)grey.height(), [&](int y, vector<char> &band) {
+        if (!colors)
+        {
+            encoder.textRow(grey.data(0, y), nullptr, width, table, band);
+            return;
+        }
+        const Npp8u *rgb[3] = {colors[0].data(0, y), colors[1].data(0, y), colors[2].data(0, y)};
+        encoder.textRow(grey.data(0, y), rgb, width, table, band);
+    });
+    assembleHtml(encoder, false, assembler, art);
+}
+
+void htmlHalfBlockArt(const npp::ImageCPU_8u_C1 colors[3], ColorMode color, OutputAssembler &assembler, string &art)
+{
+    HtmlEncoder encoder(color);
+    encoder.blockClasses(colors);
+
+    int width = (int)colors[0].width();
+    assembler.encode(0, (int)colors[0].height() / 2, [&](int y, vector<char> &band) {
+        const Npp8u *top[3] = {colors[0].data(0, 2 * y), colors[1].data(0, 2 * y), colors[2].data(0, 2 * y)};
+        const Npp8u *bottom[3] = {colors[0].data(0, 2 * y + 1), colors[1].data(0, 2 * y + 1),
+                                  colors[2].data(0, 2 * y + 1)};
+        encoder.blockRow(top, bottom, width, band);
+    });
+    assembleHtml(encoder, true, assembler, art);
+}
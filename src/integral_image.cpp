@@ -0,0 +1,190 @@
+/**
+ * @file
+ * @brief Integral image (summed-area table) of a host image
+ * See integral_image.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "integral_image.h"
+#include "parallel.h"
+
+using namespace std;
+
+/**
+ * @brief Builds a summed-area table of the (optionally squared) pixels
+ * @param src Source image
+ * @param table Table, (width + 1) x (height + 1)
+ * @param carry Carries of the bands, resized as needed
+ * @param squared Sum the squares of the pixels
+ */
+template <typename T>
+static void buildTable(const npp::ImageCPU_8u_C1 &src, vector<T> &table, vector<T> &carry, bool squared)
+{
+    int width = (int)src.width();
+    int height = (int)src.height();
+    size_t stride = (size_t)width + 1;
+
+    table.assign(stride * (height + 1), 0);
+
+    // Each band is summed on its own, as if it was at the top of the image
+    int bands = parallelFor(height, [&](int band, int begin, int end) {
+        for (int y = begin; y < end; y++)
+        {
+            const Npp8u *s = src.data(0, y);
+            const T *above = &table[(size_t)y * stride];
+            T *row = &table[(size_t)(y + 1) * stride];
+            T rowSum = 0;
+            for (int x = 0; x < width; x++)
+            {
+                rowSum += squared ? (T)s[x] * s[x] : (T)s[x];
+                row[x + 1] = (y == begin ? 0 : above[x + 1]) + rowSum;
+            }
+        }
+    });
+
+    if (bands == 1)
+    {
+        return;
+    }
+
+    // Carry of each band: sum of the last rows of the bands above
+    carry.assign((size_t)bands * stride, 0);
+    for (int b = 1; b < bands; b++)
+    {
+        const T *last = &table[(size_t)((long long)height * b / bands) * stride];
+        const T *above = &carry[(size_t)(b - 1) * stride];
+        T *current = &carry[(size_t)b * stride];
+        for (size_t x = 0; x < stride; x++)
+        {
+            current[x] = above[x] + last[x];
+        }
+    }
+
+    parallelFor(height, [&](int band, int begin, int end) {
+        if (band == 0)
+        {
+            return;
+        }
+        const T *bandCarry = &carry[(size_t)band * stride];
+        for (int y = begin; y < end; y++)
+        {
+            T *row = &table[(size_t)(y + 1) * stride];
+            for (size_t x = 0; x < stride; x++)
+            {
+                row[x] += bandCarry[x];
+            }
+        }
+    }, bands);
+}
+
+void IntegralImage::build(const npp::ImageCPU_8u_C1 &src, bool squares)
+{
+    width_ = (int)src.width();
+    height_ = (int)src.height();
+
+    buildTable(src, sums_, carry_, false);
+
+    if (squares)
+    {
+        buildTable(src, squares_, squaresCarry_, true);
+    }
+    else
+    {
+        squares_.clear();
+    }
+}
+
+float IntegralImage::variance(int x0, int y0, int x1, int y1) const
+{
+    if (squares_.empty())
+    {
+        return 0.0f;
+    }
+
+    const Npp64u *top = &squares_[(size_t)y0 * (width_ + 1)];
+    const Npp64u *bottom = &squares_[(size_t)y1 * (width_ + 1)];
+    double area = (double)(x1 - x0) * (y1 - y0);
+    double mean = sum(x0, y0, x1, y1) / area;
+    double meanSquares = (bottom[x1] - bottom[x0] - top[x1] + top[x0]) / area;
+    return (float)max(0.0, meanSquares - mean * mean);
+}
+
+/**
+ * @brief Cell boundaries of a 1D area sampling
+ * @param srcLength Source length
+ * @param dstLength Destination length
+ * @param bounds dstLength + 1 boundaries, each cell at least one pixel wide
+ */
+static void cellBounds(int srcLength, int dstLength, vector<int> &bounds)
+{
+    bounds.resize(dstLength + 1);
+    for (int i = 0; i <= dstLength; i++)
+    {
+        bounds[i] = (int)((long long)srcLength * i / dstLength);
+    }
+    // Upscaling: cells would be empty, take the nearest pixel
+    for (int i = 0; i < dstLength; i++)
+    {
+        if (bounds[i + 1] <= bounds[i])
+        {
+            bounds[i] = min(bounds[i], srcLength - 1);
+            bounds[i + 1] = bounds[i] + 1;
+        }
+    }
+}
+
+void areaSample(const IntegralImage &integral, npp::ImageCPU_8u_C1 &dst)
+{
+    AreaSampleTables tables = {};
+    areaSample(integral, dst, tables);
+}
+
+void areaSample(const IntegralImage &integral, npp::ImageCPU_8u_C1 &dst, AreaSampleTables &tables)
+{
+    NppiSize srcSize = {integral.width(), integral.height()};
+    NppiSize dstSize = {(int)dst.width(), (int)dst.height()};
+    if (tables.columns.empty() || tables.srcSize.width != srcSize.width || tables.srcSize.height != srcSize.height ||
+        tables.dstSize.width != dstSize.width || tables.dstSize.height != dstSize.height)
+    {
+        cellBounds(srcSize.width, dstSize.width, tables.columns);
+        cellBounds(srcSize.height, dstSize.height, tables.rows);
+        tables.srcSize = srcSize;
+        tables.dstSize = dstSize;
+    }
+    const vector<int> &columns = tables.columns;
+    const vector<int> &rows = tables.rows;
+
+    parallelFor((int)dst.height(), [&](int band, int begin, int end) {
+        for (int y = begin; y < end; y++)
+        {
+            Npp8u *d = dst.data(0, y);
+            for (unsigned int x = 0; x < dst.width(); x++)
+            {
+                d[x] = integral.mean(columns[x], rows[y], columns[x + 1], rows[y + 1]);
+            }
+        }
+    });
+}
+
+void boxBlur(const IntegralImage &integral, int radius, npp::ImageCPU_8u_C1 &dst)
+{
+    int width = integral.width();
+    int height = integral.height();
+
+    parallelFor(height, [&](int band, int begin, int end) {
+        for (int y = begin; y < end; y++)
+        {
+            int y0 = max(0, y - radius);
+            int y1 = min(height, y + radius + 1);
+            Npp8u *d = dst.data(0, y);
+            for (int x = 0; x < width; x++)
+            {
+                d[x] = integral.mean(max(0, x - radius), y0, min(width, x + radius + 1), y1);
+            }
+        }
+    });
+}
@@ -0,0 +1,595 @@
+/**
+ * @file
+ * @brief ASCII Art - Command line
+ * Parses the command line and renders the requested ASCII art.
+ * See README.md for more details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ascii_art.h"
+#include "color_image.h"
+#include "cpu_dispatch.h"
+#include "parallel.h"
+#include "profiler.h"
+#include "render_plan.h"
+#include "trace.h"
+#include "tuning.h"
+
+using namespace std;
+
+/**
+ * @brief Options that take a value, given as --name=value or --name value
+ */
+static const char *valueOptions[] = {"widths", "filters", "pattern", "output", "order", "sampling",
+                                     "backend", "mode", "threshold", "color", "format", "luma",
+                                     "blur", "threads", "cpu", "tuning", "repeat", "warmup"};
+
+/**
+ * @brief Tells if an option takes a value
+ * @param name Option name, without the leading --
+ */
+static bool takesValue(const string &name)
+{
+    for (const char *option : valueOptions)
+    {
+        if (name == option)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Parses an integer, prints the usage and exits on anything else
+ * @param value Text of the number
+ * @param name Option or argument the number was given to
+ * @param program Program name, for the usage
+ * @return Parsed value
+ */
+static int parseInt(const string &value, const string &name, char *program)
+{
+    size_t end = 0;
+    int result = 0;
+    try
+    {
+        result = std::stoi(value, &end);
+    }
+    catch (std::exception &)
+    {
+        end = 0;
+    }
+    if (end == 0 || end != value.size())
+    {
+        cerr << "Invalid number \"" << value << "\" for " << name << endl;
+        usage(program);
+        exit(1);
+    }
+    return result;
+}
+
+/**
+ * @brief Parses a comma separated list of integers, prints the usage and exits on anything else
+ * @param list List, i.e. "80,160,0"
+ * @param name Option the list was given to
+ * @param program Program name, for the usage
+ * @return Parsed values
+ */
+static vector<int> parseIntList(const string &list, const string &name, char *program)
+{
+    vector<int> values;
+    istringstream iss(list);
+    string value;
+    while (getline(iss, value, ','))
+    {
+        values.push_back(parseInt(value, name, program));
+    }
+    if (values.empty())
+    {
+        parseInt(list, name, program);
+    }
+    return values;
+}
+
+int main(int argc, char *argv[])
+{
+    // Startup is timed from here to the first byte of output
+    profiler().startupBegin();
+
+    // Path to a pgm image
+    string imagePath = "teapot512.pgm";
+
+    // Default - resize to 80 chars width terminal, set to 0 for no resize
+    int columnWidth = 80;
+
+    // ASCII pattern. It should start with space character " " for black.
+    string asciiPattern = "  -.,-=+:;cba?0123456789$WN#@";
+
+    // Edge detection filter.
+    int filter = -1;
+
+    // Matrix of outputs: widths x filters x patterns
+    vector<int> widths;
+    vector<int> filters;
+    vector<string> patterns;
+
+    // Output path template, "-" = cout
+    string outputTemplate = "-";
+
+    // Print the render plan, filter at full resolution, cubic resize, no blur, NPP
+    RenderOptions options = {false, ORDER_FILTER_FIRST, SAMPLING_RESIZE, 0, BACKEND_NPP, MODE_TEXT,
+                             BRAILLE_THRESHOLD, COLOR_NONE, FORMAT_TEXT};
+
+    // Show every filter side by side
+    bool preview = false;
+
+    // Profile the stages: report path ("-" = standard error, empty = no profile), measured and warmup runs
+    string profilePath;
+    bool counters = false;
+    int repeat = 1;
+    int warmup = 0;
+
+    // Chrome trace path, empty = no trace
+    string tracePath;
+
+    // Tuning cache ("none" = do not load), tune the size classes of the mask and exit
+    string tuningPath = defaultTuningPath();
+    bool threadsSet = false;
+    bool samplingSet = false;
+    unsigned int tuneClasses = 0;
+
+    // Parse image path
+    if (argc == 1)
+    {
+        usage(argv[0]);
+        exit(0);
+    }
+
+    // Split --options from positional arguments
+    vector<string> args;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg(argv[i]);
+        if (arg.rfind("--", 0) != 0)
+        {
+            args.push_back(arg);
+            continue;
+        }
+
+        size_t eq = arg.find('=');
+        string name = arg.substr(2, eq == string::npos ? string::npos : eq - 2);
+        string value = eq == string::npos ? "" : arg.substr(eq + 1);
+        // --name value
+        if (eq == string::npos && takesValue(name))
+        {
+            if (i + 1 == argc)
+            {
+                cerr << "Missing value of " << arg << endl;
+                usage(argv[0]);
+                exit(1);
+            }
+            value = argv[++i];
+        }
+
+        if (name == "widths")
+        {
+            widths = parseIntList(value, "--widths", argv[0]);
+        }
+        else if (name == "filters" && value == "all")
+        {
+            filters.clear();
+            for (int f = 0; f < FILTER_COUNT; f++)
+            {
+                filters.push_back(f);
+            }
+        }
+        else if (name == "filters")
+        {
+            filters = parseIntList(value, "--filters", argv[0]);
+        }
+        else if (name == "pattern")
+        {
+            patterns.push_back(value);
+        }
+        else if (name == "output")
+        {
+            outputTemplate = value;
+        }
+        else if (name == "plan")
+        {
+            options.printPlan = true;
+        }
+        else if (name == "order")
+        {
+            if (value == "auto")
+            {
+                options.order = ORDER_AUTO;
+            }
+            else if (value == "filter-first")
+            {
+                options.order = ORDER_FILTER_FIRST;
+            }
+            else if (value == "resize-first")
+            {
+                options.order = ORDER_RESIZE_FIRST;
+            }
+            else
+            {
+                cerr << "Unknown order " << value << endl;
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (name == "sampling")
+        {
+            samplingSet = true;
+            if (value == "resize")
+            {
+                options.sampling = SAMPLING_RESIZE;
+            }
+            else if (value == "area")
+            {
+                options.sampling = SAMPLING_AREA;
+            }
+            else
+            {
+                cerr << "Unknown sampling " << value << endl;
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (name == "backend")
+        {
+            if (value == "npp")
+            {
+                options.backend = BACKEND_NPP;
+            }
+            else if (value == "host")
+            {
+                options.backend = BACKEND_HOST;
+            }
+            else
+            {
+                cerr << "Unknown backend " << value << endl;
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (name == "mode")
+        {
+            if (value == "text")
+            {
+                options.mode = MODE_TEXT;
+            }
+            else if (value == "braille")
+            {
+                options.mode = MODE_BRAILLE;
+            }
+            else if (value == "halfblock")
+            {
+                options.mode = MODE_HALFBLOCK;
+            }
+            else
+            {
+                cerr << "Unknown mode " << value << endl;
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (name == "threshold")
+        {
+            options.threshold = value == "dither" ? 0 : parseInt(value, "--threshold", argv[0]);
+            if (options.threshold < 0 || options.threshold > 255)
+            {
+                cerr << "Threshold must be between 0 and 255, or dither" << endl;
+                exit(1);
+            }
+        }
+        else if (name == "color")
+        {
+            if (value == "none")
+            {
+                options.color = COLOR_NONE;
+            }
+            else if (value == "256")
+            {
+                options.color = COLOR_256;
+            }
+            else if (value == "truecolor")
+            {
+                options.color = COLOR_TRUECOLOR;
+            }
+            else
+            {
+                cerr << "Unknown color " << value << endl;
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (name == "format")
+        {
+            if (value == "text")
+            {
+                options.format = FORMAT_TEXT;
+            }
+            else if (value == "html")
+            {
+                options.format = FORMAT_HTML;
+            }
+            else
+            {
+                cerr << "Unknown format " << value << endl;
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (name == "luma")
+        {
+            if (value == "bt601")
+            {
+                setLumaStandard(LUMA_BT601);
+            }
+            else if (value == "bt709")
+            {
+                setLumaStandard(LUMA_BT709);
+            }
+            else
+            {
+                cerr << "Unknown luma " << value << endl;
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (name == "blur")
+        {
+            options.blurRadius = parseInt(value, "--blur", argv[0]);
+        }
+        else if (name == "preview")
+        {
+            preview = true;
+        }
+        else if (name == "profile")
+        {
+            profilePath = value.empty() ? "-" : value;
+        }
+        else if (name == "counters")
+        {
+            counters = true;
+        }
+        else if (name == "threads")
+        {
+            setParallelThreads(parseInt(value, "--threads", argv[0]));
+            threadsSet = true;
+        }
+        else if (name == "cpu")
+        {
+            CpuLevel level = parseCpuLevel(value);
+            if (level == CPU_LEVEL_COUNT)
+            {
+                cerr << "Unknown CPU level " << value << ", expected scalar, sse4.2, avx2 or avx512" << endl;
+                exit(1);
+            }
+            if (selectCpuLevel(level) != level)
+            {
+                cerr << "CPU level " << value << " is not supported, using " << cpuLevelName(detectedCpuLevel()) << endl;
+            }
+        }
+        else if (name == "tune")
+        {
+            tuneClasses = value.empty() ? ~0u : 0;
+            stringstream ss(value);
+            string className;
+            while (getline(ss, className, ','))
+            {
+                SizeClass c = parseSizeClass(className);
+                if (c == SIZE_CLASS_COUNT)
+                {
+                    cerr << "Unknown size class " << className << endl;
+                    exit(1);
+                }
+                tuneClasses |= 1u << c;
+            }
+        }
+        else if (name == "tuning")
+        {
+            tuningPath = value;
+        }
+        else if (name == "trace")
+        {
+#ifdef ASCIIART_TRACE
+            tracePath = value.empty() ? "trace.json" : value;
+#else
+            cerr << "Tracing is not built in, rebuild with TRACE=1 (make) or -DASCIIART_TRACE=ON (cmake)" << endl;
+            exit(1);
+#endif
+        }
+        else if (name == "repeat")
+        {
+            repeat = max(1, parseInt(value, "--repeat", argv[0]));
+        }
+        else if (name == "warmup")
+        {
+            warmup = max(0, parseInt(value, "--warmup", argv[0]));
+        }
+        else
+        {
+            cerr << "Unknown option " << arg << endl;
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+
+    profiler().addStartup("options", profiler().startupMs());
+
+    string cpu;
+    {
+        StartupScope scope("cpu_probe");
+        cpu = cpuModel();
+        hostKernels();
+    }
+
+    if (tuneClasses)
+    {
+        TuningTable table = {};
+        if (tuningPath != "none")
+        {
+            loadTuning(tuningPath, cpu, table);
+        }
+        cerr << "Tuning the host stages on " << cpu << endl;
+        tune(cerr, table, tuneClasses);
+        // --tuning=none: no cache, the results are only printed
+        if (tuningPath == "none")
+        {
+            return EXIT_SUCCESS;
+        }
+        if (!saveTuning(tuningPath, cpu, table))
+        {
+            cerr << "Unable to write the tuning cache " << tuningPath << endl;
+            return EXIT_FAILURE;
+        }
+        cerr << "Saved to " << tuningPath << endl;
+        return EXIT_SUCCESS;
+    }
+
+    // Settings tuned on this CPU, unless the threads are given
+    if (!threadsSet && tuningPath != "none")
+    {
+        StartupScope scope("tuning");
+        loadTuning(tuningPath, cpu, activeTuning());
+    }
+
+    if (args.empty())
+    {
+        usage(argv[0]);
+        exit(1);
+    }
+
+    // Get image path
+    imagePath = args[0];
+
+    // Parse column width
+    if (args.size() > 1)
+    {
+        columnWidth = parseInt(args[1], "width", argv[0]);
+    }
+
+    if (args.size() > 2) {
+        filter = parseInt(args[2], "filter", argv[0]);
+    }
+
+    // Parse ASCII pattern
+    if (args.size() > 3)
+    {
+        asciiPattern = args[3];
+    }
+
+    // Positional arguments are the defaults for the matrix
+    if (widths.empty())
+    {
+        widths.push_back(columnWidth);
+    }
+    if (filters.empty())
+    {
+        filters.push_back(filter);
+    }
+    if (patterns.empty())
+    {
+        patterns.push_back(asciiPattern);
+    }
+
+    // The host backend reduces by area only: its cubic resize is not verified against NPP
+    if (options.backend == BACKEND_HOST)
+    {
+        if (samplingSet && options.sampling == SAMPLING_RESIZE)
+        {
+            cerr << "The host backend has no cubic resize verified against NPP, use --sampling=area" << endl;
+            exit(1);
+        }
+        options.sampling = SAMPLING_AREA;
+    }
+
+    vector<RenderRequest> requests = RenderPlan::matrix(widths, filters, patterns, outputTemplate);
+
+    // Counters are part of the profile report
+    if (counters && profilePath.empty())
+    {
+        profilePath = "-";
+    }
+
+    profiler().setOutputFormat(outputFormatName(options.format));
+    if (counters)
+    {
+        profiler().enableCounters();
+    }
+    else if (!profilePath.empty())
+    {
+        profiler().enable();
+    }
+    else
+    {
+        // Without profile, just one run
+        repeat = 1;
+        warmup = 0;
+    }
+
+#ifdef ASCIIART_TRACE
+    if (!tracePath.empty())
+    {
+        traceEnable();
+    }
+#endif
+
+    bool result = true;
+    for (int run = 0; run < warmup + repeat && result; run++)
+    {
+        TRACE_SCOPE("run", run >= warmup ? "measured run" : "warmup run");
+        profiler().beginRun(run >= warmup);
+
+        if (preview)
+        {
+            result = previewASCIIArt(cout, imagePath, widths[0], patterns[0], options.backend);
+        }
+        else
+        {
+            // Do de magic!
+            result = renderASCIIArt(imagePath, requests, options);
+        }
+
+        profiler().endRun();
+        // The plan is printed only once
+        options.printPlan = false;
+    }
+
+    if (profilePath == "-")
+    {
+        profiler().report(cerr, imagePath, warmup);
+    }
+    else if (!profilePath.empty())
+    {
+        ofstream ofs(profilePath);
+        if (!ofs || !profiler().report(ofs, imagePath, warmup))
+        {
+            cerr << "Unable to write the profile to " << profilePath << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+#ifdef ASCIIART_TRACE
+    if (!tracePath.empty() && !traceWrite(tracePath))
+    {
+        cerr << "Unable to write the trace to " << tracePath << endl;
+        return EXIT_FAILURE;
+    }
+#endif
+
+    return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
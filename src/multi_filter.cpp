@@ -0,0 +1,71 @@
+/**
+ * @file
+ * @brief Multi filter - Applies several 3x3 filters reading the source only once
+ * Host implementation. See multi_filter.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <string.h>
+
+#include "cpu_dispatch.h"
+#include "multi_filter.h"
+
+bool multiFilterKernels(const vector<int> &filters, MultiFilterPlanes &planes)
+{
+    if (filters.size() > FILTER_COUNT)
+    {
+        return false;
+    }
+
+    planes.count = (int)filters.size();
+    for (int k = 0; k < planes.count; k++)
+    {
+        memcpy(planes.kernel[k], filterKernels[effectiveFilter(filters[k])], sizeof(planes.kernel[k]));
+    }
+    return true;
+}
+
+NppStatus multiFilter3x3(const npp::ImageCPU_8u_C1 &src,
+                         const vector<int> &filters,
+                         npp::ImageCPU_8u_C1 *dst)
+{
+    MultiFilterPlanes planes;
+    if (!multiFilterKernels(filters, planes))
+    {
+        return NPP_BAD_ARGUMENT_ERROR;
+    }
+
+    if (src.width() < 3 || src.height() < 3)
+    {
+        return NPP_SIZE_ERROR;
+    }
+
+    // Same ROI as convolutionFilter()
+    NppiSize dstSize = {(int)src.width() - 2, (int)src.height() - 2};
+
+    for (int k = 0; k < planes.count; k++)
+    {
+        npp::ImageCPU_8u_C1 plane(dstSize.width, dstSize.height);
+        plane.swap(dst[k]);
+        planes.data[k] = dst[k].data();
+        planes.pitch[k] = (int)dst[k].pitch();
+    }
+
+    // One row of every kernel at a time: the three source rows stay in L1 between kernels
+    Filter3x3RowKernel filter3x3Row = hostKernels().filter3x3Row;
+    unsigned int srcPitch = src.pitch();
+    for (int y = 0; y < dstSize.height; y++)
+    {
+        const Npp8u *row0 = src.data(0, y);
+        const Npp8u *row1 = row0 + srcPitch;
+        const Npp8u *row2 = row1 + srcPitch;
+
+        for (int k = 0; k < planes.count; k++)
+        {
+            filter3x3Row(row0, row1, row2, dstSize.width, planes.kernel[k], planes.data[k] + y * planes.pitch[k]);
+        }
+    }
+
+    return NPP_NO_ERROR;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file
+ * @brief Multi filter - Applies several 3x3 filters reading the source only once
+ * Device implementation. See multi_filter.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <cuda_runtime.h>
+
+#include "multi_filter.h"
+
+/**
+ * @brief One thread per destination pixel: loads its 3x3 neighborhood once and
+ * evaluates every kernel on it.
+ * @param src Source image
+ * @param srcPitch Source pitch
+ * @param width Destination width
+ * @param height Destination height
+ * @param planes Kernels and destination planes
+ */
+__global__ void multiFilter3x3Kernel(const Npp8u *src, int srcPitch, int width, int height, MultiFilterPlanes planes)
+{
+    int x = blockIdx.x * blockDim.x + threadIdx.x;
+    int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+    if (x >= width || y >= height)
+    {
+        return;
+    }
+
+    const Npp8u *row0 = src + y * srcPitch + x;
+    const Npp8u *row1 = row0 + srcPitch;
+    const Npp8u *row2 = row1 + srcPitch;
+
+    int p[9] = {row0[0], row0[1], row0[2],
+                row1[0], row1[1], row1[2],
+                row2[0], row2[1], row2[2]};
+
+    multiFilterPixel(p, planes, x, y);
+}
+
+NppStatus multiFilter3x3(npp::ImageNPP_8u_C1 &src,
+                         const vector<int> &filters,
+                         npp::ImageNPP_8u_C1 *dst,
+                         const NppStreamContext &nppStreamCtx)
+{
+    MultiFilterPlanes planes;
+    if (!multiFilterKernels(filters, planes))
+    {
+        return NPP_BAD_ARGUMENT_ERROR;
+    }
+
+    if (src.width() < 3 || src.height() < 3)
+    {
+        return NPP_SIZE_ERROR;
+    }
+
+    // Same ROI as convolutionFilter()
+    NppiSize dstSize = {(int)src.width() - 2, (int)src.height() - 2};
+
+    for (int k = 0; k < planes.count; k++)
+    {
+        npp::ImageNPP_8u_C1 plane(dstSize.width, dstSize.height);
+        plane.swap(dst[k]);
+        planes.data[k] = dst[k].data();
+        planes.pitch[k] = (int)dst[k].pitch();
+    }
+
+    dim3 block(32, 8);
+    dim3 grid((dstSize.width + block.x - 1) / block.x, (dstSize.height + block.y - 1) / block.y);
+
+    multiFilter3x3Kernel<<<grid, block, 0, nppStreamCtx.hStream>>>(src.data(), (int)src.pitch(), dstSize.width, dstSize.height, planes);
+
+    if (cudaGetLastError() != cudaSuccess)
+    {
+        return NPP_CUDA_KERNEL_EXECUTION_ERROR;
+    }
+
+    return NPP_NO_ERROR;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file
+ * @brief Output assembler - Rows encoded on host threads, put together in order
+ * See output_assembler.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <cstring>
+
+#include "output_assembler.h"
+#include "parallel.h"
+
+using namespace std;
+
+void OutputAssembler::encode(int first, int count, RowEncoder encodeRow, int chunks)
+{
+    chunks = count > 0 ? parallelChunks(count, chunks) : 0;
+    if ((int)bands_.size() < chunks)
+    {
+        bands_.resize(chunks);
+    }
+
+    if (chunks > 0)
+    {
+        parallelFor(count, [&](int chunk, int begin, int end) {
+            vector<char> &band = bands_[chunk];
+            band.clear();
+            for (int y = begin; y < end; y++)
+            {
+                encodeRow(first + y, band);
+            }
+        }, chunks);
+    }
+
+    offsets_.assign(chunks + 1, 0);
+    for (int b = 0; b < chunks; b++)
+    {
+        offsets_[b + 1] = offsets_[b] + bands_[b].size();
+    }
+}
+
+bool OutputAssembler::write(ostream &out) const
+{
+    for (size_t b = 0; b + 1 < offsets_.size(); b++)
+    {
+        out.write(bands_[b].data(), bands_[b].size());
+    }
+    return (bool)out;
+}
+
+void OutputAssembler::copyTo(char *out) const
+{
+    int bands = (int)offsets_.size() - 1;
+    if (bands <= 0)
+    {
+        return;
+    }
+    parallelFor(bands, [&](int chunk, int begin, int end) {
+        for (int b = begin; b < end; b++)
+        {
+            memcpy(out + offsets_[b], bands_[b].data(), bands_[b].size());
+        }
+    }, bands);
+}
+
+size_t rowOffsets(int count, RowSize rowSize, vector<size_t> &offsets)
+{
+    vector<size_t> chunkBytes;
+    return rowOffsets(count, rowSize, offsets, chunkBytes);
+}
+
+size_t rowOffsets(int count, RowSize rowSize, vector<size_t> &offsets, vector<size_t> &chunkBytes)
+{
+    offsets.assign((size_t)count + 1, 0);
+    if (count <= 0)
+    {
+        return 0;
+    }
+
+    // Each chunk sums its rows on its own, as if it was the first one
+    chunkBytes.assign(parallelChunks(count), 0);
+    int chunks = parallelFor(count, [&](int chunk, int begin, int end) {
+        size_t bytes = 0;
+        for (int y = begin; y < end; y++)
+        {
+            offsets[y] = bytes;
+            bytes += rowSize(y);
+        }
+        chunkBytes[chunk] = bytes;
+    }, (int)chunkBytes.size());
+
+    // Then every chunk is offset by the chunks above
+    size_t total = 0;
+    for (int c = 0; c < chunks; c++)
+    {
+        size_t bytes = chunkBytes[c];
+        chunkBytes[c] = total;
+        total += bytes;
+    }
+    offsets[count] = total;
+
+    parallelFor(count, [&](int chunk, int begin, int end) {
+        for (int y = begin; y < end; y++)
+        {
+            offsets[y] += chunkBytes[chunk];
+        }
+    }, chunks);
+    return total;
+}
+
+void assembleRows(int count, const vector<size_t> &offsets, RowWriter writeRow, char *out)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+    parallelFor(count, [&](int chunk, int begin, int end) {
+        for (int y = begin; y < end; y++)
+        {
+            writeRow(y, out + offsets[y]);
+        }
+    });
+}
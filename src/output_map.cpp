@@ -0,0 +1,188 @@
+/**
+ * @file
+ * @brief Output map - Memory the ASCII art is quantized into, in place
+ * See output_map.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <iostream>
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "output_map.h"
+#include "trace.h"
+
+using namespace std;
+
+OutputMap::OutputMap() : data_(nullptr), length_(0), mapped_(0), fd_(-1), pipe_(false) {}
+
+OutputMap::~OutputMap()
+{
+    release();
+}
+
+void OutputMap::truncate(size_t length)
+{
+    if (length < length_)
+    {
+        length_ = length;
+    }
+}
+
+#ifdef __linux__
+
+bool OutputMap::open(const string &outputPath, size_t length)
+{
+    release();
+    if (length == 0)
+    {
+        return false;
+    }
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    mapped_ = (length + page - 1) / page * page;
+    length_ = length;
+
+    if (outputPath == "-")
+    {
+        // Only pipes take gifted pages, anything else is written by the stream
+        struct stat st;
+        if (fstat(STDOUT_FILENO, &st) != 0 || !S_ISFIFO(st.st_mode))
+        {
+            return false;
+        }
+
+        void *p = mmap(nullptr, mapped_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+        {
+            return false;
+        }
+        data_ = (char *)p;
+        fd_ = STDOUT_FILENO;
+        pipe_ = true;
+        return true;
+    }
+
+    TRACE_SCOPE("io", "map file");
+    fd_ = ::open(outputPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd_ < 0)
+    {
+        return false;
+    }
+
+    // Allocate the blocks now, so a full disk fails here and not as a SIGBUS on a store.
+    // File systems without fallocate only get the size.
+    if (posix_fallocate(fd_, 0, (off_t)length) != 0 && ftruncate(fd_, (off_t)length) != 0)
+    {
+        release();
+        return false;
+    }
+
+    void *p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED)
+    {
+        release();
+        return false;
+    }
+    data_ = (char *)p;
+    return true;
+}
+
+bool OutputMap::commit()
+{
+    if (data_ == nullptr)
+    {
+        return false;
+    }
+
+    bool result = true;
+    if (pipe_)
+    {
+        TRACE_SCOPE("io", "vmsplice");
+        // Anything still buffered by cout goes first
+        cout.flush();
+        // The pipe takes the pages, they are not touched again, only unmapped
+        struct iovec iov = {data_, length_};
+        while (iov.iov_len > 0)
+        {
+            ssize_t n = vmsplice(fd_, &iov, 1, SPLICE_F_GIFT);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                // Not supported here: plain writes of the rest
+                n = write(fd_, iov.iov_base, iov.iov_len);
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    cerr << "Unable to write to the standard output: " << strerror(errno) << endl;
+                    result = false;
+                    break;
+                }
+            }
+            iov.iov_base = (char *)iov.iov_base + n;
+            iov.iov_len -= n;
+        }
+    }
+    else
+    {
+        // The file keeps the bytes written, the rest of the preallocated blocks is freed
+        munmap(data_, mapped_);
+        data_ = nullptr;
+        if (ftruncate(fd_, (off_t)length_) != 0)
+        {
+            cerr << "Unable to truncate the output file: " << strerror(errno) << endl;
+            result = false;
+        }
+    }
+
+    release();
+    return result;
+}
+
+void OutputMap::release()
+{
+    if (data_ != nullptr)
+    {
+        munmap(data_, mapped_);
+    }
+    if (fd_ >= 0 && !pipe_)
+    {
+        ::close(fd_);
+    }
+    data_ = nullptr;
+    length_ = 0;
+    mapped_ = 0;
+    fd_ = -1;
+    pipe_ = false;
+}
+
+#else
+
+bool OutputMap::open(const string &outputPath, size_t length)
+{
+    return false;
+}
+
+bool OutputMap::commit()
+{
+    return false;
+}
+
+void OutputMap::release() {}
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @brief Hardware performance counters of the calling thread (Linux perf_event_open)
+ * See perf_counters.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "perf_counters.h"
+
+using namespace std;
+
+PerfCounters::PerfCounters() : available_(false)
+{
+    for (int c = 0; c < COUNTER_COUNT; c++)
+    {
+        fd_[c] = -1;
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (int c = 0; c < COUNTER_COUNT; c++)
+    {
+        if (fd_[c] >= 0)
+        {
+            close(fd_[c]);
+        }
+    }
+#endif
+}
+
+bool PerfCounters::open()
+{
+#ifdef __linux__
+    // Type and config of each counter
+    static const unsigned int types[COUNTER_COUNT] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE};
+    static const unsigned long long configs[COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_SW_TASK_CLOCK};
+
+    for (int c = 0; c < COUNTER_COUNT; c++)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[c];
+        attr.config = configs[c];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // This thread, any CPU
+        fd_[c] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd_[c] < 0 && error_.empty())
+        {
+            error_ = string(counterName((PerfCounter)c)) + ": " + strerror(errno);
+        }
+        available_ = available_ || fd_[c] >= 0;
+    }
+    return available_;
+#else
+    error_ = "perf_event_open is only available on Linux";
+    return false;
+#endif
+}
+
+void PerfCounters::read(PerfSample &sample) const
+{
+    for (int c = 0; c < COUNTER_COUNT; c++)
+    {
+        sample.value[c] = 0;
+#ifdef __linux__
+        // value, time enabled, time running
+        unsigned long long data[3];
+        if (fd_[c] >= 0 && ::read(fd_[c], data, sizeof(data)) == (ssize_t)sizeof(data))
+        {
+            sample.value[c] = data[2] ? (double)data[0] * data[1] / data[2] : 0;
+        }
+#endif
+    }
+}
+
+PerfCounters &threadPerfCounters()
+{
+    // One set of counters for each thread, opened once
+    thread_local PerfCounters counters;
+    thread_local bool opened = false;
+
+    if (!opened)
+    {
+        opened = true;
+        counters.open();
+    }
+    return counters;
+}
+
+const char *counterName(PerfCounter counter)
+{
+    static const char *names[COUNTER_COUNT] = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "task_clock_ns"};
+    return counter >= 0 && counter < COUNTER_COUNT ? names[counter] : "unknown";
+}
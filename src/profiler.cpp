@@ -0,0 +1,568 @@
+/**
+ * @file
+ * @brief Stage profiler - Times every stage of the pipeline
+ * See profiler.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <cuda_runtime.h>
+
+#include "cpu_dispatch.h"
+#include "profiler.h"
+
+using namespace std;
+
+/**
+ * @brief Sets every counter to 0
+ */
+static void clearSample(PerfSample &sample)
+{
+    for (int c = 0; c < COUNTER_COUNT; c++)
+    {
+        sample.value[c] = 0;
+    }
+}
+
+/**
+ * @brief Adds end - begin to a sample
+ */
+static void addSample(PerfSample &sample, const PerfSample &begin, const PerfSample &end)
+{
+    for (int c = 0; c < COUNTER_COUNT; c++)
+    {
+        sample.value[c] += end.value[c] - begin.value[c];
+    }
+}
+
+/**
+ * @brief Allocation hook of the UtilNPP allocators
+ */
+static void countAllocation(npp::AllocationPool pool, const void *data, size_t bytes)
+{
+    profiler().allocation(pool, data, bytes);
+}
+
+Profiler::Profiler()
+    : enabled_(false), measured_(false), runTimer_(nullptr), deviceUsed_(false), firstLineMs_(-1),
+      outputFormat_("text"), outputs_(0), outputBytes_(0), lastOutputs_(0), lastOutputBytes_(0),
+      startupBegin_(chrono::steady_clock::now()), firstByteMs_(-1), countersEnabled_(false), activeStage_(-1),
+      runAllocations_(0)
+{
+    for (MemoryPool &pool : pools_)
+    {
+        pool = {0, 0, 0, 0, {0}};
+    }
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        timers_[s] = nullptr;
+        counters_[s] = {0, 0, 0, 0, 0};
+        lastCounters_[s] = {0, 0, 0, 0, 0};
+        parentStage_[s] = -1;
+        clearSample(stageStart_[s]);
+        clearSample(stageCounters_[s]);
+        clearSample(stageTotals_[s]);
+    }
+    clearSample(runStart_);
+}
+
+Profiler::~Profiler()
+{
+    // Images freed after the profiler are not counted
+    if (npp::allocationHook() == countAllocation)
+    {
+        npp::allocationHook() = nullptr;
+    }
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        sdkDeleteTimer(&timers_[s]);
+    }
+    sdkDeleteTimer(&runTimer_);
+}
+
+void Profiler::enable()
+{
+    if (enabled_)
+    {
+        return;
+    }
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        sdkCreateTimer(&timers_[s]);
+    }
+    sdkCreateTimer(&runTimer_);
+    npp::allocationHook() = countAllocation;
+    enabled_ = true;
+}
+
+void Profiler::enableCounters()
+{
+    enable();
+    // Open the main thread counters now, not inside the first stage
+    threadPerfCounters();
+    countersEnabled_ = true;
+}
+
+void Profiler::beginRun(bool measured)
+{
+    if (!enabled_)
+    {
+        return;
+    }
+    measured_ = measured;
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        sdkResetTimer(&timers_[s]);
+        counters_[s] = {0, 0, 0, 0, 0};
+        clearSample(stageCounters_[s]);
+    }
+    runAllocations_ = 0;
+    deviceUsed_ = false;
+    firstLineMs_ = -1;
+    outputs_ = 0;
+    outputBytes_ = 0;
+    if (countersEnabled_)
+    {
+        threadCounters_.assign(1, PerfSample());
+        clearSample(threadCounters_[0]);
+        threadPerfCounters().read(runStart_);
+    }
+    sdkResetTimer(&runTimer_);
+    sdkStartTimer(&runTimer_);
+}
+
+void Profiler::endRun()
+{
+    if (!enabled_)
+    {
+        return;
+    }
+    // Only runs that used the device wait for it, the host backend never touches CUDA
+    if (deviceUsed_)
+    {
+        cudaDeviceSynchronize();
+    }
+    sdkStopTimer(&runTimer_);
+    if (!measured_)
+    {
+        return;
+    }
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        times_[s].push_back(sdkGetTimerValue(&timers_[s]));
+        lastCounters_[s] = counters_[s];
+    }
+    runTimes_.push_back(sdkGetTimerValue(&runTimer_));
+    if (firstLineMs_ >= 0)
+    {
+        firstLineTimes_.push_back(firstLineMs_);
+    }
+    allocationsPerRun_.push_back(runAllocations_);
+    lastOutputs_ = outputs_;
+    lastOutputBytes_ = outputBytes_;
+
+    if (countersEnabled_)
+    {
+        PerfSample runEnd;
+        threadPerfCounters().read(runEnd);
+        addSample(threadCounters_[0], runStart_, runEnd);
+
+        PerfSample zero;
+        clearSample(zero);
+        for (int s = 0; s < STAGE_COUNT; s++)
+        {
+            addSample(stageTotals_[s], zero, stageCounters_[s]);
+        }
+        for (size_t t = 0; t < threadCounters_.size(); t++)
+        {
+            if (t == threadTotals_.size())
+            {
+                threadTotals_.push_back(zero);
+            }
+            addSample(threadTotals_[t], zero, threadCounters_[t]);
+        }
+    }
+}
+
+void Profiler::start(ProfileStage stage)
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        parentStage_[stage] = activeStage_;
+        activeStage_ = stage;
+    }
+    if (countersEnabled_)
+    {
+        threadPerfCounters().read(stageStart_[stage]);
+    }
+    sdkStartTimer(&timers_[stage]);
+}
+
+void Profiler::stop(ProfileStage stage, double bytes, double pixels, bool device)
+{
+    if (device)
+    {
+        TRACE_SCOPE("wait", "device synchronize");
+        cudaDeviceSynchronize();
+        deviceUsed_ = true;
+    }
+    sdkStopTimer(&timers_[stage]);
+    counters_[stage].calls++;
+    counters_[stage].bytes += bytes;
+    counters_[stage].pixels += pixels;
+
+    PerfSample end;
+    if (countersEnabled_)
+    {
+        threadPerfCounters().read(end);
+    }
+    lock_guard<mutex> lock(mutex_);
+    if (countersEnabled_)
+    {
+        addSample(stageCounters_[stage], stageStart_[stage], end);
+    }
+    activeStage_ = parentStage_[stage];
+}
+
+void Profiler::startupBegin()
+{
+    startupBegin_ = chrono::steady_clock::now();
+}
+
+double Profiler::startupMs() const
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - startupBegin_).count();
+}
+
+void Profiler::addStartup(const char *phase, double ms)
+{
+    lock_guard<mutex> lock(mutex_);
+    startup_.push_back({phase, ms});
+}
+
+void Profiler::firstByte()
+{
+    lock_guard<mutex> lock(mutex_);
+    if (firstByteMs_ < 0)
+    {
+        firstByteMs_ = startupMs();
+    }
+}
+
+void Profiler::firstLine()
+{
+    firstByte();
+    if (enabled_ && firstLineMs_ < 0)
+    {
+        firstLineMs_ = sdkGetTimerValue(&runTimer_);
+    }
+}
+
+void Profiler::addOutput(double bytes)
+{
+    if (enabled_)
+    {
+        outputs_++;
+        outputBytes_ += bytes;
+    }
+}
+
+void Profiler::addThreadCounters(int thread, const PerfSample &begin, const PerfSample &end)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (activeStage_ >= 0)
+    {
+        addSample(stageCounters_[activeStage_], begin, end);
+    }
+    if ((int)threadCounters_.size() <= thread)
+    {
+        PerfSample zero;
+        clearSample(zero);
+        threadCounters_.resize(thread + 1, zero);
+    }
+    addSample(threadCounters_[thread], begin, end);
+}
+
+void Profiler::allocation(npp::AllocationPool pool, const void *data, size_t bytes)
+{
+    lock_guard<mutex> lock(mutex_);
+
+    if (bytes == 0)
+    {
+        // Memory allocated before profiling started is not known
+        auto it = live_.find(data);
+        if (it != live_.end())
+        {
+            MemoryPool &p = pools_[it->second.second];
+            p.liveBytes -= it->second.first;
+            p.frees++;
+            live_.erase(it);
+        }
+        return;
+    }
+
+    MemoryPool &p = pools_[pool];
+    live_[data] = {bytes, pool};
+    p.liveBytes += bytes;
+    p.peakBytes = max(p.peakBytes, p.liveBytes);
+    p.allocations++;
+
+    int sizeClass = 0;
+    while (sizeClass < MEMORY_SIZE_CLASSES - 1 && ((size_t)1 << sizeClass) < bytes)
+    {
+        sizeClass++;
+    }
+    p.sizes[sizeClass]++;
+
+    runAllocations_++;
+    if (activeStage_ >= 0)
+    {
+        counters_[activeStage_].allocations++;
+        counters_[activeStage_].allocatedBytes += bytes;
+    }
+}
+
+/**
+ * @brief Nearest rank percentile
+ * @param sorted Sorted values, not empty
+ * @param p Percentile, 0 - 100
+ */
+static float percentile(const vector<float> &sorted, double p)
+{
+    size_t rank = (size_t)ceil(p / 100.0 * sorted.size());
+    return sorted[rank ? rank - 1 : 0];
+}
+
+/**
+ * @brief Writes the percentiles of a list of times as a JSON object
+ */
+static void writeTimes(ostream &out, vector<float> times)
+{
+    sort(times.begin(), times.end());
+    out << "{\"min\": " << times.front()
+        << ", \"p50\": " << percentile(times, 50)
+        << ", \"p90\": " << percentile(times, 90)
+        << ", \"p99\": " << percentile(times, 99)
+        << ", \"max\": " << times.back() << "}";
+}
+
+/**
+ * @brief Writes the open counters of a sample, divided by the number of runs, as JSON members
+ */
+static void writeCounters(ostream &out, const PerfSample &sample, double runs)
+{
+    const PerfCounters &counters = threadPerfCounters();
+    bool first = true;
+    out << setprecision(0);
+    for (int c = 0; c < COUNTER_COUNT; c++)
+    {
+        if (counters.valid((PerfCounter)c))
+        {
+            out << (first ? "" : ", ") << "\"" << counterName((PerfCounter)c) << "\": " << sample.value[c] / runs;
+            first = false;
+        }
+    }
+    out << setprecision(3);
+    // Instructions per cycle
+    if (counters.valid(COUNTER_CYCLES) && counters.valid(COUNTER_INSTRUCTIONS))
+    {
+        double cycles = sample.value[COUNTER_CYCLES];
+        out << (first ? "" : ", ") << "\"ipc\": " << (cycles > 0 ? sample.value[COUNTER_INSTRUCTIONS] / cycles : 0.0);
+    }
+}
+
+/**
+ * @brief Writes a string as a JSON string
+ */
+static void writeString(ostream &out, const string &str)
+{
+    out << '"';
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+ostream &Profiler::report(ostream &out, const string &imagePath, int warmup) const
+{
+    out << "{" << endl
+        << "  \"image\": ";
+    writeString(out, imagePath);
+    out << "," << endl
+        << "  \"warmup\": " << warmup << "," << endl
+        << "  \"repeat\": " << runTimes_.size() << "," << endl
+        << "  \"timer\": \"helper_timer\"," << endl
+        << "  \"unit\": \"ms\"," << endl
+        << "  \"dispatch\": ";
+    printDispatch(out) << "," << endl;
+
+    // Startup, once per process: every phase, and the first byte of output
+    out << fixed << setprecision(3)
+        << "  \"startup\": {\"phases\": [";
+    for (size_t p = 0; p < startup_.size(); p++)
+    {
+        out << (p ? ", " : "") << "{\"name\": \"" << startup_[p].first << "\", \"ms\": " << startup_[p].second << "}";
+    }
+    out << "], \"first_byte_ms\": " << max(firstByteMs_, 0.0) << "}," << endl
+        << defaultfloat;
+
+    if (countersEnabled_)
+    {
+        // Counters are read on the main thread, the same ones were requested on the workers
+        const PerfCounters &counters = threadPerfCounters();
+        out << "  \"counters\": {\"available\": " << (counters.available() ? "true" : "false")
+            << ", \"events\": [";
+        bool first = true;
+        for (int c = 0; c < COUNTER_COUNT; c++)
+        {
+            if (counters.valid((PerfCounter)c))
+            {
+                out << (first ? "" : ", ") << "\"" << counterName((PerfCounter)c) << "\"";
+                first = false;
+            }
+        }
+        out << "], \"error\": ";
+        writeString(out, counters.error());
+        out << "}," << endl;
+    }
+
+    if (runTimes_.empty())
+    {
+        return out << "  \"stages\": []" << endl
+                   << "}" << endl;
+    }
+
+    out << fixed << setprecision(3)
+        << "  \"total\": ";
+    writeTimes(out, runTimes_);
+    if (!firstLineTimes_.empty())
+    {
+        out << "," << endl
+            << "  \"first_line\": ";
+        writeTimes(out, firstLineTimes_);
+    }
+    out << "," << endl
+        << "  \"stages\": [" << endl;
+
+    bool first = true;
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        const StageCounters &c = lastCounters_[s];
+        if (c.calls == 0)
+        {
+            continue;
+        }
+
+        vector<float> sorted = times_[s];
+        sort(sorted.begin(), sorted.end());
+        double seconds = percentile(sorted, 50) / 1000.0;
+
+        out << (first ? "" : ",\n") << "    {\"name\": \"" << stageName((ProfileStage)s) << "\""
+            << ", \"calls\": " << c.calls
+            << setprecision(0) << ", \"bytes\": " << c.bytes
+            << ", \"pixels\": " << c.pixels << setprecision(3)
+            << ", \"ms\": ";
+        writeTimes(out, times_[s]);
+        // Throughput at the median, 0 when too fast to measure
+        out << ", \"gbps\": " << (seconds > 0 ? c.bytes / seconds / 1e9 : 0.0)
+            << ", \"ns_per_pixel\": " << (c.pixels > 0 ? seconds * 1e9 / c.pixels : 0.0)
+            << setprecision(0) << ", \"allocations\": " << c.allocations
+            << ", \"allocated_bytes\": " << c.allocatedBytes << setprecision(3);
+        if (countersEnabled_)
+        {
+            // Average of the measured runs, main thread and workers
+            out << ", \"counters\": {";
+            writeCounters(out, stageTotals_[s], (double)runTimes_.size());
+            out << "}";
+        }
+        out << "}";
+        first = false;
+    }
+
+    out << endl
+        << "  ],";
+
+    // Outputs of the last run: the size to compare with other formats, the quantize stage is the render time
+    out << endl
+        << "  \"output\": {\"format\": ";
+    writeString(out, outputFormat_);
+    out << setprecision(0) << ", \"outputs\": " << lastOutputs_ << ", \"bytes\": " << lastOutputBytes_ << "},"
+        << setprecision(3);
+
+    // Allocations of every run after the warmup: 0 in a steady state
+    vector<int> sortedAllocations = allocationsPerRun_;
+    sort(sortedAllocations.begin(), sortedAllocations.end());
+    out << endl
+        << setprecision(0)
+        << "  \"memory\": {\"allocations_per_run\": {\"min\": " << sortedAllocations.front()
+        << ", \"max\": " << sortedAllocations.back() << "}";
+    static const char *poolNames[2] = {"host", "device"};
+    for (int p = 0; p < 2; p++)
+    {
+        const MemoryPool &pool = pools_[p];
+        out << "," << endl
+            << "    \"" << poolNames[p] << "\": {\"live_bytes\": " << pool.liveBytes
+            << ", \"peak_bytes\": " << pool.peakBytes
+            << ", \"allocations\": " << pool.allocations
+            << ", \"frees\": " << pool.frees
+            << ", \"sizes\": [";
+        bool firstClass = true;
+        for (int s = 0; s < MEMORY_SIZE_CLASSES; s++)
+        {
+            if (pool.sizes[s])
+            {
+                out << (firstClass ? "" : ", ") << "{\"up_to\": " << ((unsigned long long)1 << s)
+                    << ", \"count\": " << pool.sizes[s] << "}";
+                firstClass = false;
+            }
+        }
+        out << "]}";
+    }
+    out << "}" << setprecision(3);
+
+    if (countersEnabled_)
+    {
+        // Thread 0 is the main thread for the whole run, the others are the worker threads of the parallel loops
+        out << "," << endl
+            << "  \"threads\": [" << endl;
+        for (size_t t = 0; t < threadTotals_.size(); t++)
+        {
+            out << (t ? ",\n" : "") << "    {\"thread\": " << t << ", ";
+            writeCounters(out, threadTotals_[t], (double)runTimes_.size());
+            out << "}";
+        }
+        out << endl
+            << "  ]";
+    }
+
+    out << endl
+        << "}" << endl
+        << defaultfloat;
+    return out;
+}
+
+Profiler &profiler()
+{
+    static Profiler instance;
+    return instance;
+}
+
+const char *stageName(ProfileStage stage)
+{
+    static const char *names[STAGE_COUNT] = {
+        "exists", "decode", "upload", "blur", "reduce", "filter", "resize", "download", "quantize", "write"};
+    return stage >= 0 && stage < STAGE_COUNT ? names[stage] : "unknown";
+}
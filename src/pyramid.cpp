@@ -0,0 +1,154 @@
+/**
+ * @file
+ * @brief Image pyramid - Successive 2x reductions of a host image
+ * See pyramid.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "cpu_dispatch.h"
+#include "pyramid.h"
+
+using namespace std;
+
+int ImagePyramid::build(const npp::ImageCPU_8u_C1 &src, int minWidth)
+{
+    base_ = &src;
+    levelCount_ = 1;
+
+    // Next level must still be at least minWidth wide (and big enough to filter)
+    while (levelCount_ < PYRAMID_MAX_LEVELS)
+    {
+        const npp::ImageCPU_8u_C1 &last = level(levelCount_ - 1);
+        unsigned int width = last.width() / 2;
+        unsigned int height = last.height() / 2;
+        if ((int)width < max(minWidth, 3) || height < 3)
+        {
+            break;
+        }
+
+        npp::ImageCPU_8u_C1 next(width, height);
+        reduce2x(last, next);
+        levels_[levelCount_ - 1].swap(next);
+        levelCount_++;
+    }
+
+    return levelCount_;
+}
+
+int ImagePyramid::resize(NppiSize dstSize, npp::ImageCPU_8u_C1 &dst) const
+{
+    if (levelCount_ == 0)
+    {
+        return -1;
+    }
+
+    NppiSize srcSize = {(int)base_->width(), (int)base_->height()};
+    int l = pyramidLevel(srcSize, dstSize, levelCount_ - 1);
+    const npp::ImageCPU_8u_C1 &src = level(l);
+
+    if ((int)src.width() == dstSize.width && (int)src.height() == dstSize.height)
+    {
+        // Exact level, just copy
+        for (int y = 0; y < dstSize.height; y++)
+        {
+            copy(src.data(0, y), src.data(0, y) + dstSize.width, dst.data(0, y));
+        }
+        return l;
+    }
+
+    areaResize(src, dst);
+    return l;
+}
+
+int pyramidLevel(NppiSize srcSize, NppiSize dstSize, int maxLevel)
+{
+    int l = 0;
+    // Level l + 1 is the source halved (rounding down) l + 1 times
+    while (l < maxLevel && (srcSize.width >> (l + 1)) >= dstSize.width && (srcSize.height >> (l + 1)) >= dstSize.height)
+    {
+        l++;
+    }
+    return l;
+}
+
+void reduce2x(const npp::ImageCPU_8u_C1 &src, npp::ImageCPU_8u_C1 &dst)
+{
+    int width = (int)dst.width();
+    int height = (int)dst.height();
+    Reduce2xRowKernel reduce2xRow = hostKernels().reduce2xRow;
+
+    for (int y = 0; y < height; y++)
+    {
+        reduce2xRow(src.data(0, 2 * y), src.data(0, 2 * y + 1), width, dst.data(0, y));
+    }
+}
+
+/**
+ * @brief Area weights of a 1D resize
+ * @param srcLength Source length
+ * @param dstLength Destination length
+ * @param first First source pixel of each destination pixel
+ * @param weights Weights of the source pixels of each destination pixel, adding up to 1
+ */
+static void areaWeights(int srcLength, int dstLength, vector<int> &first, vector<vector<float>> &weights)
+{
+    double scale = (double)srcLength / dstLength;
+
+    first.resize(dstLength);
+    weights.resize(dstLength);
+    for (int i = 0; i < dstLength; i++)
+    {
+        double start = i * scale;
+        double end = min((double)srcLength, (i + 1) * scale);
+        int j0 = (int)floor(start);
+        int j1 = min(srcLength, (int)ceil(end));
+
+        first[i] = j0;
+        weights[i].clear();
+        for (int j = j0; j < j1; j++)
+        {
+            double overlap = min(end, (double)j + 1) - max(start, (double)j);
+            weights[i].push_back((float)(overlap / (end - start)));
+        }
+    }
+}
+
+void areaResize(const npp::ImageCPU_8u_C1 &src, npp::ImageCPU_8u_C1 &dst)
+{
+    vector<int> firstColumn, firstRow;
+    vector<vector<float>> columnWeights, rowWeights;
+    areaWeights((int)src.width(), (int)dst.width(), firstColumn, columnWeights);
+    areaWeights((int)src.height(), (int)dst.height(), firstRow, rowWeights);
+
+    // Vertical pass into one row, then horizontal pass
+    vector<float> row(src.width());
+    for (unsigned int y = 0; y < dst.height(); y++)
+    {
+        fill(row.begin(), row.end(), 0.0f);
+        for (size_t j = 0; j < rowWeights[y].size(); j++)
+        {
+            const Npp8u *s = src.data(0, firstRow[y] + (int)j);
+            float w = rowWeights[y][j];
+            for (unsigned int x = 0; x < src.width(); x++)
+            {
+                row[x] += w * s[x];
+            }
+        }
+
+        Npp8u *d = dst.data(0, y);
+        for (unsigned int x = 0; x < dst.width(); x++)
+        {
+            float sum = 0.0f;
+            for (size_t i = 0; i < columnWeights[x].size(); i++)
+            {
+                sum += columnWeights[x][i] * row[firstColumn[x] + i];
+            }
+            d[x] = (Npp8u)min(255.0f, max(0.0f, sum + 0.5f));
+        }
+    }
+}
@@ -0,0 +1,295 @@
+/**
+ * @file
+ * @brief Render context - Library API of the ASCII art renderer
+ * See render_context.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <iostream>
+
+#include <Exceptions.h>
+#include <cuda_runtime.h>
+
+#include "profiler.h"
+#include "render_context.h"
+
+using namespace std;
+
+/**
+ * @brief Makes a host image of a size, keeping it if it already has that size
+ */
+static void sizeImage(npp::ImageCPU_8u_C1 &image, NppiSize size)
+{
+    if ((int)image.width() != size.width || (int)image.height() != size.height)
+    {
+        npp::ImageCPU_8u_C1 oImage(size.width, size.height);
+        image.swap(oImage);
+    }
+}
+
+/**
+ * @brief Makes a device image of a size, keeping it if it already has that size
+ */
+static void sizeImage(npp::ImageNPP_8u_C1 &image, NppiSize size)
+{
+    if ((int)image.width() != size.width || (int)image.height() != size.height)
+    {
+        npp::ImageNPP_8u_C1 oImage(size.width, size.height);
+        image.swap(oImage);
+    }
+}
+
+/**
+ * @brief Size of the image the ASCII art is quantized from: one pixel per character, or per Braille dot
+ */
+static NppiSize artSizeOf(NppiSize srcSize, const RenderSettings &settings)
+{
+    int columns = settings.mode == MODE_BRAILLE ? settings.columns * BRAILLE_CELL_WIDTH : settings.columns;
+    return asciiArtSize(srcSize, {srcSize.width - 2, srcSize.height - 2}, columns);
+}
+
+/**
+ * @brief Characters of the ASCII art of an image of a size
+ */
+static NppiSize cellSize(NppiSize artSize, const RenderSettings &settings)
+{
+    return settings.mode == MODE_BRAILLE ? brailleCellSize(artSize) : artSize;
+}
+
+/**
+ * @brief Pattern of the glyphs
+ */
+static const char *patternOf(const RenderSettings &settings)
+{
+    return settings.mode == MODE_BRAILLE ? braillePattern().c_str() : settings.asciiPattern;
+}
+
+RenderContext::RenderContext(RenderBackend backend, int threads)
+    : backend_(backend), valid_(true), nppStreamCtx_(), deviceKernels_(nullptr), pool_(threads),
+      areaTables_()
+{
+    if (backend_ != BACKEND_NPP)
+    {
+        return;
+    }
+
+    if (getStreamContext(nppStreamCtx_) != NPP_SUCCESS)
+    {
+        cerr << "Unable to get NPP stream context" << endl;
+        valid_ = false;
+        return;
+    }
+
+    // Kernels of every filter, uploaded once
+    size_t kernelBytes = sizeof(filterKernels);
+    if (cudaMalloc((void **)&deviceKernels_, kernelBytes) != cudaSuccess)
+    {
+        cerr << "Unable to allocate the filter kernels on the device" << endl;
+        deviceKernels_ = nullptr;
+        valid_ = false;
+        return;
+    }
+    npp::allocated(npp::ALLOCATION_DEVICE, deviceKernels_, kernelBytes);
+    cudaMemcpy(deviceKernels_, filterKernels, kernelBytes, cudaMemcpyHostToDevice);
+}
+
+RenderContext::~RenderContext()
+{
+    if (deviceKernels_ != nullptr)
+    {
+        npp::freed(npp::ALLOCATION_DEVICE, deviceKernels_);
+        cudaFree(deviceKernels_);
+    }
+}
+
+size_t RenderContext::outputSize(NppiSize srcSize, const RenderSettings &settings)
+{
+    // Half blocks are colors only, a grey image has none
+    if (srcSize.width < 3 || srcSize.height < 3 || settings.mode == MODE_HALFBLOCK)
+    {
+        return 0;
+    }
+
+    GlyphTable table;
+    glyphTable(patternOf(settings), table);
+    NppiSize artSize = cellSize(artSizeOf(srcSize, settings), settings);
+    return (size_t)artSize.height * ((size_t)artSize.width * table.maxLength + 1);
+}
+
+size_t RenderContext::render(const ImageView &image, const RenderSettings &settings, char *out, size_t capacity)
+{
+    NppiSize srcSize = {image.width, image.height};
+    size_t size = outputSize(srcSize, settings);
+    if (!valid_ || image.data == nullptr || size == 0 || size > capacity)
+    {
+        return 0;
+    }
+
+    // The host cubic resize is not verified against NPP
+    if (backend_ == BACKEND_HOST && settings.sampling != SAMPLING_AREA)
+    {
+        cerr << "The host backend has no cubic resize verified against NPP, use SAMPLING_AREA" << endl;
+        return 0;
+    }
+
+    lock_guard<mutex> lock(mutex_);
+    // Host stages of this render run on the pool
+    ThreadPoolScope scope(pool_);
+
+    NppiSize artSize = artSizeOf(srcSize, settings);
+    const npp::ImageCPU_8u_C1 *art = &hostResized_;
+
+    try
+    {
+        bool result = backend_ == BACKEND_NPP ? renderDevice(image, settings, artSize)
+                                              : renderHost(image, settings, artSize, art);
+        if (!result)
+        {
+            return 0;
+        }
+    }
+    catch (npp::Exception &ex)
+    {
+        cerr << ex.message() << endl;
+        return 0;
+    }
+
+    ProfileScope profile(STAGE_QUANTIZE);
+    if (settings.mode == MODE_BRAILLE)
+    {
+        Npp8u thresholds[16];
+        brailleThresholds(settings.threshold, thresholds);
+        brailleCells(*art, thresholds, hostCells_, brailleBlank_);
+        art = &hostCells_;
+        artSize = cellSize(artSize, settings);
+    }
+    GlyphTable table;
+    glyphTable(patternOf(settings), table);
+
+    // One line per row, straight into the caller buffer
+    size = asciiArtOffsets(art->data(), art->pitch(), artSize, table, offsets_, chunkBytes_);
+    quantizeAsciiArt(art->data(), art->pitch(), artSize, table, offsets_, out);
+    profile.count((double)artSize.width * artSize.height + size, (double)artSize.width * artSize.height);
+
+    return size;
+}
+
+future<size_t> RenderContext::renderAsync(const ImageView &image, const RenderSettings &settings, char *out,
+                                          size_t capacity)
+{
+    return async(launch::async, [this, image, settings, out, capacity]() {
+        return render(image, settings, out, capacity);
+    });
+}
+
+bool RenderContext::renderDevice(const ImageView &image, const RenderSettings &settings, NppiSize artSize)
+{
+    NppiSize srcSize = {image.width, image.height};
+    NppiSize filteredSize = {srcSize.width - 2, srcSize.height - 2};
+
+    double srcPixels = (double)srcSize.width * srcSize.height;
+    double filteredPixels = (double)filteredSize.width * filteredSize.height;
+    double artPixels = (double)artSize.width * artSize.height;
+
+    {
+        ProfileScope scope(STAGE_UPLOAD, srcPixels, srcPixels, true);
+        sizeImage(deviceSrc_, srcSize);
+        deviceSrc_.copyFrom(const_cast<Npp8u *>(image.data), image.pitch);
+    }
+
+    // Same filter as applyConvolutionFilter(), kernel already on the device
+    sizeImage(deviceFiltered_, filteredSize);
+    NppStatus nppStatus;
+    {
+        ProfileScope scope(STAGE_FILTER, srcPixels + filteredPixels, filteredPixels, true);
+        nppStatus = nppiFilter_8u_C1R_Ctx(deviceSrc_.data(2, 2), deviceSrc_.pitch(), deviceFiltered_.data(),
+                                          deviceFiltered_.pitch(), filteredSize,
+                                          deviceKernels_ + 9 * effectiveFilter(settings.filter), {3, 3}, {2, 2}, 1,
+                                          nppStreamCtx_);
+    }
+    if (nppStatus != NPP_NO_ERROR)
+    {
+        cerr << "Error filtering image" << endl;
+        return false;
+    }
+
+    sizeImage(hostResized_, artSize);
+
+    if (artSize.width == filteredSize.width && artSize.height == filteredSize.height)
+    {
+        ProfileScope scope(STAGE_DOWNLOAD, artPixels, artPixels, true);
+        deviceFiltered_.copyTo(hostResized_.data(), hostResized_.pitch());
+        return true;
+    }
+
+    if (settings.sampling == SAMPLING_AREA)
+    {
+        {
+            ProfileScope scope(STAGE_DOWNLOAD, filteredPixels, filteredPixels, true);
+            sizeImage(hostFiltered_, filteredSize);
+            deviceFiltered_.copyTo(hostFiltered_.data(), hostFiltered_.pitch());
+        }
+        ProfileScope scope(STAGE_RESIZE, filteredPixels * 5 + artPixels * 17, artPixels);
+        integral_.build(hostFiltered_);
+        areaSample(integral_, hostResized_, areaTables_);
+        return true;
+    }
+
+    // Same resize as resizeDeviceImage(), into the reused image
+    sizeImage(deviceResized_, artSize);
+    {
+        ProfileScope scope(STAGE_RESIZE, filteredPixels + artPixels, artPixels, true);
+        nppStatus = nppiResize_8u_C1R_Ctx(deviceFiltered_.data(), deviceFiltered_.pitch(), filteredSize,
+                                          {0, 0, filteredSize.width, filteredSize.height}, deviceResized_.data(),
+                                          deviceResized_.pitch(), artSize, {0, 0, artSize.width, artSize.height},
+                                          NPPI_INTER_CUBIC, nppStreamCtx_);
+    }
+    if (nppStatus != NPP_NO_ERROR)
+    {
+        cerr << "Error resizing image" << endl;
+        return false;
+    }
+
+    ProfileScope scope(STAGE_DOWNLOAD, artPixels, artPixels, true);
+    deviceResized_.copyTo(hostResized_.data(), hostResized_.pitch());
+    return true;
+}
+
+bool RenderContext::renderHost(const ImageView &image, const RenderSettings &settings, NppiSize artSize,
+                               const npp::ImageCPU_8u_C1 *&result)
+{
+    NppiSize srcSize = {image.width, image.height};
+    NppiSize filteredSize = {srcSize.width - 2, srcSize.height - 2};
+
+    double srcPixels = (double)srcSize.width * srcSize.height;
+    double filteredPixels = (double)filteredSize.width * filteredSize.height;
+    double artPixels = (double)artSize.width * artSize.height;
+
+    sizeImage(hostFiltered_, filteredSize);
+    NppStatus nppStatus;
+    {
+        ProfileScope scope(STAGE_FILTER, srcPixels + filteredPixels, filteredPixels);
+        nppStatus = convolutionFilter(image.data, image.pitch, srcSize, hostFiltered_.data(), hostFiltered_.pitch(),
+                                      filterKernels[effectiveFilter(settings.filter)], {3, 3}, 1);
+    }
+    if (nppStatus != NPP_NO_ERROR)
+    {
+        cerr << "Error filtering image" << endl;
+        return false;
+    }
+
+    if (artSize.width == filteredSize.width && artSize.height == filteredSize.height)
+    {
+        result = &hostFiltered_;
+        return true;
+    }
+
+    sizeImage(hostResized_, artSize);
+    result = &hostResized_;
+
+    ProfileScope scope(STAGE_RESIZE, filteredPixels * 5 + artPixels * 17, artPixels);
+    integral_.build(hostFiltered_);
+    areaSample(integral_, hostResized_, areaTables_);
+    return true;
+}
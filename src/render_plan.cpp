@@ -0,0 +1,1259 @@
+/**
+ * @file
+ * @brief Render plan - Builds several ASCII art outputs from a single image
+ * See render_plan.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem> // Requires c++ 17
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ImagesCPU.h>
+#include <ImagesNPP.h>
+#include <cuda_runtime.h>
+
+#include "ascii_art.h"
+#include "color_image.h"
+#include "cpu_dispatch.h"
+#include "host_npp.h"
+#include "integral_image.h"
+#include "multi_filter.h"
+#include "profiler.h"
+#include "pyramid.h"
+#include "render_plan.h"
+#include "row_stream.h"
+#include "synthetic.h"
+#include "trace.h"
+#include "tuning.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+/**
+ * @brief Replaces every occurrence of a placeholder on a string
+ * @param str String to update
+ * @param placeholder Text to replace
+ * @param value Replacement
+ */
+static void replaceAll(string &str, const string &placeholder, const string &value)
+{
+    size_t pos = 0;
+    while ((pos = str.find(placeholder, pos)) != string::npos)
+    {
+        str.replace(pos, placeholder.length(), value);
+        pos += value.length();
+    }
+}
+
+RenderPlan::RenderPlan(const string &imagePath,
+                       const vector<RenderRequest> &requests,
+                       NppiSize srcSize,
+                       const RenderOptions &options) : imagePath_(imagePath), srcSize_(srcSize), options_(options)
+{
+    // Node 0: decode (and upload) the image, shared by every request
+    PlanNode decode;
+    decode.type = PLAN_DECODE;
+    decode.parent = -1;
+    decode.filter = -1;
+    decode.columns = 0;
+    decode.request = -1;
+    nodes_.push_back(decode);
+
+    // Number of distinct filters, for the cost model
+    vector<int> filters;
+    for (const RenderRequest &request : requests)
+    {
+        if (find(filters.begin(), filters.end(), effectiveFilter(request.filter)) == filters.end())
+        {
+            filters.push_back(effectiveFilter(request.filter));
+        }
+    }
+
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        const RenderRequest &request = requests[i];
+
+        // Braille: the image is resized to 2 dots per character, quantized with the Braille glyphs
+        int columns = request.columns;
+        PlanNode node;
+        node.filter = effectiveFilter(request.filter);
+        node.asciiPattern = request.asciiPattern;
+        if (options.mode == MODE_BRAILLE)
+        {
+            columns *= BRAILLE_CELL_WIDTH;
+            node.asciiPattern = braillePattern();
+        }
+        node.request = (int)i;
+        node.outputPath = request.outputPath;
+
+        // Reduce before filtering when the order (or the cost model) says so
+        node.type = PLAN_REDUCE;
+        node.columns = 0;
+        if (renderOrder(srcSize, columns, (int)filters.size(), options.order) == ORDER_RESIZE_FIRST)
+        {
+            node.columns = reducedWidth(srcSize, columns);
+        }
+        int reduceNode = child(0, node);
+
+        node.columns = columns < 0 ? -columns : columns;
+
+        node.type = PLAN_FILTER;
+        int filterNode = child(reduceNode, node);
+
+        node.type = PLAN_RESIZE;
+        int resizeNode = child(filterNode, node);
+
+        node.type = PLAN_QUANTIZE;
+        int quantizeNode = child(resizeNode, node);
+
+        // Every request gets its own write node, even if two requests name the same file
+        node.type = PLAN_WRITE;
+        node.parent = quantizeNode;
+        nodes_.push_back(node);
+        nodes_[quantizeNode].children.push_back((int)nodes_.size() - 1);
+    }
+}
+
+int RenderPlan::child(int parent, const PlanNode &node)
+{
+    for (int c : nodes_[parent].children)
+    {
+        const PlanNode &candidate = nodes_[c];
+        if (candidate.type != node.type)
+        {
+            continue;
+        }
+        if ((node.type == PLAN_REDUCE && candidate.columns == node.columns) ||
+            (node.type == PLAN_FILTER && candidate.filter == node.filter) ||
+            (node.type == PLAN_RESIZE && candidate.columns == node.columns) ||
+            (node.type == PLAN_QUANTIZE && candidate.asciiPattern == node.asciiPattern))
+        {
+            return c;
+        }
+    }
+
+    // Not found, create a new node
+    PlanNode newNode = node;
+    newNode.parent = parent;
+    newNode.children.clear();
+    nodes_.push_back(newNode);
+    nodes_[parent].children.push_back((int)nodes_.size() - 1);
+    return (int)nodes_.size() - 1;
+}
+
+vector<RenderRequest> RenderPlan::matrix(const vector<int> &widths,
+                                         const vector<int> &filters,
+                                         const vector<string> &patterns,
+                                         const string &outputTemplate)
+{
+    vector<RenderRequest> requests;
+
+    for (size_t p = 0; p < patterns.size(); p++)
+    {
+        for (int filter : filters)
+        {
+            for (int width : widths)
+            {
+                string outputPath = outputTemplate;
+                replaceAll(outputPath, "{w}", width == 0 ? string("full") : to_string(abs(width)));
+                replaceAll(outputPath, "{filter}", filter < 0 ? string("default") : string(filterName(filter)));
+                replaceAll(outputPath, "{f}", to_string(filter));
+                replaceAll(outputPath, "{p}", to_string(p));
+                requests.push_back({width, filter, patterns[p], outputPath});
+            }
+        }
+    }
+
+    return requests;
+}
+
+int RenderPlan::outputCount(int node) const
+{
+    if (nodes_[node].type == PLAN_WRITE)
+    {
+        return 1;
+    }
+
+    int count = 0;
+    for (int c : nodes_[node].children)
+    {
+        count += outputCount(c);
+    }
+    return count;
+}
+
+ostream &RenderPlan::print(ostream &out) const
+{
+    int counts[PLAN_WRITE + 1] = {0};
+    for (const PlanNode &node : nodes_)
+    {
+        // The full resolution node does no work
+        counts[node.type] += node.type != PLAN_REDUCE || node.columns ? 1 : 0;
+    }
+    int outputs = counts[PLAN_WRITE];
+
+    out << "Render plan for " << imagePath_ << ": " << outputs << " outputs" << endl
+        << "  work: " << counts[PLAN_DECODE] << " decode (" << outputs << " requested), "
+        << counts[PLAN_REDUCE] << " reductions, "
+        << counts[PLAN_FILTER] << " filters (" << outputs << " requested), "
+        << counts[PLAN_RESIZE] << " resizes (" << outputs << " requested), "
+        << counts[PLAN_QUANTIZE] << " quantizes (" << outputs << " requested)" << endl;
+    const HostKernels &kernels = hostKernels();
+    out << "  host kernels: filter3x3 " << cpuLevelName(kernels.filter3x3Level)
+        << ", reduce2x " << cpuLevelName(kernels.reduce2xLevel)
+        << ", cubic " << cpuLevelName(kernels.cubicColumnLevel)
+        << ", quantize " << cpuLevelName(kernels.quantizeLevel)
+        << ", glyph " << cpuLevelName(kernels.glyphLevel)
+        << ", braille " << cpuLevelName(kernels.brailleLevel)
+        << ", luma " << cpuLevelName(kernels.lumaLevel)
+        << ", planes " << cpuLevelName(kernels.planesLevel)
+        << " (cpu: " << cpuLevelName(detectedCpuLevel()) << ")" << endl;
+    // Cost model decisions, one for each distinct width
+    if (srcSize_.width > 0 && options_.order != ORDER_FILTER_FIRST)
+    {
+        vector<int> filters;
+        vector<int> widths;
+        for (const PlanNode &node : nodes_)
+        {
+            if (node.type == PLAN_FILTER && find(filters.begin(), filters.end(), node.filter) == filters.end())
+            {
+                filters.push_back(node.filter);
+            }
+            if (node.type == PLAN_RESIZE && find(widths.begin(), widths.end(), node.columns) == widths.end())
+            {
+                widths.push_back(node.columns);
+            }
+        }
+        for (int width : widths)
+        {
+            RenderOrder order = renderOrder(srcSize_, width, (int)filters.size(), options_.order);
+            out << "  order for " << (width == 0 ? string("full width") : to_string(width) + " columns") << ": "
+                << (order == ORDER_RESIZE_FIRST ? "resize first" : "filter first") << fixed << setprecision(2)
+                << " (estimated cost " << renderCost(srcSize_, width, (int)filters.size(), ORDER_FILTER_FIRST) / 1e6 << " Mop filter first";
+            if (reducedWidth(srcSize_, width))
+            {
+                out << ", " << renderCost(srcSize_, width, (int)filters.size(), ORDER_RESIZE_FIRST) / 1e6 << " Mop resize first";
+            }
+            out << ")" << defaultfloat << endl;
+        }
+    }
+
+    // Depth first, children indented below their parent
+    vector<pair<int, int>> stack = {{0, 1}};
+    while (!stack.empty())
+    {
+        int n = stack.back().first;
+        int depth = stack.back().second;
+        stack.pop_back();
+
+        const PlanNode &node = nodes_[n];
+        out << string(depth * 2, ' ') << "#" << n << " ";
+        switch (node.type)
+        {
+        case PLAN_DECODE:
+            out << "decode " << imagePath_;
+            if (options_.backend == BACKEND_HOST)
+            {
+                out << " (host backend, no CUDA device)";
+            }
+            if (options_.color != COLOR_NONE)
+            {
+                out << ", RGB to luma (" << (lumaStandard() == LUMA_BT709 ? "BT.709" : "BT.601")
+                    << ") and planes while decoding, one integral image per plane";
+            }
+            if (options_.blurRadius > 0)
+            {
+                out << ", box blur radius " << options_.blurRadius << " (integral image)";
+            }
+            break;
+        case PLAN_REDUCE:
+            if (node.columns)
+            {
+                out << "reduce to " << node.columns << " columns (pyramid level "
+                    << pyramidLevel(srcSize_, reducedSize(srcSize_, node.columns)) << " + area average)";
+            }
+            else
+            {
+                out << "full resolution";
+            }
+            if (node.children.size() > 1)
+            {
+                out << ", " << node.children.size() << " filters in a single pass";
+            }
+            break;
+        case PLAN_FILTER:
+            out << "filter " << node.filter << " (" << filterName(node.filter) << ")";
+            break;
+        case PLAN_RESIZE:
+            out << (options_.sampling == SAMPLING_AREA ? "area sample to " : "resize to ")
+                << (node.columns == 0 ? string("full width") : to_string(node.columns) + " columns");
+            if (options_.sampling == SAMPLING_RESIZE && node.columns != 0)
+            {
+                // The pyramid only reduces before the filter, see README "Filter and resize order"
+                out << " (one cubic pass on the filtered image, --sampling=area to antialias)";
+            }
+            break;
+        case PLAN_QUANTIZE:
+            if (options_.mode == MODE_BRAILLE)
+            {
+                out << "quantize to Braille dots, ";
+                if (options_.threshold > 0)
+                {
+                    out << "threshold " << options_.threshold;
+                }
+                else
+                {
+                    out << "dithered";
+                }
+            }
+            else
+            {
+                out << "quantize with pattern \"" << node.asciiPattern << "\"";
+            }
+            if (options_.color != COLOR_NONE)
+            {
+                out << ", " << (options_.color == COLOR_256 ? "256 colors" : "24-bit colors") << " (area sampled)";
+            }
+            if (options_.format == FORMAT_HTML)
+            {
+                out << ", HTML" << (options_.color != COLOR_NONE ? " (one span per run of a color)" : "");
+            }
+            break;
+        case PLAN_WRITE:
+            out << "write " << (node.outputPath == "-" ? string("<stdout>") : node.outputPath.empty() ? string("<memory>") : node.outputPath);
+            break;
+        }
+        int shared = outputCount(n);
+        if (node.type != PLAN_WRITE && shared > 1)
+        {
+            out << " [shared by " << shared << " outputs]";
+        }
+        out << endl;
+
+        for (auto c = node.children.rbegin(); c != node.children.rend(); ++c)
+        {
+            stack.push_back({*c, depth + 1});
+        }
+    }
+    return out;
+}
+
+/**
+ * @brief Sends the ASCII art to its destination
+ * @param art ASCII art
+ * @param length Length of the ASCII art
+ * @param outputPath Output path, "-" = standard output
+ * @return true if successful, false otherwise
+ */
+static bool writeAsciiArt(const char *art, size_t length, const string &outputPath)
+{
+    profiler().addOutput((double)length);
+    if (outputPath == "-")
+    {
+        // Flushed, so the next program of a pipeline starts on it
+        cout.write(art, length).flush();
+        profiler().firstLine();
+        return true;
+    }
+
+    TRACE_SCOPE("io", "write file");
+    ofstream ofs(outputPath, ios::binary);
+    if (!ofs)
+    {
+        cerr << "Unable to open " << outputPath << " for writing" << endl;
+        return false;
+    }
+    ofs.write(art, length);
+    profiler().firstLine();
+    return (bool)ofs;
+}
+
+/**
+ * @brief Streams the ASCII art of an image to its destination, one band of rows at a time,
+ * or through an output map when it is large enough and the destination can be mapped
+ * @param img Host or device image
+ * @param asciiPattern ASCII pattern
+ * @param outputPath Output path, "-" = standard output
+ * @param format Text, or HTML without colors (always streamed)
+ * @return true if successful, false otherwise
+ */
+template <typename Image>
+static bool streamAsciiArt(Image &img, const string &asciiPattern, const string &outputPath, OutputFormat format)
+{
+    // Large text outputs are quantized in place into the mapped file, or a buffer spliced into the pipe
+    GlyphTable table;
+    glyphTable(asciiPattern.c_str(), table);
+    vector<size_t> offsets;
+    size_t length = format == FORMAT_TEXT ? asciiArtLength(img, table, offsets) : 0;
+    OutputMap map;
+    bool mapped;
+    {
+        ProfileScope scope(STAGE_WRITE);
+        mapped = length >= OUTPUT_MAP_MIN_BYTES && map.open(outputPath, length);
+    }
+    if (mapped)
+    {
+        if (!mapAsciiArt(map, img, table, offsets))
+        {
+            return false;
+        }
+        profiler().addOutput((double)length);
+        ProfileScope scope(STAGE_WRITE, (double)length, (double)length);
+        bool result = map.commit();
+        profiler().firstLine();
+        return result;
+    }
+
+    if (outputPath == "-")
+    {
+        return streamAsciiArt(cout, img, asciiPattern, format);
+    }
+
+    TRACE_SCOPE("io", "stream file");
+    ofstream ofs(outputPath, ios::binary);
+    if (!ofs)
+    {
+        cerr << "Unable to open " << outputPath << " for writing" << endl;
+        return false;
+    }
+    return streamAsciiArt(ofs, img, asciiPattern, format);
+}
+
+/**
+ * @brief Box blurs a host image, any radius costs the same
+ * @param img Image to blur, replaced by the blurred image
+ * @param radius Blur radius
+ */
+static void blurImage(npp::ImageCPU_8u_C1 &img, int radius)
+{
+    double pixels = (double)img.width() * img.height();
+    ProfileScope scope(STAGE_BLUR, 2 * pixels, pixels);
+    IntegralImage integral;
+    integral.build(img);
+
+    npp::ImageCPU_8u_C1 oHostBlurred(img.width(), img.height());
+    boxBlur(integral, radius, oHostBlurred);
+    img.swap(oHostBlurred);
+}
+
+/**
+ * @brief Reduces the source image to the width of a reduce node
+ * @param nodes Plan nodes
+ * @param reduceNode Reduce node
+ * @param src Source image on host
+ * @param pyramid Pyramid of the source, built down to the smallest reduction on first use
+ * @param reduced Destination image, sized by the caller
+ */
+static void reduceImage(const vector<PlanNode> &nodes, int reduceNode, const npp::ImageCPU_8u_C1 &src,
+                        ImagePyramid &pyramid, npp::ImageCPU_8u_C1 &reduced)
+{
+    double reducedPixels = (double)reduced.width() * reduced.height();
+    ProfileScope scope(STAGE_REDUCE);
+    double bytes = reducedPixels;
+
+    if (pyramid.levelCount() == 0)
+    {
+        int minColumns = nodes[reduceNode].columns;
+        for (int c : nodes[0].children)
+        {
+            minColumns = nodes[c].columns ? min(minColumns, nodes[c].columns) : minColumns;
+        }
+        pyramid.build(src, minColumns);
+        // Every level reads 4 pixels of the level above for each pixel it writes
+        bytes += (double)src.width() * src.height() * 5 / 3;
+    }
+
+    // Nearest larger level, then area average down to the reduced width, keeping the aspect ratio
+    int level = pyramid.resize({(int)reduced.width(), (int)reduced.height()}, reduced);
+    bytes += (double)pyramid.level(level).width() * pyramid.level(level).height();
+    scope.count(bytes, reducedPixels);
+}
+
+bool RenderPlan::execute(const NppStreamContext &nppStreamCtx)
+{
+    try
+    {
+        npp::ImageCPU_8u_C1 oHostSrc;
+        npp::ImageNPP_8u_C1 oDeviceSrc;
+        npp::ImageCPU_8u_C1 oHostPlanes[3];
+        bool colored = options_.color != COLOR_NONE;
+
+        // Load image into CPU and GPU instances, once for every request. Colors: the luma is filtered,
+        // the planes are kept for the colors.
+        if (!getCPUandDeviceImage(imagePath_, oHostSrc, oDeviceSrc, colored ? oHostPlanes : nullptr))
+        {
+            return false;
+        }
+
+        NppiSize oSrcSize = {(int)oHostSrc.width(), (int)oHostSrc.height()};
+        bool result = true;
+
+        if (colored)
+        {
+            // Every plane read once, 32 bit table written
+            double pixels = (double)oSrcSize.width * oSrcSize.height;
+            ProfileScope scope(STAGE_RESIZE, pixels * 15, pixels);
+            colors_.build(oHostPlanes);
+        }
+
+        // Host stages with the settings tuned for this image size, if any
+        applyTuning(activeTuning(), oSrcSize);
+
+        // Box blur on the host, any radius costs the same
+        if (options_.blurRadius > 0)
+        {
+            blurImage(oHostSrc, options_.blurRadius);
+
+            double pixels = (double)oSrcSize.width * oSrcSize.height;
+            ProfileScope scope(STAGE_UPLOAD, pixels, pixels, true);
+            npp::ImageNPP_8u_C1 oDeviceBlurred(oHostSrc);
+            oDeviceSrc.swap(oDeviceBlurred);
+        }
+
+        captured_.assign(outputCount(0), string());
+
+        // Every reduction is served from the same pyramid, built once down to the smallest one
+        ImagePyramid pyramid;
+
+        for (int r : nodes_[0].children)
+        {
+            const PlanNode &reduceNode = nodes_[r];
+
+            if (reduceNode.columns == 0)
+            {
+                // Filter at full resolution
+                result = executeFilters(r, oDeviceSrc, oSrcSize, nppStreamCtx) && result;
+                continue;
+            }
+
+            NppiSize oReducedSize = reducedSize(oSrcSize, reduceNode.columns);
+            double reducedPixels = (double)oReducedSize.width * oReducedSize.height;
+            npp::ImageCPU_8u_C1 oHostReduced(oReducedSize.width, oReducedSize.height);
+            reduceImage(nodes_, r, oHostSrc, pyramid, oHostReduced);
+
+            npp::ImageNPP_8u_C1 oDeviceReduced;
+            {
+                ProfileScope scope(STAGE_UPLOAD, reducedPixels, reducedPixels, true);
+                npp::ImageNPP_8u_C1 oDeviceUploaded(oHostReduced);
+                oDeviceReduced.swap(oDeviceUploaded);
+            }
+
+            result = executeFilters(r, oDeviceReduced, oSrcSize, nppStreamCtx) && result;
+        }
+
+        return result;
+    }
+    catch (npp::Exception &ex)
+    {
+        cerr << ex.message() << endl;
+        return false;
+    }
+}
+
+bool RenderPlan::executeFilters(int reduceNode, npp::ImageNPP_8u_C1 &src, NppiSize srcSize, const NppStreamContext &nppStreamCtx)
+{
+    bool result = true;
+
+    // Apply every filter. More than one: single pass over the source.
+    vector<int> filters;
+    for (int f : nodes_[reduceNode].children)
+    {
+        filters.push_back(nodes_[f].filter);
+    }
+
+    npp::ImageNPP_8u_C1 oDeviceFiltered[FILTER_COUNT];
+    NppStatus nppStatus;
+    {
+        // Source read once, one output plane for each filter
+        double pixels = (double)filters.size() * (src.width() - 2) * (src.height() - 2);
+        ProfileScope scope(STAGE_FILTER, (double)src.width() * src.height() + pixels, pixels, true);
+        if (filters.size() > 1)
+        {
+            nppStatus = multiFilter3x3(src, filters, oDeviceFiltered, nppStreamCtx);
+        }
+        else
+        {
+            nppStatus = filters.empty() ? NPP_NO_ERROR : applyConvolutionFilter(filters[0], src, oDeviceFiltered[0], nppStreamCtx);
+        }
+    }
+
+    if (nppStatus != NPP_NO_ERROR)
+    {
+        cerr << "Error applying filter" << endl;
+        return false;
+    }
+
+    for (size_t i = 0; i < filters.size(); i++)
+    {
+        result = executeResizes(nodes_[reduceNode].children[i], oDeviceFiltered[i], srcSize, nppStreamCtx) && result;
+    }
+
+    return result;
+}
+
+bool RenderPlan::executeResizes(int filterNode, npp::ImageNPP_8u_C1 &filtered, NppiSize srcSize, const NppStreamContext &nppStreamCtx)
+{
+    bool result = true;
+
+    // The ASCII art size only depends on the original image, not on the reduction
+    NppiSize oFullFilteredSize = {srcSize.width - 2, srcSize.height - 2};
+
+    npp::ImageNPP_8u_C1 oDeviceDst;
+    oDeviceDst.swap(filtered);
+
+    NppiSize oDstSize = {(int)oDeviceDst.width(), (int)oDeviceDst.height()};
+
+    // Area sampling: one integral image of the filtered image, shared by every width
+    IntegralImage integral;
+
+    for (int r : nodes_[filterNode].children)
+    {
+        const PlanNode &resizeNode = nodes_[r];
+
+        NppiSize oDstResizedSize = asciiArtSize(srcSize, oFullFilteredSize, resizeNode.columns);
+        double dstPixels = (double)oDstResizedSize.width * oDstResizedSize.height;
+        double srcPixels = (double)oDstSize.width * oDstSize.height;
+        bool resized = oDstResizedSize.width != oDstSize.width || oDstResizedSize.height != oDstSize.height;
+
+        // A single destination (not kept in memory) is streamed: download, quantize and write band by band
+        const PlanNode *streamed = streamedQuantize(r);
+
+        // The whole image on the host, unless streamed from the device. Braille dots are packed, and
+        // colors added, on the host. HTML without colors is streamed as text is.
+        bool braille = options_.mode == MODE_BRAILLE;
+        bool colored = options_.color != COLOR_NONE;
+        npp::ImageCPU_8u_C1 oHostResized;
+        if (!streamed || (resized && options_.sampling == SAMPLING_AREA) || braille || colored)
+        {
+            npp::ImageCPU_8u_C1 oHostImage(oDstResizedSize.width, oDstResizedSize.height);
+            oHostResized.swap(oHostImage);
+        }
+
+        if (!resized)
+        {
+            if (streamed && !braille && !colored)
+            {
+                result = streamAsciiArt(oDeviceDst, streamed->asciiPattern,
+                                        nodes_[streamed->children[0]].outputPath, options_.format) && result;
+                continue;
+            }
+
+            // Don't resize image, just copy to host
+            ProfileScope scope(STAGE_DOWNLOAD, dstPixels, dstPixels, true);
+            oDeviceDst.copyTo(oHostResized.data(), oHostResized.pitch());
+        }
+        else if (options_.sampling == SAMPLING_AREA)
+        {
+            if (integral.width() == 0)
+            {
+                npp::ImageCPU_8u_C1 oHostDst(oDstSize.width, oDstSize.height);
+                {
+                    ProfileScope scope(STAGE_DOWNLOAD, srcPixels, srcPixels, true);
+                    oDeviceDst.copyTo(oHostDst.data(), oHostDst.pitch());
+                }
+                // Source read once, 32 bit table written
+                ProfileScope scope(STAGE_RESIZE, srcPixels * 5, srcPixels);
+                integral.build(oHostDst);
+            }
+            // 4 lookups of 4 bytes for each character
+            ProfileScope scope(STAGE_RESIZE, dstPixels * 17, dstPixels);
+            areaSample(integral, oHostResized);
+        }
+        else
+        {
+            npp::ImageNPP_8u_C1 oDeviceDstResized;
+            NppStatus nppStatus;
+            {
+                ProfileScope scope(STAGE_RESIZE, srcPixels + dstPixels, dstPixels, true);
+                nppStatus = resizeDeviceImage(oDeviceDst, oDstResizedSize, oDeviceDstResized, nppStreamCtx);
+            }
+            if (nppStatus != NPP_NO_ERROR)
+            {
+                cerr << "Error resizing image" << endl;
+                result = false;
+                continue;
+            }
+            if (streamed && !braille && !colored)
+            {
+                result = streamAsciiArt(oDeviceDstResized, streamed->asciiPattern,
+                                        nodes_[streamed->children[0]].outputPath, options_.format) && result;
+                continue;
+            }
+            ProfileScope scope(STAGE_DOWNLOAD, dstPixels, dstPixels, true);
+            oDeviceDstResized.copyTo(oHostResized.data(), oHostResized.pitch());
+        }
+
+        result = writeResized(r, oHostResized) && result;
+    }
+
+    return result;
+}
+
+const PlanNode *RenderPlan::streamedQuantize(int resizeNode) const
+{
+    const PlanNode &node = nodes_[resizeNode];
+    if (node.children.size() == 1 && nodes_[node.children[0]].children.size() == 1 &&
+        !nodes_[nodes_[node.children[0]].children[0]].outputPath.empty())
+    {
+        return &nodes_[node.children[0]];
+    }
+    return nullptr;
+}
+
+bool RenderPlan::writeResized(int resizeNode, const npp::ImageCPU_8u_C1 &resized)
+{
+    bool result = true;
+    const PlanNode *streamed = streamedQuantize(resizeNode);
+    bool braille = options_.mode == MODE_BRAILLE;
+    bool colored = options_.color != COLOR_NONE;
+    bool html = options_.format == FORMAT_HTML;
+    double dstPixels = (double)resized.width() * resized.height();
+
+    // The resized image is not modified, the host backend may share it with the next resize node
+    const npp::ImageCPU_8u_C1 *art = &resized;
+    npp::ImageCPU_8u_C1 oHostCells;
+    if (braille)
+    {
+        ProfileScope scope(STAGE_QUANTIZE, dstPixels * 1.125, dstPixels);
+        Npp8u thresholds[16];
+        brailleThresholds(options_.threshold, thresholds);
+        brailleCells(resized, thresholds, oHostCells);
+        art = &oHostCells;
+        dstPixels = (double)oHostCells.width() * oHostCells.height();
+    }
+
+    // Mean color of every character
+    npp::ImageCPU_8u_C1 oCellColors[3];
+    if (colored)
+    {
+        ProfileScope scope(STAGE_RESIZE, dstPixels * 3 * 17, dstPixels);
+        colors_.sample({(int)art->width(), (int)art->height()}, oCellColors);
+    }
+
+    if (streamed && !colored)
+    {
+        // Area sampling or Braille cells, already on the host
+        return streamAsciiArt(*art, streamed->asciiPattern, nodes_[streamed->children[0]].outputPath,
+                              options_.format);
+    }
+
+    for (int q : nodes_[resizeNode].children)
+    {
+        const PlanNode &quantizeNode = nodes_[q];
+
+        // Create ASCII art and store it into oss, or colored (or HTML) rows encoded on host threads
+        string text;
+        {
+            ProfileScope scope(STAGE_QUANTIZE);
+            if (html)
+            {
+                OutputAssembler assembler;
+                htmlAsciiArt(*art, colored ? oCellColors : nullptr, quantizeNode.asciiPattern, options_.color,
+                             assembler, text);
+            }
+            else if (colored)
+            {
+                OutputAssembler assembler;
+                colorAsciiArt(*art, oCellColors, quantizeNode.asciiPattern, options_.color, assembler);
+                text.resize(assembler.size());
+                assembler.copyTo(&text[0]);
+            }
+            else
+            {
+                ostringstream oss;
+                outAsciiArt(oss, *art, quantizeNode.asciiPattern);
+                text = oss.str();
+            }
+            scope.count(dstPixels * (colored ? 4 : 1) + text.length(), dstPixels);
+        }
+
+        // Fan out to every requested destination
+        for (int w : quantizeNode.children)
+        {
+            if (nodes_[w].outputPath.empty())
+            {
+                profiler().addOutput((double)text.length());
+                captured_[nodes_[w].request] = text;
+                continue;
+            }
+            ProfileScope scope(STAGE_WRITE, (double)text.length(), (double)text.length());
+            result = writeAsciiArt(text.data(), text.length(), nodes_[w].outputPath) && result;
+        }
+    }
+
+    return result;
+}
+
+bool RenderPlan::executeHost()
+{
+    try
+    {
+        npp::ImageCPU_8u_C1 oHostSrc;
+        npp::ImageCPU_8u_C1 oHostPlanes[3];
+        bool colored = options_.color != COLOR_NONE;
+
+        // Load the image on the host only, once for every request
+        {
+            ProfileScope scope(STAGE_DECODE);
+            if (!loadHostImage(imagePath_, oHostSrc, colored ? oHostPlanes : nullptr))
+            {
+                return false;
+            }
+            double pixels = (double)oHostSrc.width() * oHostSrc.height();
+            double fileBytes = isSyntheticImage(imagePath_) ? 0 : (double)fs::file_size(imagePath_);
+            scope.count(fileBytes + pixels * (colored ? 4 : 1), pixels);
+        }
+
+        NppiSize oSrcSize = {(int)oHostSrc.width(), (int)oHostSrc.height()};
+        bool result = true;
+
+        if (colored)
+        {
+            double pixels = (double)oSrcSize.width * oSrcSize.height;
+            ProfileScope scope(STAGE_RESIZE, pixels * 15, pixels);
+            colors_.build(oHostPlanes);
+        }
+
+        applyTuning(activeTuning(), oSrcSize);
+
+        if (options_.blurRadius > 0)
+        {
+            blurImage(oHostSrc, options_.blurRadius);
+        }
+
+        captured_.assign(outputCount(0), string());
+
+        ImagePyramid pyramid;
+
+        for (int r : nodes_[0].children)
+        {
+            if (nodes_[r].columns == 0)
+            {
+                result = executeHostFilters(r, oHostSrc, oSrcSize) && result;
+                continue;
+            }
+
+            NppiSize oReducedSize = reducedSize(oSrcSize, nodes_[r].columns);
+            npp::ImageCPU_8u_C1 oHostReduced(oReducedSize.width, oReducedSize.height);
+            reduceImage(nodes_, r, oHostSrc, pyramid, oHostReduced);
+            result = executeHostFilters(r, oHostReduced, oSrcSize) && result;
+        }
+
+        return result;
+    }
+    catch (npp::Exception &ex)
+    {
+        cerr << ex.message() << endl;
+        return false;
+    }
+}
+
+bool RenderPlan::executeHostFilters(int reduceNode, const npp::ImageCPU_8u_C1 &src, NppiSize srcSize)
+{
+    bool result = true;
+
+    vector<int> filters;
+    for (int f : nodes_[reduceNode].children)
+    {
+        filters.push_back(nodes_[f].filter);
+    }
+
+    npp::ImageCPU_8u_C1 oHostFiltered[FILTER_COUNT];
+    NppStatus nppStatus;
+    {
+        double pixels = (double)filters.size() * (src.width() - 2) * (src.height() - 2);
+        ProfileScope scope(STAGE_FILTER, (double)src.width() * src.height() + pixels, pixels);
+        if (filters.size() > 1)
+        {
+            nppStatus = multiFilter3x3(src, filters, oHostFiltered);
+        }
+        else
+        {
+            nppStatus = filters.empty() ? NPP_NO_ERROR : applyConvolutionFilter(filters[0], src, oHostFiltered[0]);
+        }
+    }
+
+    if (nppStatus != NPP_NO_ERROR)
+    {
+        cerr << "Error applying filter" << endl;
+        return false;
+    }
+
+    for (size_t i = 0; i < filters.size(); i++)
+    {
+        result = executeHostResizes(nodes_[reduceNode].children[i], oHostFiltered[i], srcSize) && result;
+        // Released as soon as its widths are done
+        npp::ImageCPU_8u_C1 oHostReleased;
+        oHostFiltered[i].swap(oHostReleased);
+    }
+
+    return result;
+}
+
+bool RenderPlan::executeHostResizes(int filterNode, const npp::ImageCPU_8u_C1 &filtered, NppiSize srcSize)
+{
+    bool result = true;
+
+    // The ASCII art size only depends on the original image, not on the reduction
+    NppiSize oFullFilteredSize = {srcSize.width - 2, srcSize.height - 2};
+    double srcPixels = (double)filtered.width() * filtered.height();
+
+    // One integral image of the filtered image, shared by every width
+    IntegralImage integral;
+
+    for (int r : nodes_[filterNode].children)
+    {
+        NppiSize oDstResizedSize = asciiArtSize(srcSize, oFullFilteredSize, nodes_[r].columns);
+        double dstPixels = (double)oDstResizedSize.width * oDstResizedSize.height;
+
+        if (oDstResizedSize.width == (int)filtered.width() && oDstResizedSize.height == (int)filtered.height())
+        {
+            result = writeResized(r, filtered) && result;
+            continue;
+        }
+
+        // The host backend has area sampling only, see README "Host filter and resize"
+        if (integral.width() == 0)
+        {
+            ProfileScope scope(STAGE_RESIZE, srcPixels * 5, srcPixels);
+            integral.build(filtered);
+        }
+        npp::ImageCPU_8u_C1 oHostResized(oDstResizedSize.width, oDstResizedSize.height);
+        {
+            ProfileScope scope(STAGE_RESIZE, dstPixels * 17, dstPixels);
+            areaSample(integral, oHostResized);
+        }
+        result = writeResized(r, oHostResized) && result;
+    }
+
+    return result;
+}
+
+int reducedWidth(NppiSize srcSize, int outColumns)
+{
+    outColumns = abs(outColumns);
+
+    if (srcSize.width <= 0 || outColumns == 0 || outColumns >= srcSize.width)
+    {
+        return 0;
+    }
+
+    int width = outColumns * RESIZE_FIRST_OVERSAMPLING;
+
+    // Not worth it (and not enough detail left) below a 2x reduction
+    if (width * 2 > srcSize.width)
+    {
+        return 0;
+    }
+    return width;
+}
+
+NppiSize reducedSize(NppiSize srcSize, int reducedColumns)
+{
+    return {reducedColumns, max(3, (int)lround((double)srcSize.height * reducedColumns / srcSize.width))};
+}
+
+double renderCost(NppiSize srcSize, int outColumns, int filterCount, RenderOrder order)
+{
+    NppiSize filteredSize = {srcSize.width - 2, srcSize.height - 2};
+    NppiSize dstSize = asciiArtSize(srcSize, filteredSize, outColumns);
+    double srcPixels = (double)srcSize.width * srcSize.height;
+    double dstPixels = (double)dstSize.width * dstSize.height;
+
+    int width = reducedWidth(srcSize, outColumns);
+    if (order == ORDER_FILTER_FIRST || width == 0)
+    {
+        return filterCount * (9.0 * srcPixels + 16.0 * dstPixels);
+    }
+
+    double reducedPixels = (double)width * ((double)srcSize.height * width / srcSize.width);
+    return srcPixels + filterCount * (9.0 * reducedPixels + 16.0 * dstPixels);
+}
+
+RenderOrder renderOrder(NppiSize srcSize, int outColumns, int filterCount, RenderOrder order)
+{
+    if (srcSize.width <= 0 || reducedWidth(srcSize, outColumns) == 0)
+    {
+        return ORDER_FILTER_FIRST;
+    }
+
+    if (order != ORDER_AUTO)
+    {
+        return order;
+    }
+
+    return renderCost(srcSize, outColumns, filterCount, ORDER_RESIZE_FIRST) < renderCost(srcSize, outColumns, filterCount, ORDER_FILTER_FIRST)
+               ? ORDER_RESIZE_FIRST
+               : ORDER_FILTER_FIRST;
+}
+
+/**
+ * @brief NPP stream context of the null stream, set up on first use only. Creates the CUDA context.
+ * @param nppStreamCtx Reference to the stream context
+ * @return true if successful, false otherwise
+ */
+static bool defaultStreamContext(NppStreamContext &nppStreamCtx)
+{
+    static NppStreamContext context;
+    static NppStatus status = [] {
+        StartupScope scope("cuda_context");
+        NppStatus nppStatus = getStreamContext(context);
+        // The first runtime call creates the context, charge it here rather than to the first upload
+        cudaFree(0);
+        return nppStatus;
+    }();
+
+    nppStreamCtx = context;
+    return status == NPP_SUCCESS;
+}
+
+/**
+ * @brief Renders every request in half blocks on the host: the image is not filtered,
+ * its colors are area sampled to two pixels per character
+ */
+static bool renderHalfBlocks(const string &imagePath, const vector<RenderRequest> &requests,
+                             const RenderOptions &options)
+{
+    npp::ImageCPU_8u_C1 oHostSrc;
+    npp::ImageCPU_8u_C1 oHostPlanes[3];
+    double pixels;
+    {
+        ProfileScope scope(STAGE_DECODE);
+        if (!loadHostImage(imagePath, oHostSrc, oHostPlanes))
+        {
+            return false;
+        }
+        pixels = (double)oHostSrc.width() * oHostSrc.height();
+        double fileBytes = isSyntheticImage(imagePath) ? 0 : (double)fs::file_size(imagePath);
+        scope.count(fileBytes + 4 * pixels, pixels);
+    }
+
+    NppiSize oSrcSize = {(int)oHostSrc.width(), (int)oHostSrc.height()};
+    ColorPlanes colors;
+    {
+        ProfileScope scope(STAGE_RESIZE, pixels * 15, pixels);
+        colors.build(oHostPlanes);
+    }
+
+    // Half blocks are colors only, 24-bit unless 256 colors are requested
+    ColorMode color = options.color == COLOR_NONE ? COLOR_TRUECOLOR : options.color;
+    OutputAssembler assembler;
+    string art;
+    bool result = true;
+
+    for (const RenderRequest &request : requests)
+    {
+        // Same width as a text render, an even number of pixel rows
+        NppiSize oArtSize = asciiArtSize(oSrcSize, oSrcSize, request.columns);
+        oArtSize.height += oArtSize.height % 2;
+        double artPixels = (double)oArtSize.width * oArtSize.height;
+
+        npp::ImageCPU_8u_C1 oCellColors[3];
+        {
+            ProfileScope scope(STAGE_RESIZE, artPixels * 3 * 17, artPixels);
+            colors.sample(oArtSize, oCellColors);
+        }
+
+        {
+            ProfileScope scope(STAGE_QUANTIZE);
+            if (options.format == FORMAT_HTML)
+            {
+                htmlHalfBlockArt(oCellColors, color, assembler, art);
+            }
+            else
+            {
+                halfBlockArt(oCellColors, color, assembler);
+                art.resize(assembler.size());
+                assembler.copyTo(&art[0]);
+            }
+            scope.count(artPixels * 3 + art.size(), artPixels / 2);
+        }
+
+        if (!request.outputPath.empty())
+        {
+            ProfileScope scope(STAGE_WRITE, (double)art.size(), (double)art.size());
+            result = writeAsciiArt(art.data(), art.size(), request.outputPath) && result;
+        }
+    }
+
+    return result;
+}
+
+bool renderASCIIArt(const string &imagePath, const vector<RenderRequest> &requests, const RenderOptions &options)
+{
+    fs::path srcPath(imagePath);
+    bool exists;
+    {
+        ProfileScope scope(STAGE_EXISTS);
+        exists = isSyntheticImage(imagePath) || fs::exists(srcPath);
+    }
+
+    if (!exists)
+    {
+        cerr << "Image " << imagePath << " does not exist or is not accessible" << endl;
+        return false;
+    }
+
+    if (options.mode == MODE_HALFBLOCK)
+    {
+        return renderHalfBlocks(imagePath, requests, options);
+    }
+
+    if (options.backend == BACKEND_HOST && options.sampling != SAMPLING_AREA)
+    {
+        cerr << "The host backend has no cubic resize verified against NPP, use area sampling" << endl;
+        return false;
+    }
+
+    // The cost model needs the image size, read from the header
+    NppiSize srcSize = {0, 0};
+    if (options.order != ORDER_FILTER_FIRST)
+    {
+        StartupScope scope("image_header");
+        if (!getImageSize(imagePath, srcSize))
+        {
+            cerr << "Unable to read the size of " << imagePath << ", filtering first" << endl;
+        }
+    }
+
+    RenderPlan plan(imagePath, requests, srcSize, options);
+
+    if (options.printPlan)
+    {
+        plan.print(cerr);
+    }
+
+    // Same plan on the host, no CUDA context created
+    if (options.backend == BACKEND_HOST)
+    {
+        return plan.executeHost();
+    }
+
+    NppStreamContext nppStreamCtx;
+
+    // Get stream context, once
+    if (!defaultStreamContext(nppStreamCtx))
+    {
+        cerr << "Unable to get NPP stream context";
+        return false;
+    }
+
+    return plan.execute(nppStreamCtx);
+}
+
+/**
+ * @brief Characters of a UTF-8 line, the bytes that do not continue a sequence
+ */
+static size_t displayWidth(const string &line)
+{
+    size_t width = 0;
+    for (char c : line)
+    {
+        width += ((unsigned char)c & 0xC0) != 0x80;
+    }
+    return width;
+}
+
+/**
+ * @brief Pads a UTF-8 line with spaces to a number of characters
+ */
+static string padLine(const string &line, size_t width)
+{
+    size_t lineWidth = displayWidth(line);
+    return lineWidth < width ? line + string(width - lineWidth, ' ') : line;
+}
+
+bool previewASCIIArt(ostream &out, const string &imagePath, int columns, const string &asciiPattern,
+                     RenderBackend backend)
+{
+    vector<int> filters;
+    for (int f = 0; f < FILTER_COUNT; f++)
+    {
+        filters.push_back(f);
+    }
+
+    // Keep every ASCII art in memory
+    vector<RenderRequest> requests = RenderPlan::matrix({columns}, filters, {asciiPattern}, "");
+
+    fs::path srcPath(imagePath);
+
+    if (!isSyntheticImage(imagePath) && !fs::exists(srcPath))
+    {
+        cerr << "Image " << imagePath << " does not exist or is not accessible" << endl;
+        return false;
+    }
+
+    // The host backend has area sampling only
+    RenderOptions options = {false, ORDER_FILTER_FIRST, backend == BACKEND_HOST ? SAMPLING_AREA : SAMPLING_RESIZE, 0,
+                             backend, MODE_TEXT, BRAILLE_THRESHOLD, COLOR_NONE, FORMAT_TEXT};
+    RenderPlan plan(imagePath, requests, {0, 0}, options);
+
+    if (backend == BACKEND_HOST)
+    {
+        if (!plan.executeHost())
+        {
+            return false;
+        }
+    }
+    else
+    {
+        NppStreamContext nppStreamCtx;
+
+        if (!defaultStreamContext(nppStreamCtx))
+        {
+            cerr << "Unable to get NPP stream context";
+            return false;
+        }
+
+        if (!plan.execute(nppStreamCtx))
+        {
+            return false;
+        }
+    }
+
+    // Split every ASCII art into lines
+    vector<vector<string>> lines;
+    size_t rows = 0;
+    size_t width = 0;
+    for (const string &art : plan.captured())
+    {
+        lines.push_back({});
+        istringstream iss(art);
+        string line;
+        while (getline(iss, line))
+        {
+            width = max(width, displayWidth(line));
+            lines.back().push_back(line);
+        }
+        rows = max(rows, lines.back().size());
+    }
+
+    // Header with the filter number and name, then the ASCII art side by side
+    for (size_t f = 0; f < lines.size(); f++)
+    {
+        string title = to_string(f) + ": " + filterName((int)f);
+        title.resize(width, ' ');
+        out << (f ? " | " : "") << title;
+    }
+    out << endl;
+
+    for (size_t i = 0; i < rows; i++)
+    {
+        for (size_t f = 0; f < lines.size(); f++)
+        {
+            out << (f ? " | " : "") << padLine(i < lines[f].size() ? lines[f][i] : "", width);
+        }
+        out << endl;
+    }
+
+    return true;
+}
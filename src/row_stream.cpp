@@ -0,0 +1,193 @@
+/**
+ * @file
+ * @brief Row streaming - Writes the ASCII art one band of rows at a time
+ * See row_stream.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <algorithm>
+
+#include <cuda_runtime.h>
+
+#include "ascii_art.h"
+#include "parallel.h"
+#include "profiler.h"
+#include "row_stream.h"
+
+using namespace std;
+
+RowStreamWriter::RowStreamWriter(ostream &out, const string &asciiPattern, int width, OutputFormat format,
+                                 int bandRows)
+    : out_(out), format_(format), htmlEncoder_(COLOR_NONE), width_(width), bandRows_(max(1, bandRows)), bytes_(0)
+{
+    glyphTable(asciiPattern.c_str(), table_);
+    if (format_ == FORMAT_HTML)
+    {
+        htmlGlyphTable(table_, htmlTable_);
+        // Sent with the first band
+        string header;
+        htmlEncoder_.header(false, header);
+        out_.write(header.data(), header.size());
+        bytes_ += header.size();
+    }
+
+    // Threads started once for every band
+    if (currentThreadPool() == nullptr && parallelThreads() > 1)
+    {
+        pool_.reset(new ThreadPool(parallelThreads()));
+    }
+}
+
+bool RowStreamWriter::writeBand(const Npp8u *rows, int pitch, int count)
+{
+    size_t lineBytes = (size_t)width_ * table_.maxLength + 1;
+    {
+        ProfileScope scope(STAGE_QUANTIZE);
+        unique_ptr<ThreadPoolScope> poolScope(pool_ ? new ThreadPoolScope(*pool_) : nullptr);
+        // Chunks of 16 rows at least, smaller ones cost more to schedule than to quantize
+        int chunks = min(parallelChunks(count), max(1, count / 16));
+        assembler_.encode(0, count, [&](int y, vector<char> &band) {
+            if (format_ == FORMAT_HTML)
+            {
+                htmlEncoder_.textRow(rows + (size_t)y * pitch, nullptr, width_, htmlTable_, band);
+                return;
+            }
+            size_t end = band.size();
+            band.resize(end + lineBytes);
+            end += encodeGlyphRow(rows + (size_t)y * pitch, width_, table_, &band[end]);
+            band[end] = '\n';
+            band.resize(end + 1);
+        }, chunks);
+        scope.count((double)width_ * count + assembler_.size(), (double)width_ * count);
+    }
+
+    size_t length = assembler_.size();
+    ProfileScope scope(STAGE_WRITE, (double)length, (double)length);
+    assembler_.write(out_);
+    out_.flush();
+    bytes_ += length;
+    if (count > 0)
+    {
+        profiler().firstLine();
+    }
+    return (bool)out_;
+}
+
+bool RowStreamWriter::finish()
+{
+    if (format_ == FORMAT_HTML)
+    {
+        string footer;
+        htmlEncoder_.footer(footer);
+        ProfileScope scope(STAGE_WRITE, (double)footer.size(), (double)footer.size());
+        out_.write(footer.data(), footer.size());
+        bytes_ += footer.size();
+    }
+    out_.flush();
+    return (bool)out_;
+}
+
+bool streamAsciiArt(ostream &out, const npp::ImageCPU_8u_C1 &img, const string &asciiPattern, OutputFormat format)
+{
+    int height = (int)img.height();
+    RowStreamWriter writer(out, asciiPattern, (int)img.width(), format);
+
+    bool result = true;
+    for (int y = 0; y < height && result; y += writer.bandRows())
+    {
+        int count = min(writer.bandRows(), height - y);
+        result = writer.writeBand(img.data(0, y), img.pitch(), count);
+    }
+    result = result && writer.finish();
+    profiler().addOutput((double)writer.bytes());
+    return result;
+}
+
+bool streamAsciiArt(ostream &out, npp::ImageNPP_8u_C1 &img, const string &asciiPattern, OutputFormat format)
+{
+    int width = (int)img.width();
+    int height = (int)img.height();
+    RowStreamWriter writer(out, asciiPattern, width, format);
+
+    // One band on the host, reused for every band
+    npp::ImageCPU_8u_C1 oHostBand(width, min(writer.bandRows(), height));
+
+    bool result = true;
+    for (int y = 0; y < height && result; y += writer.bandRows())
+    {
+        int count = min(writer.bandRows(), height - y);
+        {
+            double pixels = (double)width * count;
+            ProfileScope scope(STAGE_DOWNLOAD, pixels, pixels, true);
+            if (cudaMemcpy2D(oHostBand.data(), oHostBand.pitch(), img.data(0, y), img.pitch(), width, count,
+                             cudaMemcpyDeviceToHost) != cudaSuccess)
+            {
+                cerr << "Error downloading rows " << y << " to " << y + count << endl;
+                result = false;
+                break;
+            }
+        }
+        result = writer.writeBand(oHostBand.data(), oHostBand.pitch(), count);
+    }
+    result = result && writer.finish();
+    // The glyphs may differ in length: the bytes are only known once written
+    profiler().addOutput((double)writer.bytes());
+    return result;
+}
+
+size_t asciiArtLength(const npp::ImageCPU_8u_C1 &img, const GlyphTable &table, vector<size_t> &offsets)
+{
+    return asciiArtOffsets(img.data(), img.pitch(), {(int)img.width(), (int)img.height()}, table, offsets);
+}
+
+size_t asciiArtLength(npp::ImageNPP_8u_C1 &img, const GlyphTable &table, vector<size_t> &offsets)
+{
+    offsets.clear();
+    if (table.fixedLength == 0)
+    {
+        return 0;
+    }
+    return ((size_t)img.width() * table.fixedLength + 1) * img.height();
+}
+
+bool mapAsciiArt(OutputMap &map, const npp::ImageCPU_8u_C1 &img, const GlyphTable &table,
+                 const vector<size_t> &offsets)
+{
+    NppiSize size = {(int)img.width(), (int)img.height()};
+    double pixels = (double)size.width * size.height;
+    ProfileScope scope(STAGE_QUANTIZE, pixels + map.length(), pixels);
+
+    quantizeAsciiArt(img.data(), img.pitch(), size, table, offsets, map.data());
+    return true;
+}
+
+bool mapAsciiArt(OutputMap &map, npp::ImageNPP_8u_C1 &img, const GlyphTable &table, const vector<size_t> &offsets)
+{
+    int width = (int)img.width();
+    int height = (int)img.height();
+    size_t lineBytes = (size_t)width * table.fixedLength + 1;
+
+    // Bands large enough to keep every host thread busy
+    int bandRows = max(STREAM_BAND_ROWS, 16 * parallelThreads());
+    npp::ImageCPU_8u_C1 oHostBand(width, min(bandRows, height));
+
+    for (int y = 0; y < height; y += bandRows)
+    {
+        int count = min(bandRows, height - y);
+        double pixels = (double)width * count;
+        {
+            ProfileScope scope(STAGE_DOWNLOAD, pixels, pixels, true);
+            if (cudaMemcpy2D(oHostBand.data(), oHostBand.pitch(), img.data(0, y), img.pitch(), width, count,
+                             cudaMemcpyDeviceToHost) != cudaSuccess)
+            {
+                cerr << "Error downloading rows " << y << " to " << y + count << endl;
+                return false;
+            }
+        }
+        ProfileScope scope(STAGE_QUANTIZE, pixels + lineBytes * count, pixels);
+        quantizeAsciiArt(oHostBand.data(), oHostBand.pitch(), {width, count}, table, offsets,
+                         map.data() + y * lineBytes);
+    }
+    return true;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file
+ * @brief Synthetic images - Procedural test images of any size
+ * See synthetic.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <regex>
+#include <stdexcept>
+#include <string>
+
+#include <ImagesCPU.h>
+#include <helper_image.h>
+#include <npp.h>
+
+#include "parallel.h"
+#include "synthetic.h"
+
+using namespace std;
+
+/**
+ * @brief Tile contents
+ */
+typedef enum {
+    TILE_GRADIENT,
+    TILE_RECTANGLE,
+    TILE_CIRCLE,
+    TILE_TEXT,
+    TILE_TYPES
+} TileType;
+
+/**
+ * @brief Text tiles: lines of glyph cells, each glyph 5 x 6 pixels
+ */
+#define TEXT_CELL_WIDTH 8
+#define TEXT_LINE_HEIGHT 16
+#define TEXT_MARGIN 16
+
+/**
+ * @brief 32 bit integer hash (good avalanche, cheap)
+ */
+static inline unsigned int mix(unsigned int h)
+{
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * @brief Hash of a seed and two coordinates
+ */
+static inline unsigned int pixelHash(unsigned int seed, unsigned int a, unsigned int b)
+{
+    return mix(seed * 0x9e3779b9u ^ mix(a * 0x85ebca6bu ^ mix(b + 0x27d4eb2fu)));
+}
+
+bool isSyntheticImage(const string &imagePath)
+{
+    return imagePath.rfind(SYNTHETIC_PREFIX, 0) == 0;
+}
+
+bool parseSyntheticImage(const string &imagePath, NppiSize &size, unsigned int &seed)
+{
+    smatch match;
+    if (!regex_match(imagePath, match, regex(SYNTHETIC_PREFIX "([0-9]+)x([0-9]+)(:([0-9]+))?")))
+    {
+        return false;
+    }
+    unsigned long fullSeed = 1;
+    try
+    {
+        size = {stoi(match[1]), stoi(match[2])};
+        if (match[4].matched)
+        {
+            fullSeed = stoul(match[4]);
+        }
+    }
+    catch (const out_of_range &)
+    {
+        return false;
+    }
+    seed = (unsigned int)fullSeed;
+
+    // Images are indexed with ints, the pixels (and the seed) must fit
+    return size.width > 0 && size.height > 0 && (long long)size.width * size.height <= INT_MAX &&
+           fullSeed <= UINT_MAX;
+}
+
+/**
+ * @brief Generates one row
+ * @param row Destination row
+ * @param y Row number
+ * @param size Image size
+ * @param seed Seed
+ */
+static void generateRow(Npp8u *row, int y, NppiSize size, unsigned int seed)
+{
+    int ty = y / SYNTHETIC_TILE;
+    int ly = y % SYNTHETIC_TILE;
+
+    // Noise: xorshift along the row, seeded by the row
+    unsigned int noise = pixelHash(seed, 0x5eed, (unsigned int)y) | 1;
+
+    for (int x0 = 0; x0 < size.width; x0 += SYNTHETIC_TILE)
+    {
+        int x1 = min(size.width, x0 + SYNTHETIC_TILE);
+        unsigned int h = pixelHash(seed, (unsigned int)(x0 / SYNTHETIC_TILE), (unsigned int)ty);
+        TileType type = (TileType)(h % TILE_TYPES);
+        int ink = (h >> 28) & 1 ? 230 : 20;
+
+        // Text line of this row: glyph row 0 - 5, -1 between lines and on the margins
+        int glyphRow = (ly % TEXT_LINE_HEIGHT) - 5;
+        bool textRow = type == TILE_TEXT && glyphRow >= 0 && glyphRow < 6 &&
+                       ly >= TEXT_MARGIN && ly < SYNTHETIC_TILE - TEXT_MARGIN;
+
+        for (int x = x0; x < x1; x++)
+        {
+            int lx = x - x0;
+
+            // Diagonal gradient, 40 - 190
+            int v = 40 + (int)(150LL * (x + y) / (size.width + size.height));
+
+            switch (type)
+            {
+            case TILE_RECTANGLE:
+            {
+                int rx = 16 + (int)((h >> 4) % 96), ry = 16 + (int)((h >> 12) % 96);
+                int rw = 64 + (int)((h >> 20) % 64), rh = 64 + (int)((h >> 8) % 64);
+                if (lx >= rx && lx < rx + rw && ly >= ry && ly < ry + rh)
+                {
+                    v = ink;
+                }
+                break;
+            }
+            case TILE_CIRCLE:
+            {
+                int dx = lx - (96 + (int)((h >> 4) % 64)), dy = ly - (96 + (int)((h >> 10) % 64));
+                int r = 40 + (int)((h >> 16) % 56);
+                if (dx * dx + dy * dy <= r * r)
+                {
+                    v = ink;
+                }
+                break;
+            }
+            case TILE_TEXT:
+            {
+                // Light page, dark glyphs: 5 x 6 bits of a hash per glyph, some cells are spaces
+                v = 210;
+                if (textRow && lx >= TEXT_MARGIN && lx < SYNTHETIC_TILE - TEXT_MARGIN)
+                {
+                    int cell = lx / TEXT_CELL_WIDTH;
+                    int glyphCol = lx % TEXT_CELL_WIDTH - 1;
+                    unsigned int glyph = pixelHash(h, (unsigned int)cell, (unsigned int)(ly / TEXT_LINE_HEIGHT));
+                    if ((glyph >> 30) != 0 && glyphCol >= 0 && glyphCol < 5 && (glyph >> (glyphRow * 5 + glyphCol)) & 1)
+                    {
+                        v = 30;
+                    }
+                }
+                break;
+            }
+            default:
+                break;
+            }
+
+            noise ^= noise << 13;
+            noise ^= noise >> 17;
+            noise ^= noise << 5;
+            v += (int)(noise & 15) - 8;
+
+            row[x] = (Npp8u)max(0, min(255, v));
+        }
+    }
+}
+
+void generateImage(NppiSize size, unsigned int seed, npp::ImageCPU_8u_C1 &dst)
+{
+    npp::ImageCPU_8u_C1 img(size.width, size.height);
+    parallelFor(size.height, [&](int band, int begin, int end) {
+        for (int y = begin; y < end; y++)
+        {
+            generateRow(img.data(0, y), y, size, seed);
+        }
+    });
+    img.swap(dst);
+}
+
+bool writeImage(const npp::ImageCPU_8u_C1 &img, const string &path)
+{
+    size_t dot = path.rfind('.');
+    if (dot != string::npos && path.substr(dot) == ".pgm")
+    {
+        return sdkSavePGM(path.c_str(), const_cast<Npp8u *>(img.data()), img.width(), img.height());
+    }
+
+    ofstream ofs(path, ios::binary);
+    for (unsigned int y = 0; y < img.height() && ofs; y++)
+    {
+        ofs.write((const char *)img.data(0, y), img.width());
+    }
+    return (bool)ofs;
+}
@@ -0,0 +1,215 @@
+/**
+ * @file
+ * @brief Event tracing - Timeline of the stages, waits and I/O of every thread
+ * See trace.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#ifdef ASCIIART_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+using namespace std;
+
+std::atomic<bool> traceActive(false);
+
+/**
+ * @brief Complete event
+ */
+typedef struct {
+    const char *category;
+    const char *name;
+    long long start;
+    long long duration;
+} TraceEvent;
+
+/**
+ * @brief Events of one thread. Only its thread writes; the events are read
+ * once every thread is done.
+ */
+typedef struct {
+    /** Timeline row, 0 = main thread */
+    int lane;
+    /** Events written so far, the last TRACE_BUFFER_EVENTS are kept */
+    std::atomic<unsigned long long> head;
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+} TraceBuffer;
+
+/**
+ * @brief Row of the timeline: the buffer of one thread at a time
+ */
+typedef struct {
+    /** Taken by a running thread */
+    std::atomic<bool> taken;
+    /** Created by the first thread of the row, kept for the next ones */
+    TraceBuffer *buffer;
+} TraceSlot;
+
+/** Rows of the timeline, the first slotCount are in use or were used */
+static TraceSlot slots[TRACE_MAX_THREADS];
+static std::atomic<int> slotCount(0);
+/** Start of the trace */
+static long long traceOrigin = 0;
+
+/**
+ * @brief Frees the buffers at exit
+ */
+static struct SlotCleanup {
+    ~SlotCleanup()
+    {
+        for (TraceSlot &slot : slots)
+        {
+            delete slot.buffer;
+        }
+    }
+} slotCleanup;
+
+/**
+ * @brief Buffer of the calling thread, nullptr if more than TRACE_MAX_THREADS
+ * threads trace at once. Rows of finished threads are reused by new ones (the
+ * parallel loops start new threads every time), lowest first, so the timeline
+ * shows one row for each concurrent thread. Rows are taken with a compare and
+ * swap and released with a store, without locks.
+ */
+static TraceBuffer *threadBuffer()
+{
+    struct Holder {
+        TraceSlot *slot = nullptr;
+        ~Holder()
+        {
+            if (slot)
+            {
+                slot->taken.store(false, memory_order_release);
+            }
+        }
+    };
+    thread_local Holder holder;
+
+    while (!holder.slot)
+    {
+        // A row released by a finished thread, or a new one
+        int count = min(slotCount.load(memory_order_acquire), TRACE_MAX_THREADS);
+        for (int s = 0; s < count && !holder.slot; s++)
+        {
+            bool expected = false;
+            if (slots[s].taken.compare_exchange_strong(expected, true, memory_order_acquire))
+            {
+                holder.slot = &slots[s];
+            }
+        }
+        if (!holder.slot)
+        {
+            if (count == TRACE_MAX_THREADS)
+            {
+                return nullptr;
+            }
+            int s = slotCount.fetch_add(1, memory_order_acq_rel);
+            if (s >= TRACE_MAX_THREADS)
+            {
+                return nullptr;
+            }
+            // Another thread may take the new row first, then look again
+            bool expected = false;
+            if (slots[s].taken.compare_exchange_strong(expected, true, memory_order_acquire))
+            {
+                holder.slot = &slots[s];
+            }
+        }
+    }
+
+    // The thread that takes a row first creates its buffer
+    if (!holder.slot->buffer)
+    {
+        holder.slot->buffer = new TraceBuffer();
+        holder.slot->buffer->lane = (int)(holder.slot - slots);
+        holder.slot->buffer->head.store(0, memory_order_relaxed);
+    }
+    return holder.slot->buffer;
+}
+
+void traceEnable()
+{
+    traceOrigin = traceNow();
+    // The main thread takes the first row
+    threadBuffer();
+    traceActive.store(true);
+}
+
+void traceDisable()
+{
+    traceActive.store(false);
+}
+
+void traceEvent(const char *category, const char *name, long long start, long long end)
+{
+    TraceBuffer *buffer = threadBuffer();
+    if (!buffer)
+    {
+        return;
+    }
+    unsigned long long head = buffer->head.load(memory_order_relaxed);
+    buffer->events[head % TRACE_BUFFER_EVENTS] = {category, name, start, end - start};
+    buffer->head.store(head + 1, memory_order_release);
+}
+
+/**
+ * @brief Writes nanoseconds as microseconds, without rounding
+ */
+static void writeMicroseconds(ostream &out, long long ns)
+{
+    out << ns / 1000 << '.' << setw(3) << setfill('0') << ns % 1000 << setfill(' ');
+}
+
+bool traceWrite(const string &path)
+{
+    ofstream ofs(path);
+    if (!ofs)
+    {
+        return false;
+    }
+
+    // Times are in microseconds
+    ofs << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [" << endl;
+    ofs << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"asciiArtNpp\"}}";
+    int count = min(slotCount.load(memory_order_acquire), TRACE_MAX_THREADS);
+    for (int s = 0; s < count; s++)
+    {
+        const TraceBuffer *buffer = slots[s].buffer;
+        if (!buffer)
+        {
+            continue;
+        }
+        ofs << "," << endl
+            << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->lane
+            << ", \"args\": {\"name\": \"" << (buffer->lane ? "worker " + to_string(buffer->lane) : string("main"))
+            << "\"}}";
+
+        unsigned long long head = buffer->head.load(memory_order_acquire);
+        unsigned long long first = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+        for (unsigned long long e = first; e < head; e++)
+        {
+            const TraceEvent &event = buffer->events[e % TRACE_BUFFER_EVENTS];
+            ofs << "," << endl
+                << "{\"name\": \"" << event.name << "\", \"cat\": \"" << event.category
+                << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->lane
+                << ", \"ts\": ";
+            writeMicroseconds(ofs, event.start - traceOrigin);
+            ofs << ", \"dur\": ";
+            writeMicroseconds(ofs, event.duration);
+            ofs << "}";
+        }
+    }
+    ofs << endl
+        << "]}" << endl;
+    return (bool)ofs;
+}
+
+#endif
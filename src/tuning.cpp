@@ -0,0 +1,277 @@
+/**
+ * @file
+ * @brief Autotuning of the host stages - Best parallel settings for this machine
+ * See tuning.h for details.
+ * @author Erwin Meza Vega <emezav@gmail.com>
+ * @copyright MIT License
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem> // Requires c++ 17
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ImagesCPU.h>
+#include <helper_timer.h>
+
+#include "integral_image.h"
+#include "parallel.h"
+#include "synthetic.h"
+#include "tuning.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+/**
+ * @brief Upper bound (Mpixels) and representative size (Mpixels) of each size class
+ */
+static const double classLimit[SIZE_CLASS_COUNT] = {2, 16, 64, 1e12};
+static const double classSample[SIZE_CLASS_COUNT] = {1, 8, 32, 96};
+
+/**
+ * @brief Rows per chunk tried by the tuner, 0 = one chunk per thread
+ */
+static const int bandCandidates[] = {0, 8, 32, 128};
+
+/**
+ * @brief Columns of the area sampling timed by the tuner
+ */
+#define TUNING_COLUMNS 160
+
+SizeClass sizeClass(NppiSize size)
+{
+    double mpixels = (double)size.width * size.height / 1e6;
+    int c = 0;
+    while (c < SIZE_CLASS_COUNT - 1 && mpixels > classLimit[c])
+    {
+        c++;
+    }
+    return (SizeClass)c;
+}
+
+const char *sizeClassName(SizeClass sizeClass)
+{
+    static const char *names[SIZE_CLASS_COUNT] = {"small", "medium", "large", "huge"};
+    return sizeClass >= 0 && sizeClass < SIZE_CLASS_COUNT ? names[sizeClass] : "unknown";
+}
+
+SizeClass parseSizeClass(const string &name)
+{
+    int c = 0;
+    while (c < SIZE_CLASS_COUNT && name != sizeClassName((SizeClass)c))
+    {
+        c++;
+    }
+    return (SizeClass)c;
+}
+
+string cpuModel()
+{
+    ifstream ifs("/proc/cpuinfo");
+    string line;
+    while (getline(ifs, line))
+    {
+        if (line.rfind("model name", 0) == 0 && line.find(':') != string::npos)
+        {
+            string model = line.substr(line.find(':') + 1);
+            model.erase(0, model.find_first_not_of(" \t"));
+            // Tabs separate the fields of the cache
+            replace(model.begin(), model.end(), '\t', ' ');
+            return model;
+        }
+    }
+    return "unknown";
+}
+
+string defaultTuningPath()
+{
+    const char *path = getenv("ASCIIART_TUNING");
+    if (path && *path)
+    {
+        return path;
+    }
+    const char *cache = getenv("XDG_CACHE_HOME");
+    if (cache && *cache)
+    {
+        return (fs::path(cache) / "asciiArtNpp" / "tuning.txt").string();
+    }
+    const char *home = getenv("HOME");
+    return (fs::path(home ? home : ".") / ".cache" / "asciiArtNpp" / "tuning.txt").string();
+}
+
+bool loadTuning(const string &path, const string &cpu, TuningTable &table)
+{
+    ifstream ifs(path);
+    string line;
+    bool found = false;
+
+    // cpu <tab> size class <tab> threads <tab> rows per chunk
+    while (getline(ifs, line))
+    {
+        vector<string> fields;
+        stringstream ss(line);
+        string field;
+        while (getline(ss, field, '\t'))
+        {
+            fields.push_back(field);
+        }
+        if (fields.size() < 4 || fields[0] != cpu)
+        {
+            continue;
+        }
+        SizeClass c = parseSizeClass(fields[1]);
+        if (c == SIZE_CLASS_COUNT)
+        {
+            continue;
+        }
+        table.settings[c] = {max(0, atoi(fields[2].c_str())), max(0, atoi(fields[3].c_str()))};
+        table.tuned[c] = true;
+        found = true;
+    }
+    return found;
+}
+
+bool saveTuning(const string &path, const string &cpu, const TuningTable &table)
+{
+    // Keep the entries of the other CPUs
+    vector<string> lines;
+    {
+        ifstream ifs(path);
+        string line;
+        while (getline(ifs, line))
+        {
+            if (line.rfind(cpu + "\t", 0) != 0)
+            {
+                lines.push_back(line);
+            }
+        }
+    }
+
+    if (fs::path(path).has_parent_path())
+    {
+        error_code ec;
+        fs::create_directories(fs::path(path).parent_path(), ec);
+    }
+
+    ofstream ofs(path);
+    for (const string &line : lines)
+    {
+        ofs << line << endl;
+    }
+    for (int c = 0; c < SIZE_CLASS_COUNT; c++)
+    {
+        if (table.tuned[c])
+        {
+            ofs << cpu << '\t' << sizeClassName((SizeClass)c) << '\t' << table.settings[c].threads << '\t'
+                << table.settings[c].bandRows << endl;
+        }
+    }
+    return (bool)ofs;
+}
+
+/**
+ * @brief Median time of the threaded host stages with the current settings, milliseconds
+ */
+static double timeHostStages(const npp::ImageCPU_8u_C1 &src, IntegralImage &integral, npp::ImageCPU_8u_C1 &art,
+                             npp::ImageCPU_8u_C1 &blurred, int repeat)
+{
+    StopWatchInterface *timer = nullptr;
+    sdkCreateTimer(&timer);
+
+    vector<double> times;
+    for (int i = 0; i <= repeat; i++)
+    {
+        sdkResetTimer(&timer);
+        sdkStartTimer(&timer);
+        integral.build(src);
+        areaSample(integral, art);
+        boxBlur(integral, 2, blurred);
+        sdkStopTimer(&timer);
+        // The first run warms up the caches and the allocations
+        if (i > 0)
+        {
+            times.push_back(sdkGetTimerValue(&timer));
+        }
+    }
+    sdkDeleteTimer(&timer);
+
+    sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+void tune(ostream &log, TuningTable &table, unsigned int classes, int repeat)
+{
+    ParallelSettings saved = parallelSettings();
+
+    // 1, 2, 4 ... threads, and the hardware threads
+    setParallelThreads(0);
+    int hardwareThreads = parallelThreads();
+    vector<int> threadCandidates;
+    for (int t = 1; t < hardwareThreads; t *= 2)
+    {
+        threadCandidates.push_back(t);
+    }
+    threadCandidates.push_back(hardwareThreads);
+
+    for (int c = 0; c < SIZE_CLASS_COUNT; c++)
+    {
+        if (!(classes & (1u << c)))
+        {
+            continue;
+        }
+
+        // 4:3 image of the representative size
+        int width = (int)(sqrt(classSample[c] * 1e6 * 4 / 3) + 0.5);
+        NppiSize size = {width, width * 3 / 4};
+        npp::ImageCPU_8u_C1 src;
+        generateImage(size, 1, src);
+        IntegralImage integral;
+        npp::ImageCPU_8u_C1 art(TUNING_COLUMNS, max(1, TUNING_COLUMNS * size.height / size.width));
+        npp::ImageCPU_8u_C1 blurred(size.width, size.height);
+
+        log << sizeClassName((SizeClass)c) << " (" << size.width << "x" << size.height << ")" << endl;
+
+        double best = 0;
+        for (int threads : threadCandidates)
+        {
+            for (int bandRows : bandCandidates)
+            {
+                parallelSettings() = {threads, bandRows};
+                double ms = timeHostStages(src, integral, art, blurred, repeat);
+                log << "  threads " << setw(3) << threads << ", rows per chunk " << setw(4) << bandRows << ": "
+                    << fixed << setprecision(3) << setw(10) << ms << " ms" << defaultfloat << endl;
+                if (best == 0 || ms < best)
+                {
+                    best = ms;
+                    table.settings[c] = {threads, bandRows};
+                    table.tuned[c] = true;
+                }
+            }
+        }
+        log << "  best: threads " << table.settings[c].threads << ", rows per chunk " << table.settings[c].bandRows
+            << endl;
+    }
+
+    parallelSettings() = saved;
+}
+
+void applyTuning(const TuningTable &table, NppiSize size)
+{
+    SizeClass c = sizeClass(size);
+    if (table.tuned[c])
+    {
+        parallelSettings() = table.settings[c];
+    }
+}
+
+TuningTable &activeTuning()
+{
+    static TuningTable table = {};
+    return table;
+}